@@ -0,0 +1,235 @@
+
+#include "common.h"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "AnalyticPhantom.h"
+#include "Volume.h"
+#include "VolumeProjectionSet.h"
+#include "HdrProjectionWriter.h"
+#include "PoissonNoise.h"
+#include "THREADutils.h"
+
+using namespace GPURec;
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  SHAPES
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void AnalyticPhantom::addEllipsoid( float x0, float y0, float z0, float a, float b, float c, float phi, float density ) {
+
+  Shape shape;
+  shape.type = ELLIPSOID;
+  shape.x0 = x0;  shape.y0 = y0;  shape.z0 = z0;
+  shape.a = a;    shape.b = b;    shape.c = c;
+  shape.cosPhi = cos( phi * M_PI / 180.0 );
+  shape.sinPhi = sin( phi * M_PI / 180.0 );
+  shape.density = density;
+  shapes.push_back( shape );
+}
+
+
+void AnalyticPhantom::addCylinder( float x0, float y0, float z0, float a, float b, float halfHeight, float phi, float density ) {
+
+  addEllipsoid( x0, y0, z0, a, b, halfHeight, phi, density );
+  shapes.back().type = CYLINDER;
+}
+
+
+void AnalyticPhantom::createSheppLogan( void ) {
+
+  clear();
+
+  //            x0      y0       z0      a       b      c      phi   density
+  addEllipsoid(  0.0f,   0.0f,    0.0f,   0.69f,  0.92f, 0.9f,   0.0f,  1.0f );
+  addEllipsoid(  0.0f,  -0.0184f, 0.0f,   0.6624f,0.874f,0.88f,  0.0f, -0.8f );
+  addEllipsoid( -0.22f,  0.0f,   -0.25f,  0.41f,  0.16f, 0.21f,108.0f, -0.2f );
+  addEllipsoid(  0.22f,  0.0f,   -0.25f,  0.31f,  0.11f, 0.22f, 72.0f, -0.2f );
+  addEllipsoid(  0.0f,   0.35f,  -0.25f,  0.21f,  0.25f, 0.5f,   0.0f,  0.1f );
+  addEllipsoid(  0.0f,   0.1f,   -0.25f,  0.046f, 0.046f,0.046f, 0.0f,  0.1f );
+  addEllipsoid( -0.08f, -0.65f,  -0.25f,  0.046f, 0.023f,0.02f,  0.0f,  0.1f );
+  addEllipsoid(  0.06f, -0.65f,  -0.25f,  0.046f, 0.023f,0.02f, 90.0f,  0.1f );
+  addEllipsoid(  0.06f, -0.105f,  0.625f, 0.056f, 0.04f, 0.1f,  90.0f,  0.1f );
+  addEllipsoid(  0.0f,   0.1f,    0.625f, 0.056f, 0.056f,0.1f,   0.0f,  0.1f );
+}
+
+
+float AnalyticPhantom::chordLength( const Shape& shape, float px, float py, float pz, float dx, float dy ) {
+
+  // line in the frame of the shape, scaled to the unit sphere (cylinder)
+  float qz = pz - shape.z0;
+  float qx = (  shape.cosPhi * (px - shape.x0) + shape.sinPhi * (py - shape.y0) ) / shape.a;
+  float qy = ( -shape.sinPhi * (px - shape.x0) + shape.cosPhi * (py - shape.y0) ) / shape.b;
+  float ex = (  shape.cosPhi * dx + shape.sinPhi * dy ) / shape.a;
+  float ey = ( -shape.sinPhi * dx + shape.cosPhi * dy ) / shape.b;
+
+  float c;
+  if( shape.type == CYLINDER ) {
+    if( fabs( qz ) > shape.c ) return 0.0f;
+    c = qx*qx + qy*qy - 1.0f;
+  }
+  else
+    c = qx*qx + qy*qy + (qz*qz) / (shape.c*shape.c) - 1.0f;
+
+  // |q + t*e|^2 = 1: the chord is the distance between the two roots
+  float a = ex*ex + ey*ey;
+  float b = 2.0f * ( qx*ex + qy*ey );
+  float discriminant = b*b - 4.0f*a*c;
+
+  return ( discriminant > 0.0f ) ? sqrt( discriminant ) / a : 0.0f;
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  PROJECTIONS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void AnalyticPhantom::projectLine( float angle, unsigned int dim, unsigned int z, float scale, float* line ) const {
+
+  float center = (dim - 1) / 2.0f;
+  float voxelSize = 2.0f / dim;
+  float cosAngle = cos( angle );
+  float sinAngle = sin( angle );
+
+  // chords are measured in world unit, the projectors sum one sample per voxel length
+  float factor = scale / voxelSize;
+  float pz = (z - center) * voxelSize;
+
+  for( unsigned int u = 0; u < dim; u++ ) {
+
+    float px = (u - center) * voxelSize * cosAngle;
+    float py = (u - center) * voxelSize * sinAngle;
+
+    float sum = 0.0f;
+    for( unsigned int s = 0; s < shapes.size(); s++ )
+      sum += shapes[s].density * chordLength( shapes[s], px, py, pz, -sinAngle, cosAngle );
+    line[u] = sum * factor;
+  }
+}
+
+
+void AnalyticPhantom::project( float angle, unsigned int dim, float scale, float* projection ) const {
+
+  for( unsigned int z = 0; z < dim; z++ )
+    projectLine( angle, dim, z, scale, projection + z*dim );
+}
+
+
+void AnalyticPhantom::projectLines( unsigned int begin, unsigned int end, void* context ) {
+
+  ProjectionContext* ctx = (ProjectionContext*)context;
+  unsigned int dim = ctx->dim;
+
+  for( unsigned int index = begin; index < end; index++ ) {
+
+    unsigned int p = index / dim;
+    unsigned int z = index % dim;
+    ctx->phantom->projectLine( ctx->angles[p], dim, z, ctx->scale, ctx->projections[p] + z*dim );
+    if( ctx->noiseSeed >= 0 )
+      PoissonNoise::applyLine( ctx->projections[p] + z*dim, dim, z, ctx->firstProjection + p, ctx->noiseSeed );
+  }
+}
+
+
+void AnalyticPhantom::saveProjections( VolumeProjectionSet& projSet, unsigned int dim, unsigned int nbProjections,
+                                       float scale, unsigned int nbThreads, int noiseSeed ) const {
+
+  projSet.createEmpty( dim, nbProjections, 0.0f, 0.0f, false );
+
+  ProjectionContext ctx;
+  ctx.phantom = this;
+  ctx.dim = dim;
+  ctx.scale = scale;
+  ctx.noiseSeed = noiseSeed;
+  ctx.firstProjection = 0;
+  for( unsigned int p = 0; p < nbProjections; p++ ) {
+    ctx.angles.push_back( projSet.getAngle(p) );
+    ctx.projections.push_back( projSet.getData(p) );
+  }
+
+  THREADutils::parallelFor( 0, nbProjections * dim, projectLines, &ctx, nbThreads );
+}
+
+
+void AnalyticPhantom::saveProjections( const std::string& hdrFileName, unsigned int dim, unsigned int nbProjections,
+                                       float pixelSize, float scale, unsigned int nbThreads, int noiseSeed ) const {
+
+  if( nbThreads == 0 ) nbThreads = THREADutils::getNbHardwareThreads();
+
+  float rotationIncrement = (2.0f * M_PI) / nbProjections;
+  HdrProjectionWriter writer( hdrFileName, dim, pixelSize, nbProjections, 0.0f, rotationIncrement );
+  writer.addKey( "!imaging modality", "nucmed" );
+  writer.addKey( "!originating system", "GPURec analytic phantom" );
+
+  // blocks of one projection per thread, written before the next block is computed
+  unsigned int blockSize = std::min( nbThreads, nbProjections );
+  std::vector<float> block( blockSize * dim * dim );
+
+  ProjectionContext ctx;
+  ctx.phantom = this;
+  ctx.dim = dim;
+  ctx.scale = scale;
+  ctx.noiseSeed = noiseSeed;
+
+  for( unsigned int first = 0; first < nbProjections; first += blockSize ) {
+
+    unsigned int count = std::min( blockSize, nbProjections - first );
+    ctx.firstProjection = first;
+    ctx.angles.clear();
+    ctx.projections.clear();
+    for( unsigned int p = 0; p < count; p++ ) {
+      ctx.angles.push_back( (first + p) * rotationIncrement );
+      ctx.projections.push_back( &block[ p * dim * dim ] );
+    }
+
+    THREADutils::parallelFor( 0, count * dim, projectLines, &ctx, nbThreads );
+
+    for( unsigned int p = 0; p < count; p++ )
+      writer.writeProjection( ctx.projections[p] );
+  }
+
+  writer.close();
+}
+
+
+void AnalyticPhantom::voxelize( Volume& volume, unsigned int dim ) const {
+
+  volume.reset( dim );
+
+  float center = (dim - 1) / 2.0f;
+  float voxelSize = 2.0f / dim;
+
+  for( unsigned int k = 0; k < dim; k++ )
+  for( unsigned int j = 0; j < dim; j++ )
+  for( unsigned int i = 0; i < dim; i++ ) {
+
+    float x = (i - center) * voxelSize;
+    float y = (j - center) * voxelSize;
+    float z = (k - center) * voxelSize;
+
+    // the densities of all the shapes containing the center of the voxel add up
+    float sum = 0.0f;
+    for( unsigned int s = 0; s < shapes.size(); s++ ) {
+
+      const Shape& shape = shapes[s];
+      float qz = z - shape.z0;
+      float qx = (  shape.cosPhi * (x - shape.x0) + shape.sinPhi * (y - shape.y0) ) / shape.a;
+      float qy = ( -shape.sinPhi * (x - shape.x0) + shape.cosPhi * (y - shape.y0) ) / shape.b;
+      bool inside = ( shape.type == CYLINDER ) ? ( fabs( qz ) <= shape.c && qx*qx + qy*qy <= 1.0f )
+                                              : ( qx*qx + qy*qy + (qz*qz) / (shape.c*shape.c) <= 1.0f );
+      if( inside ) sum += shape.density;
+    }
+    volume.value(i,j,k) = sum;
+  }
+
+  volume.computeMaxValue();
+}
@@ -0,0 +1,86 @@
+#ifndef _ANALYTICPHANTOM_H
+#define _ANALYTICPHANTOM_H
+
+#include <string>
+#include <vector>
+
+namespace GPURec {
+
+class Volume;
+class VolumeProjectionSet;
+
+
+// Phantom made of ellipsoids and elliptic cylinders whose densities add up.
+// The projections are computed from the exact chord lengths of the rays through the shapes,
+// without voxelization and without GL: the rays follow the sampling geometry of the projectors
+// (pixel (u,z) of the projection at *angle* is the line c + R(angle)(u-c, v-c), v = 0..dim-1, of slice z).
+// Shapes are given in world coordinates: the volume spans [-1,1] on each axis.
+class AnalyticPhantom {
+
+public:
+
+  void clear( void ) { shapes.clear(); }
+
+  // phi: rotation around the z axis, in DEGREES
+  void addEllipsoid( float x0, float y0, float z0, float a, float b, float c, float phi, float density );
+  // axis along z, from z0 - halfHeight to z0 + halfHeight
+  void addCylinder( float x0, float y0, float z0, float a, float b, float halfHeight, float phi, float density );
+
+  // 3D Shepp-Logan head (ellipsoids of Kak & Slaney) with the contrasts of the modified phantom
+  void createSheppLogan( void );
+
+  // line integrals of the projection at *angle* (RADIAN): dim x dim values, lines from bottom to top,
+  // in density x voxel length unit multiplied by *scale*
+  void project( float angle, unsigned int dim, float scale, float* projection ) const;
+
+  // all the projections, computed in main memory by nbThreads threads (0: one per hardware thread)
+  // over the (angle, line) pairs; the set has the default pixel size and a full rotation
+  // with noiseSeed >= 0 the counts get the Poisson noise of that seed
+  void saveProjections( VolumeProjectionSet& projSet, unsigned int dim, unsigned int nbProjections,
+                        float scale, unsigned int nbThreads = 0, int noiseSeed = -1 ) const;
+
+  // the same projections streamed to an Interfile set, a few projections in memory at a time
+  void saveProjections( const std::string& hdrFileName, unsigned int dim, unsigned int nbProjections,
+                        float pixelSize, float scale, unsigned int nbThreads = 0, int noiseSeed = -1 ) const;
+
+  // density at the center of each voxel (reference volume), only in main memory
+  void voxelize( Volume& volume, unsigned int dim ) const;
+
+protected:
+
+  enum ShapeType { ELLIPSOID, CYLINDER };
+
+  struct Shape {
+    ShapeType type;
+    float x0, y0, z0;
+    float a, b, c;         // semi-axes, c is the half height of a cylinder
+    float cosPhi, sinPhi;
+    float density;
+  };
+
+  // (angle, line) pairs of a block of projections, computed in parallel
+  struct ProjectionContext {
+    const AnalyticPhantom* phantom;
+    unsigned int dim;
+    float scale;
+    int noiseSeed;
+    unsigned int firstProjection;     // number in the set of the first projection of the block
+    std::vector<float> angles;
+    std::vector<float*> projections;
+  };
+
+  static void projectLines( unsigned int begin, unsigned int end, void* context );
+
+  // length of the intersection of the line p + t*d (d unit, horizontal) with the shape
+  static float chordLength( const Shape& shape, float px, float py, float pz, float dx, float dy );
+
+  // line z of the projection at angle
+  void projectLine( float angle, unsigned int dim, unsigned int z, float scale, float* line ) const;
+
+  std::vector<Shape> shapes;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _ANALYTICPHANTOM_H
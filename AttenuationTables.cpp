@@ -0,0 +1,147 @@
+#include "common.h"
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include "AttenuationTables.h"
+#include "Volume.h"
+#include "THREADutils.h"
+
+using namespace GPURec;
+
+
+void AttenuationTables::reset( unsigned int _dim, size_t _budget ) {
+
+  clearMap();
+  dim = _dim;
+  budget = _budget;
+}
+
+
+void AttenuationTables::clear( void ) {
+
+  tables.clear();
+  rangeSums.clear();
+  sensitivities[0].clear();
+  sensitivities[1].clear();
+  memory = 0;
+}
+
+
+void AttenuationTables::setMap( const Volume& muMap, float pixelSize ) {
+
+  if( muMap.getDim() != dim || !muMap.getData() ) {
+    std::cerr << "Attenuation map: " << muMap.getDim() << " voxels per axis instead of " << dim << std::endl;
+    throw std::exception();
+  }
+
+  // same map for the next scan: the factors are kept
+  float length = pixelSize * 100.0f;
+  const float* data = muMap.getData();
+  if( hasMap() && length == stepLength && std::equal( mu.begin(), mu.end(), data ) )
+    return;
+
+  clear();
+  stepLength = length;
+  mu.assign( data, data + dim * dim * dim );
+}
+
+
+const float* AttenuationTables::find( float angle ) const {
+
+  std::map< float, std::vector<float> >::const_iterator it = tables.find( angle );
+  return ( it == tables.end() ) ? 0 : &it->second[0];
+}
+
+
+const float* AttenuationTables::store( float angle, const int* samplingMap, const int* backProjectionMap, unsigned int nbThreads,
+                                      THREADutils::WorkerPool* workers ) {
+
+  size_t tableSize = (size_t)dim * dim * dim * sizeof(float);
+  if( memory + tableSize > budget ) return 0;
+
+  std::vector<float>& factors = tables[angle];
+  factors.resize( (size_t)dim * dim * dim );
+  memory += tableSize;
+
+  compute( samplingMap, backProjectionMap, &factors[0], nbThreads, workers );
+  return &factors[0];
+}
+
+
+const float* AttenuationTables::findSensitivity( const std::vector<float>& angles, bool convolve ) const {
+
+  std::map< std::vector<float>, std::vector<float> >::const_iterator it = sensitivities[convolve].find( angles );
+  return ( it == sensitivities[convolve].end() ) ? 0 : &it->second[0];
+}
+
+
+float* AttenuationTables::storeSensitivity( const std::vector<float>& angles, bool convolve ) {
+
+  size_t imageSize = (size_t)dim * dim * dim * sizeof(float);
+  if( memory + imageSize > budget ) return 0;
+
+  std::vector<float>& sensitivity = sensitivities[convolve][angles];
+  sensitivity.resize( (size_t)dim * dim * dim );
+  memory += imageSize;
+  return &sensitivity[0];
+}
+
+
+void AttenuationTables::compute( const int* samplingMap, const int* backProjectionMap, float* factors, unsigned int nbThreads,
+                                 THREADutils::WorkerPool* workers ) {
+
+  if( nbThreads == 0 ) nbThreads = THREADutils::getNbHardwareThreads();
+  if( rangeSums.size() != nbThreads ) {
+    rangeSums.resize( nbThreads );
+    for( unsigned int t = 0; t < nbThreads; t++ )
+      rangeSums[t].resize( dim * dim + dim );
+  }
+
+  SliceContext context;
+  context.tables = this;
+  context.samplingMap = samplingMap;
+  context.backProjectionMap = backProjectionMap;
+  context.factors = factors;
+  context.nbThreads = nbThreads;
+  THREADutils::parallelFor( 0, dim, computeSlices, &context, nbThreads, workers );
+}
+
+
+void AttenuationTables::computeSlices( unsigned int begin, unsigned int end, void* context ) {
+
+  SliceContext* ctx = (SliceContext*)context;
+  unsigned int dim = ctx->tables->dim;
+  float* sums = &ctx->tables->rangeSums[ THREADutils::getRangeIndex( 0, dim, begin, ctx->nbThreads ) ][0];
+
+  for( unsigned int z = begin; z < end; z++ )
+    ctx->tables->computeSlice( z, ctx->samplingMap, ctx->backProjectionMap, ctx->factors + z*dim*dim, sums );
+}
+
+
+void AttenuationTables::computeSlice( unsigned int z, const int* samplingMap, const int* backProjectionMap, float* factors, float* sums ) const {
+
+  const float* slice = &mu[ z*dim*dim ];
+
+  // path from the point (u,v) of the plane v to the camera: prefix sum over the planes 0..v
+  float* cumulated = sums + dim * dim;
+  std::fill( cumulated, cumulated + dim, 0.0f );
+  for( unsigned int v = 0; v < dim; v++ ) {
+
+    const int* planeMap = samplingMap + v*dim;
+    float* planeSums = sums + v*dim;
+    for( unsigned int u = 0; u < dim; u++ ) {
+
+      float value = ( planeMap[u] >= 0 ) ? slice[ planeMap[u] ] : 0.0f;
+      planeSums[u] = cumulated[u] + 0.5f * value;
+      cumulated[u] += value;
+    }
+  }
+
+  for( unsigned int voxel = 0; voxel < dim * dim; voxel++ ) {
+
+    int point = backProjectionMap[voxel];
+    factors[voxel] = ( point >= 0 ) ? exp( -stepLength * sums[point] ) : 1.0f;
+  }
+}
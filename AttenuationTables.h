@@ -0,0 +1,88 @@
+#ifndef _ATTENUATIONTABLES_H
+#define _ATTENUATIONTABLES_H
+
+#include <map>
+#include <vector>
+#include <cstddef>
+
+#include "THREADutils.h"
+
+namespace GPURec {
+
+class Volume;
+
+
+// Attenuation factors of the CPU backend: for each angle, exp(-integral of mu) between each voxel
+// and the camera, in the volume layout (dim x dim x dim). The rays are the lines of the projection
+// planes: in a slice, mu is sampled along the planes with the sampling map of the angle and summed
+// from the camera (plane 0) with a prefix sum, the voxel counting for half its length. The sums are
+// brought back to the voxels with the backprojection map, so the projector and the backprojector
+// use the same factor for a voxel.
+// The factors of an angle are computed once and reused in all the iterations; the tables stop
+// growing at the memory budget, the factors of the other angles are computed slice by slice.
+// The sensitivity images of the subsets (attenuated backprojection of ones, the normalization of
+// the OSEM update) are kept with the factors, in the same budget.
+class AttenuationTables {
+
+public:
+
+  AttenuationTables() : dim(0), budget(0), memory(0), stepLength(0.0f) {}
+
+  void reset( unsigned int _dim, size_t _budget );    // budget in bytes, clears the map and the tables
+  void clear( void );                                 // clears the tables only
+
+  // mu in cm-1 on the reconstruction grid (main memory), pixelSize in METER
+  // the tables are kept when the map and the pixel size didn't change
+  void setMap( const Volume& muMap, float pixelSize );
+  void clearMap( void ) { mu.clear(); clear(); }
+  bool hasMap( void ) const { return !mu.empty(); }
+
+  // factors of the angle, 0 if they aren't stored
+  const float* find( float angle ) const;
+
+  // computes and stores the factors of the angle if the budget allows it
+  const float* store( float angle, const int* samplingMap, const int* backProjectionMap, unsigned int nbThreads,
+                      THREADutils::WorkerPool* workers = 0 );
+
+  // sensitivity of the subset of these angles, 0 if it isn't stored
+  const float* findSensitivity( const std::vector<float>& angles, bool convolve ) const;
+
+  // storage (dim x dim x dim) of the sensitivity of the subset if the budget allows it, else 0
+  float* storeSensitivity( const std::vector<float>& angles, bool convolve );
+
+  // factors of all the slices, computed by nbThreads threads (the workers of the backend)
+  void compute( const int* samplingMap, const int* backProjectionMap, float* factors, unsigned int nbThreads,
+                THREADutils::WorkerPool* workers = 0 );
+
+  // factors of the slice z (dim x dim), sums is a scratch of dim x dim + dim values
+  void computeSlice( unsigned int z, const int* samplingMap, const int* backProjectionMap, float* factors, float* sums ) const;
+
+  size_t getMemory( void ) const { return memory; }
+  size_t getBudget( void ) const { return budget; }
+
+protected:
+
+  struct SliceContext {
+    AttenuationTables* tables;
+    const int* samplingMap;
+    const int* backProjectionMap;
+    float* factors;
+    unsigned int nbThreads;
+  };
+
+  static void computeSlices( unsigned int begin, unsigned int end, void* context );
+
+  unsigned int dim;
+  size_t budget;
+  size_t memory;
+  float stepLength;                 // voxel length in cm
+  std::vector<float> mu;
+  std::map< float, std::vector<float> > tables;
+  std::map< std::vector<float>, std::vector<float> > sensitivities[2];   // by angles, without and with the PSF
+  std::vector< std::vector<float> > rangeSums;   // scratch of computeSlice for each range of compute(), kept for the next calls
+};
+
+
+} // end namespace GPURec
+
+#endif  // _ATTENUATIONTABLES_H
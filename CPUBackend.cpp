@@ -0,0 +1,1067 @@
+
+#include "common.h"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CPUBACKEND_SSE2 1
+#endif
+
+#include "CPUBackend.h"
+#include "Volume.h"
+#include "VolumeProjectionSet.h"
+#include "PSFCache.h"
+#include "THREADutils.h"
+#include "MEMutils.h"
+#include "DBGutils.h"
+
+using namespace GPURec;
+
+
+// measured / estimated, the measured projection is float or uint16 counts
+template<class T>
+static void divideProjection( const T* measured, const float* estimated, float* result, unsigned int size ) {
+
+  for( unsigned int i = 0; i < size; i++ )
+    result[i] = measured[i] / std::max( estimated[i], 0.1f );
+}
+
+
+// contexts shared by the threads of a parallel loop
+struct ProjectionContext {
+
+  const CPUBackend* backend;
+  const float* volume;
+  const CPUBackend::MapRef* samplingMap;
+  const float* attenuation;                          // factors of the angle, 0 without attenuation
+  bool convolve;
+  unsigned int firstSample;                          // lines sampled: the slab and its halo
+  unsigned int nbSamples;
+  unsigned int firstLine;                            // lines accumulated: the slab
+  unsigned int nbLines;
+  unsigned int nbChunks;
+  std::vector<CPUBackend::ThreadScratch>* scratch;   // one partial projection per chunk of planes
+};
+
+struct BackProjectionContext {
+
+  const CPUBackend* backend;
+  std::vector<CPUBackend::ThreadScratch>* scratch;   // indexed by the range of the thread
+  unsigned int nbProjections;
+  const float* const* projections;                   // the ratios of the subset
+  const CPUBackend::MapRef* backProjectionMaps;      // one map per projection of the subset
+  const int* fullBackProjectionMaps;                 // the same maps decoded, with attenuation only
+  const float* const* attenuation;                   // stored factors of each projection, 0 if they aren't stored (0 without attenuation)
+  const int* samplingMaps;                           // maps of the projections whose factors are computed slice by slice
+  bool convolve;
+  unsigned int firstSlice;                           // slice of backProjection[0]
+  unsigned int nbSlices;
+  unsigned int nbThreads;
+  float* backProjection;
+};
+
+struct UpdateContext {
+
+  float* volume;
+  const float* backProjection;
+  const float* sensitivity;                          // 0: normalizationFactor
+  float normalizationFactor;
+  unsigned int sliceSize;
+};
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  INITIALIZATION
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+CPUBackend::CPUBackend( const ReconstructionContext& _context ) : ReconstructionBackend( _context ) {
+
+  dim = 0;
+  pixelSize = 0.0f;
+  useFFTConvolution = false;
+  crossoverRadius = 0.0f;
+  quarterTurnSymmetry = false;
+  symmetryStartAngle = 0.0f;
+  symmetryIncrement = 0.0f;
+  quarterSteps = 0;
+  slabSize = 0;
+  pendingRatios = 0;
+  pendingFirstProjection = 0;
+  pendingStep = 1;
+  pendingConvolve = false;
+  sensitivity = 0;
+  nbThreads = context.nbThreads ? context.nbThreads : THREADutils::getNbHardwareThreads();
+  std::vector<unsigned int> cores;
+  if( context.pinThreads )
+    THREADutils::getAllowedCores( cores );
+  workers = new THREADutils::WorkerPool( nbThreads, &cores );
+}
+
+
+void CPUBackend::reset( unsigned int _dim, float _pixelSize ) {
+
+  unsigned int slices = ( context.slabSlices && context.slabSlices < _dim ) ? context.slabSlices : _dim;
+  if( slices < _dim && ( !context.attenuationMap.empty() || context.distributedMode != NO_DISTRIBUTION ) ) {
+    std::cerr << "The slabs can't be used with an attenuation map or a distributed reconstruction" << std::endl;
+    throw std::exception();
+  }
+
+  // the sensitivity of a subset is computed by the worker from its own share of the angles
+  if( !context.attenuationMap.empty() && context.distributedMode != NO_DISTRIBUTION ) {
+    std::cerr << "The attenuation map can't be used by a distributed reconstruction" << std::endl;
+    throw std::exception();
+  }
+  pendingRatios = 0;
+  sensitivity = 0;
+
+  // same geometry and camera (next scan, daemon job): the PSF tables, the crossover and the
+  // sampling maps are kept, only the results of the previous reconstruction are cleared
+  if( dim == _dim && pixelSize == _pixelSize && key == PSFKey( _dim, _pixelSize, context )
+      && samplingTables.getBudget() == (size_t)context.samplingTablesMemory * 1024 * 1024
+      && attenuationTables.getBudget() == (size_t)context.attenuationTablesMemory * 1024 * 1024 && slabSize == slices ) {
+  
+    std::fill( estimate.begin(), estimate.end(), 0.0f );
+    THREADutils::fill( &backProjection[0], slabSize, dim * dim, 0.0f, nbThreads, workers );
+    loadAttenuationMap();
+    allocateScratch();
+    return;
+  }
+
+  terminate();
+
+  dim = _dim;
+  pixelSize = _pixelSize;
+  key = PSFKey( dim, pixelSize, context );
+  psf = PSFCache::getPSF( key );
+  fftConvolution.compute( psf );
+  recursiveGaussian.compute( psf, RECURSIVE_GAUSSIAN_MIN_SIGMA );
+  samplingTables.reset( dim, (size_t)context.samplingTablesMemory * 1024 * 1024 );
+  attenuationTables.reset( dim, (size_t)context.attenuationTablesMemory * 1024 * 1024 );
+  quarterTurnSymmetry = false;
+  measureConvolutionCrossover();
+  slabSize = slices;
+  estimate.assign( dim * dim, 0.0f );
+  backProjection.allocate( slabSize, dim * dim, 0.0f, nbThreads, workers );
+  loadAttenuationMap();
+  allocateScratch();
+
+  std::cout << "CPU backend: " << nbThreads << " threads" << std::endl;
+  if( slabSize < dim )
+    std::cout << "CPU backend: slabs of " << slabSize << " slices" << std::endl;
+}
+
+
+size_t CPUBackend::estimateMemory( unsigned int dim, float pixelSize, unsigned int nbProjections, const ReconstructionContext& context ) {
+
+  unsigned int nbThreads = context.nbThreads ? context.nbThreads : THREADutils::getNbHardwareThreads();
+  
+  const GaussianPSF& psf = PSFCache::getPSF( PSFKey( dim, pixelSize, context ) );
+  size_t planeSize = (size_t)dim * dim;
+  size_t subsetSize = ( nbProjections + context.nbSubsets - 1 ) / context.nbSubsets;
+  
+  // estimate, backprojection (one slab) and the scratch of the threads: partial projection, plane and buffer
+  unsigned int slabSize = ( context.slabSlices && context.slabSlices < dim ) ? context.slabSlices : dim;
+  size_t memory = ( planeSize + planeSize * slabSize + 3 * nbThreads * planeSize ) * sizeof(float);
+  
+  // PSF coefficients and sigmas, FFT spectra of the kernels, recursive gaussian coefficients
+  memory += dim * ( psf.getRadius() + 2 ) * sizeof(float);
+  memory += dim * FFTutils::nextPowerOf2( dim + 2 * psf.getRadius() ) * sizeof(float);
+  memory += dim * 4 * sizeof(double);
+  
+  // sampling tables: one map of each kind per angle, up to the budget
+  size_t tables = 2 * nbProjections * dim * ( sizeof(int) + dim * sizeof(short) );
+  memory += std::min( tables, (size_t)context.samplingTablesMemory * 1024 * 1024 );
+  
+  // backprojection maps of a subset, FDR spectrum and blurred ratios of a subset
+  memory += subsetSize * planeSize * sizeof(int);
+  if( context.psfModel == FDR_PSF )
+    memory += subsetSize * planeSize * ( sizeof(FFTutils::Complex) + sizeof(float) ) + dim * subsetSize * sizeof(float);
+  
+  // mu map, attenuation factors and sensitivities up to the budget, factors of a projection, sensitivity of a subset,
+  // sampling maps of a subset and the slice factors of the threads with their prefix sums
+  if( !context.attenuationMap.empty() ) {
+  
+    size_t factors = ( nbProjections + context.nbSubsets ) * planeSize * dim * sizeof(float);
+    memory += planeSize * dim * sizeof(float) + std::min( factors, (size_t)context.attenuationTablesMemory * 1024 * 1024 );
+    memory += 2 * planeSize * dim * sizeof(float) + subsetSize * planeSize * sizeof(int);
+    memory += ( 3 * nbThreads + 1 ) * ( planeSize + dim ) * sizeof(float);
+  }
+  
+  return memory;
+}
+
+
+void CPUBackend::loadAttenuationMap( void ) {
+
+  if( context.attenuationMap.empty() ) {
+    attenuationTables.clearMap();
+    return;
+  }
+
+  Volume muMap;
+  muMap.loadFromRAW( dim, context.attenuationMap );
+  attenuationTables.setMap( muMap, pixelSize );
+}
+
+
+void CPUBackend::terminate( void ) {
+
+  dim = 0;
+  psf.clear();
+  fdr.clear();
+  fftConvolution.clear();
+  recursiveGaussian.clear();
+  samplingTables.clear();
+  attenuationTables.clearMap();
+  useFFTConvolution = false;
+  std::vector<float>().swap( estimate );
+  backProjection.clear();
+  sensitivity = 0;
+  std::vector<float>().swap( sensitivityBuffer );
+  std::vector<ThreadScratch>().swap( scratch );
+  std::vector<int>().swap( samplingMapBuffer );
+  std::vector<int>().swap( backProjectionMapBuffer );
+  std::vector<int>().swap( samplingIndices );
+  std::vector<int>().swap( backProjectionIndices );
+  std::vector<float>().swap( attenuationBuffer );
+  std::vector<float>().swap( blurredRatios );
+  std::vector< std::vector<int> >().swap( subsetMapBuffers );
+  std::vector<int>().swap( subsetFullMaps );
+  std::vector<int>().swap( subsetSamplingMaps );
+  std::vector<float>().swap( ones );
+  
+  // the staging buffers of the previous geometry are not reused
+  MEMutils::clear();
+}
+
+
+// each thread touches its own scratch first: its pages are placed on the node of its core
+void CPUBackend::allocateScratch( void ) {
+
+  scratch.resize( nbThreads );
+  THREADutils::parallelFor( 0, nbThreads, allocateThreadScratch, this, nbThreads, workers );
+  ones.assign( attenuationTables.hasMap() ? dim * dim : 0, 1.0f );
+}
+
+
+void CPUBackend::allocateThreadScratch( unsigned int begin, unsigned int end, void* context ) {
+
+  CPUBackend* backend = (CPUBackend*)context;
+  unsigned int planeSize = backend->dim * backend->dim;
+
+  for( unsigned int t = begin; t < end; t++ ) {
+
+    ThreadScratch& threadScratch = backend->scratch[t];
+    threadScratch.accumulator.resize( planeSize );
+    threadScratch.plane.resize( planeSize );
+    threadScratch.buffer.resize( planeSize );
+    threadScratch.work.resize( backend->fftConvolution.getWorkSize() );
+    threadScratch.sliceFactors.resize( backend->attenuationTables.hasMap() ? planeSize : 0 );
+    threadScratch.attenuationSums.resize( backend->attenuationTables.hasMap() ? planeSize + backend->dim : 0 );
+    threadScratch.mapLine.resize( backend->dim );
+  }
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  TRANSFERS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+// the volume data in main memory is always up to date
+void CPUBackend::uploadVolume( Volume& volume ) {
+
+  assert( volume.getDim() == dim );
+}
+
+
+void CPUBackend::downloadVolume( Volume& volume ) {
+
+  volume.computeMaxValue();
+}
+
+
+// projections only loaded in graphic memory (RAW files, phantoms) are copied back once
+void CPUBackend::uploadProjections( VolumeProjectionSet& projSet ) {
+
+  assert( projSet.getDim() == dim );
+
+  if( !projSet.hasData() && !projSet.hasCountData() )
+    projSet.retrieveFromGraphicMemory();
+    
+  // the angles p and p + 90/increment share their sampling maps
+  double quarterTurns = ( M_PI / 2 ) / projSet.getRotationIncrement();
+  quarterSteps = (int)floor( fabs( quarterTurns ) + 0.5 );
+  quarterTurnSymmetry = quarterSteps > 0 && fabs( fabs( quarterTurns ) - quarterSteps ) < 1e-3;
+  symmetryStartAngle = projSet.getAngle( 0 );
+  symmetryIncrement = projSet.getRotationIncrement();
+}
+
+
+void CPUBackend::downloadProjections( VolumeProjectionSet& projSet ) {
+
+  assert( projSet.hasData() || projSet.hasCountData() );
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  KERNELS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+// a point (u,v) of the plane v is rotated around the volume axis, like the texture coordinates of the GL path
+void CPUBackend::computeSamplingMap( float angle, int* map ) const {
+
+  float c = (dim - 1) / 2.0f;
+  float cosAngle = cos( angle );
+  float sinAngle = sin( angle );
+
+  for( unsigned int v = 0; v < dim; v++ )
+  for( unsigned int u = 0; u < dim; u++ ) {
+
+    float x = c + cosAngle * (u - c) - sinAngle * (v - c);
+    float y = c + sinAngle * (u - c) + cosAngle * (v - c);
+
+    // nearest voxel, the points outside the volume are clipped
+    int i = (int)floor( x + 0.5f );
+    int j = (int)floor( y + 0.5f );
+    map[ u + v*dim ] = ( i >= 0 && i < (int)dim && j >= 0 && j < (int)dim ) ? i + j*dim : -1;
+  }
+}
+
+
+// inverse rotation of computeSamplingMap
+void CPUBackend::computeBackProjectionMap( float angle, int* map ) const {
+
+  float c = (dim - 1) / 2.0f;
+  float cosAngle = cos( angle );
+  float sinAngle = sin( angle );
+
+  for( unsigned int j = 0; j < dim; j++ )
+  for( unsigned int i = 0; i < dim; i++ ) {
+
+    float u = c + cosAngle * (i - c) + sinAngle * (j - c);
+    float v = c - sinAngle * (i - c) + cosAngle * (j - c);
+
+    int uNum = (int)floor( u + 0.5f );
+    int vNum = (int)floor( v + 0.5f );
+    map[ i + j*dim ] = ( uNum >= 0 && uNum < (int)dim && vNum >= 0 && vNum < (int)dim ) ? uNum + vNum*dim : -1;
+  }
+}
+
+
+void CPUBackend::splitQuarterTurns( float angle, float& baseAngle, unsigned int& nbTurns ) const {
+
+  baseAngle = angle;
+  nbTurns = 0;
+
+  double steps = floor( ( angle - symmetryStartAngle ) / symmetryIncrement + 0.5 );
+  if( fabs( angle - ( symmetryStartAngle + steps * symmetryIncrement ) ) > 1e-3 * fabs( symmetryIncrement ) )
+    return;
+
+  // the base angle is computed the same way for all the quadrants: its maps are found in the tables
+  long turns = (long)floor( steps / quarterSteps );
+  long baseSteps = (long)steps - turns * quarterSteps;
+  baseAngle = symmetryStartAngle + baseSteps * symmetryIncrement;
+
+  // quarterSteps increments turn by +90 degrees, or by -90 degrees with a negative increment
+  long signedTurns = ( symmetryIncrement > 0 ) ? turns : -turns;
+  nbTurns = (unsigned int)( ( signedTurns % 4 + 4 ) % 4 );
+}
+
+
+// destination[u + v*dim] = source[(dim-1-v) + u*dim]: the sampling map of the angle + 90 degrees
+// the 4x4 blocks of the source are transposed in registers and written in reversed line order
+static void rotateQuarterTurn( const int* source, int* destination, unsigned int dim ) {
+
+  unsigned int u0 = 0;
+#ifdef CPUBACKEND_SSE2
+  if( dim % 4 == 0 ) {
+
+    for( ; u0 < dim; u0 += 4 )
+    for( unsigned int w0 = 0; w0 < dim; w0 += 4 ) {
+
+      __m128 row0 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)( source + w0 + (u0+0)*dim ) ) );
+      __m128 row1 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)( source + w0 + (u0+1)*dim ) ) );
+      __m128 row2 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)( source + w0 + (u0+2)*dim ) ) );
+      __m128 row3 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)( source + w0 + (u0+3)*dim ) ) );
+      _MM_TRANSPOSE4_PS( row0, row1, row2, row3 );
+
+      // line k of the transposed block is the column w0+k of the source: the line dim-1-(w0+k) of the destination
+      _mm_storeu_si128( (__m128i*)( destination + u0 + (dim-1-w0)*dim ), _mm_castps_si128( row0 ) );
+      _mm_storeu_si128( (__m128i*)( destination + u0 + (dim-2-w0)*dim ), _mm_castps_si128( row1 ) );
+      _mm_storeu_si128( (__m128i*)( destination + u0 + (dim-3-w0)*dim ), _mm_castps_si128( row2 ) );
+      _mm_storeu_si128( (__m128i*)( destination + u0 + (dim-4-w0)*dim ), _mm_castps_si128( row3 ) );
+    }
+  }
+#endif
+
+  for( ; u0 < dim; u0++ )
+  for( unsigned int v = 0; v < dim; v++ )
+    destination[ u0 + v*dim ] = source[ (dim-1-v) + u0*dim ];
+}
+
+
+CPUBackend::MapRef CPUBackend::getSamplingMap( float angle, std::vector<int>& buffer ) {
+
+  float baseAngle = angle;
+  unsigned int nbTurns = 0;
+  if( quarterTurnSymmetry )
+    splitQuarterTurns( angle, baseAngle, nbTurns );
+
+  MapRef ref;
+  ref.table = samplingTables.find( baseAngle, SamplingTables::PROJECTION_MAP );
+  ref.indices = 0;
+  ref.nbTurns = 0;
+  if( ref.table && nbTurns == 0 ) return ref;
+
+  // the rotations ping-pong between the two halves of the buffer and end in the first one
+  buffer.resize( ( nbTurns ? 2 : 1 ) * dim * dim );
+  int* map = &buffer[0];
+  int* rotated = map + ( nbTurns ? dim * dim : 0 );
+  int* baseMap = ( nbTurns % 2 ) ? rotated : map;
+
+  if( ref.table )
+    samplingTables.decode( *ref.table, baseMap );
+  else {
+    computeSamplingMap( baseAngle, baseMap );
+    samplingTables.store( baseAngle, SamplingTables::PROJECTION_MAP, baseMap );
+  }
+
+  int* source = baseMap;
+  for( unsigned int turn = 0; turn < nbTurns; turn++ ) {
+
+    int* destination = ( source == map ) ? rotated : map;
+    rotateQuarterTurn( source, destination, dim );
+    source = destination;
+  }
+
+  ref.table = 0;
+  ref.indices = map;
+  return ref;
+}
+
+
+// a quarter turn moves the projection point (u,v) of a voxel to (v, dim-1-u)
+void CPUBackend::rotatePoints( int* points, unsigned int nbPoints, unsigned int nbTurns ) const {
+
+  for( unsigned int voxel = 0; voxel < nbPoints; voxel++ ) {
+
+    if( points[voxel] < 0 ) continue;
+
+    int u = points[voxel] % dim;
+    int v = points[voxel] / dim;
+    for( unsigned int turn = 0; turn < nbTurns; turn++ ) {
+      int previousU = u;
+      u = v;
+      v = dim - 1 - previousU;
+    }
+    points[voxel] = u + v*dim;
+  }
+}
+
+
+// the stored maps of the other quadrants have their points rotated line by line by getMapLine
+CPUBackend::MapRef CPUBackend::getBackProjectionMap( float angle, std::vector<int>& buffer ) {
+
+  float baseAngle = angle;
+  unsigned int nbTurns = 0;
+  if( quarterTurnSymmetry )
+    splitQuarterTurns( angle, baseAngle, nbTurns );
+
+  MapRef ref;
+  ref.table = samplingTables.find( baseAngle, SamplingTables::BACKPROJECTION_MAP );
+  ref.indices = 0;
+  ref.nbTurns = nbTurns;
+  if( ref.table ) return ref;
+
+  buffer.resize( dim * dim );
+  computeBackProjectionMap( baseAngle, &buffer[0] );
+  samplingTables.store( baseAngle, SamplingTables::BACKPROJECTION_MAP, &buffer[0] );
+  if( nbTurns ) rotatePoints( &buffer[0], dim * dim, nbTurns );
+
+  ref.indices = &buffer[0];
+  ref.nbTurns = 0;
+  return ref;
+}
+
+
+const int* CPUBackend::getMapLine( const MapRef& map, unsigned int l, int* buffer ) const {
+
+  if( map.indices ) return map.indices + l*dim;
+
+  const int* line = samplingTables.getLine( *map.table, l, buffer );
+  if( map.nbTurns == 0 ) return line;
+
+  if( line != buffer ) std::copy( line, line + dim, buffer );
+  rotatePoints( buffer, dim, map.nbTurns );
+  return buffer;
+}
+
+
+void CPUBackend::copyMap( const MapRef& map, int* destination ) const {
+
+  for( unsigned int l = 0; l < dim; l++ ) {
+
+    const int* line = getMapLine( map, l, destination + l*dim );
+    if( line != destination + l*dim ) std::copy( line, line + dim, destination + l*dim );
+  }
+}
+
+
+void CPUBackend::convolvePlane( float* image, float* buffer, unsigned int nbLines, unsigned int planeNum, FFTutils::Complex* work ) const {
+
+  if( recursiveGaussian.isUsed( planeNum ) )
+    recursiveGaussian.convolvePlane( image, nbLines, planeNum, buffer );
+  else if( useFFTConvolution )
+    fftConvolution.convolvePlane( image, nbLines, planeNum, work );
+  else
+    convolvePlaneDirect( image, buffer, nbLines, planeNum );
+}
+
+
+// each convolution of the crossover measure is repeated for this time at least (seconds)
+static const double CROSSOVER_MIN_TIME = 1e-3;
+static const unsigned int CROSSOVER_MAX_RUNS = 100000;
+
+
+// the direct convolution costs O(radius) per pixel, the FFT one O(log(dim + 2 radius)):
+// the crossover radius follows from the linear cost of the direct convolution
+// a measure shorter than CROSSOVER_MIN_TIME (clock failure) keeps the direct convolution
+void CPUBackend::measureConvolutionCrossover( void ) {
+
+  useFFTConvolution = false;
+  crossoverRadius = 0.0f;
+  if( psf.getRadius() == 0 ) return;
+
+  std::vector<float> image( dim * dim, 1.0f );
+  std::vector<float> buffer( dim * dim );
+  std::vector<FFTutils::Complex> work( fftConvolution.getWorkSize() );
+
+  double directTime = timeConvolution( false, &image[0], &buffer[0], &work[0] );
+  double fftTime = timeConvolution( true, &image[0], &buffer[0], &work[0] );
+  if( directTime > 0.0 && fftTime > 0.0 ) {
+    crossoverRadius = psf.getRadius() * (float)( fftTime / directTime );
+    useFFTConvolution = psf.getRadius() > crossoverRadius;
+  }
+
+  std::cout << "CPU PSF convolution: " << ( useFFTConvolution ? "FFT" : "direct" )
+            << " (radius " << psf.getRadius() << ", crossover radius " << crossoverRadius
+            << ", plane convolution " << directTime * 1e3 << " ms direct, " << fftTime * 1e3 << " ms FFT)" << std::endl;
+}
+
+
+// mean time of a convolution of the farthest plane, 0 if the runs stay shorter than CROSSOVER_MIN_TIME
+double CPUBackend::timeConvolution( bool fft, float* image, float* buffer, FFTutils::Complex* work ) const {
+
+  unsigned int nbRuns = 0;
+  double start = DBGutils::getTime();
+  double elapsed = 0.0;
+  while( elapsed < CROSSOVER_MIN_TIME && nbRuns < CROSSOVER_MAX_RUNS ) {
+
+    if( fft )
+      fftConvolution.convolvePlane( image, dim, dim-1, work );
+    else
+      convolvePlaneDirect( image, buffer, dim, dim-1 );
+    nbRuns++;
+    elapsed = DBGutils::getTime() - start;
+  }
+
+  return ( elapsed >= CROSSOVER_MIN_TIME ) ? elapsed / nbRuns : 0.0;
+}
+
+
+// separable convolution with clamp to edge, horizontal (u) then vertical (z)
+void CPUBackend::convolvePlaneDirect( float* image, float* buffer, unsigned int nbLines, unsigned int planeNum ) const {
+
+  int radius = psf.getRadius();
+  int last = dim - 1;
+  int lastLine = nbLines - 1;
+  const float* coefs = psf.getCoefs( planeNum );
+
+  for( int z = 0; z <= lastLine; z++ ) {
+
+    const float* line = image + z*dim;
+    for( int u = 0; u <= last; u++ ) {
+
+      float sum = coefs[0] * line[u];
+      for( int k = 1; k <= radius; k++ )
+        sum += coefs[k] * ( line[ std::min( u+k, last ) ] + line[ std::max( u-k, 0 ) ] );
+      buffer[ u + z*dim ] = sum;
+    }
+  }
+
+  for( int z = 0; z <= lastLine; z++ )
+  for( int u = 0; u <= last; u++ ) {
+
+    float sum = coefs[0] * buffer[ u + z*dim ];
+    for( int k = 1; k <= radius; k++ )
+      sum += coefs[k] * ( buffer[ u + std::min( z+k, lastLine )*dim ] + buffer[ u + std::max( z-k, 0 )*dim ] );
+    image[ u + z*dim ] = sum;
+  }
+}
+
+
+// each chunk of planes is accumulated in its own partial projection
+// the plane image holds the sampled lines only, its line 0 is the line firstSample of the projection
+void CPUBackend::projectPlanes( unsigned int begin, unsigned int end, void* context ) {
+
+  ProjectionContext* ctx = (ProjectionContext*)context;
+  unsigned int dim = ctx->backend->dim;
+
+  CPUBackend::ThreadScratch& threadScratch = (*ctx->scratch)[begin];
+  float* plane = &threadScratch.plane[0];
+  int* mapLine = &threadScratch.mapLine[0];
+
+  for( unsigned int chunk = begin; chunk < end; chunk++ ) {
+
+    float* accumulator = &(*ctx->scratch)[chunk].accumulator[ ctx->firstLine * dim ];
+    std::fill( accumulator, accumulator + ctx->nbLines * dim, 0.0f );
+    const float* lines = plane + ( ctx->firstLine - ctx->firstSample ) * dim;
+
+    for( unsigned int v = chunk * dim / ctx->nbChunks; v < (chunk+1) * dim / ctx->nbChunks; v++ ) {
+
+      // sample the plane v: line z of the plane is in the slice z of the volume
+      const int* planeMap = ctx->backend->getMapLine( *ctx->samplingMap, v, mapLine );
+      for( unsigned int z = ctx->firstSample; z < ctx->firstSample + ctx->nbSamples; z++ ) {
+
+        const float* slice = ctx->volume + z*dim*dim;
+        float* line = plane + ( z - ctx->firstSample ) * dim;
+        if( ctx->attenuation ) {
+
+          const float* factors = ctx->attenuation + z*dim*dim;
+          for( unsigned int u = 0; u < dim; u++ )
+            line[u] = ( planeMap[u] >= 0 ) ? slice[ planeMap[u] ] * factors[ planeMap[u] ] : 0.0f;
+          continue;
+        }
+
+        for( unsigned int u = 0; u < dim; u++ )
+          line[u] = ( planeMap[u] >= 0 ) ? slice[ planeMap[u] ] : 0.0f;
+      }
+
+      if( ctx->convolve )
+        ctx->backend->convolvePlane( plane, &threadScratch.buffer[0], ctx->nbSamples, v, threadScratch.work.empty() ? 0 : &threadScratch.work[0] );
+
+      for( unsigned int i = 0; i < ctx->nbLines * dim; i++ )
+        accumulator[i] += lines[i];
+    }
+  }
+}
+
+
+void CPUBackend::project( const Volume& volume, float angle, bool convolve ) {
+
+  projectSlab( volume, angle, convolve, 0, dim );
+}
+
+
+// the halo is clamped to the volume like the convolution: the lines of a slab are the ones of the whole projection
+// (the recursive gaussian of the far planes restarts at the halo edges)
+void CPUBackend::projectSlab( const Volume& volume, float angle, bool convolve, unsigned int firstSlice, unsigned int nbSlices ) {
+
+  assert( volume.getDim() == dim );
+  DBGutils::timerBegin("CPU Projection");
+
+  MapRef samplingMap = getSamplingMap( angle, samplingMapBuffer );
+  const float* attenuation = getAttenuation( angle, samplingMap, attenuationBuffer );
+
+  // the chunks and their summation order only depend on the number of threads
+
+  ProjectionContext loopContext;
+  loopContext.backend = this;
+  loopContext.volume = volume.getData();
+  loopContext.samplingMap = &samplingMap;
+  loopContext.attenuation = attenuation;
+  loopContext.convolve = convolve;
+  unsigned int halo = convolve ? psf.getRadius() : 0;
+  loopContext.firstSample = ( firstSlice > halo ) ? firstSlice - halo : 0;
+  loopContext.nbSamples = std::min( firstSlice + nbSlices + halo, dim ) - loopContext.firstSample;
+  loopContext.firstLine = firstSlice;
+  loopContext.nbLines = nbSlices;
+  loopContext.nbChunks = nbThreads;
+  loopContext.scratch = &scratch;
+  THREADutils::parallelFor( 0, nbThreads, projectPlanes, &loopContext, nbThreads, workers );
+
+  std::fill( estimate.begin(), estimate.end(), 0.0f );
+  for( unsigned int chunk = 0; chunk < nbThreads; chunk++ )
+  for( unsigned int i = firstSlice * dim; i < ( firstSlice + nbSlices ) * dim; i++ )
+    estimate[i] += scratch[chunk].accumulator[i];
+
+  DBGutils::timerEnd("CPU Projection");
+}
+
+
+const float* CPUBackend::getAttenuation( float angle, const MapRef& samplingMap, std::vector<float>& buffer ) {
+
+  if( !attenuationTables.hasMap() ) return 0;
+
+  const float* factors = attenuationTables.find( angle );
+  if( factors ) return factors;
+
+  // the attenuation tables take the whole maps
+  samplingIndices.resize( dim * dim );
+  copyMap( samplingMap, &samplingIndices[0] );
+  backProjectionIndices.resize( dim * dim );
+  copyMap( getBackProjectionMap( angle, backProjectionMapBuffer ), &backProjectionIndices[0] );
+
+  factors = attenuationTables.store( angle, &samplingIndices[0], &backProjectionIndices[0], nbThreads, workers );
+  if( factors ) return factors;
+
+  buffer.resize( dim * dim * dim );
+  attenuationTables.compute( &samplingIndices[0], &backProjectionIndices[0], &buffer[0], nbThreads, workers );
+  return &buffer[0];
+}
+
+
+void CPUBackend::ratio( const VolumeProjectionSet& scan, VolumeProjectionSet& ratios, unsigned int projNum ) {
+
+  if( scan.hasCountData() )
+    divideProjection( scan.getCountData( projNum ), &estimate[0], ratios.getData( projNum ), dim * dim );
+  else
+    divideProjection( scan.getData( projNum ), &estimate[0], ratios.getData( projNum ), dim * dim );
+}
+
+
+void CPUBackend::prepareFDR( const VolumeProjectionSet& projSet, unsigned int firstProjection, unsigned int step ) {
+
+  unsigned int nbAngles = ( projSet.getNbProjection() - firstProjection + step - 1 ) / step;
+  float angleIncrement = projSet.getRotationIncrement() * step;
+
+  if( !fdr.matches( key, nbAngles, angleIncrement ) )
+    fdr.compute( key, nbAngles, angleIncrement );
+}
+
+
+// slabs: the lines of a slab are estimated for all the projections of the subset before the next slab,
+// then the slices of the slab and of its halo are released
+// FDR: the estimated projections of the subset are blurred together before the division
+void CPUBackend::projectSubset( const Volume& volume, const VolumeProjectionSet& scan, VolumeProjectionSet& ratios,
+                                unsigned int firstProjection, unsigned int step, bool convolve ) {
+
+  bool useFDR = convolve && context.psfModel == FDR_PSF;
+  if( !useFDR && slabSize == dim ) {
+    ReconstructionBackend::projectSubset( volume, scan, ratios, firstProjection, step, convolve );
+    return;
+  }
+
+  if( useFDR )
+    prepareFDR( scan, firstProjection, step );
+
+  // with FDR the ratios set holds the estimated projections until the division
+  unsigned int halo = ( convolve && !useFDR ) ? psf.getRadius() : 0;
+  for( unsigned int firstSlice = 0; firstSlice < dim; firstSlice += slabSize ) {
+
+    unsigned int nbSlices = std::min( slabSize, dim - firstSlice );
+    unsigned int first = firstSlice * dim;
+    for( unsigned int p = firstProjection; p < scan.getNbProjection(); p += step ) {
+
+      projectSlab( volume, scan.getAngle( p ), convolve && !useFDR, firstSlice, nbSlices );
+      if( useFDR )
+        std::copy( &estimate[first], &estimate[first] + nbSlices * dim, ratios.getData( p ) + first );
+      else if( scan.hasCountData() )
+        divideProjection( scan.getCountData( p ) + first, &estimate[first], ratios.getData( p ) + first, nbSlices * dim );
+      else
+        divideProjection( scan.getData( p ) + first, &estimate[first], ratios.getData( p ) + first, nbSlices * dim );
+    }
+
+    unsigned int firstSample = ( firstSlice > halo ) ? firstSlice - halo : 0;
+    volume.releaseSlices( firstSample, std::min( firstSlice + nbSlices + halo, dim ) - firstSample );
+  }
+
+  if( !useFDR ) return;
+
+  fdrProjections.clear();
+  for( unsigned int p = firstProjection; p < scan.getNbProjection(); p += step )
+    fdrProjections.push_back( ratios.getData( p ) );
+
+  fdr.apply( &fdrProjections[0], nbThreads, workers );
+
+  for( unsigned int p = firstProjection; p < scan.getNbProjection(); p += step ) {
+
+    if( scan.hasCountData() )
+      divideProjection( scan.getCountData( p ), ratios.getData( p ), ratios.getData( p ), dim * dim );
+    else
+      divideProjection( scan.getData( p ), ratios.getData( p ), ratios.getData( p ), dim * dim );
+  }
+}
+
+
+// each thread backprojects all the projections of the subset in its own slices
+void CPUBackend::backProjectSlices( unsigned int begin, unsigned int end, void* context ) {
+
+  BackProjectionContext* ctx = (BackProjectionContext*)context;
+  const CPUBackend* backend = ctx->backend;
+  unsigned int dim = backend->dim;
+  int radius = backend->psf.getRadius();
+  int last = dim - 1;
+
+  // convolved lines of the slice: one line per plane v
+  CPUBackend::ThreadScratch& threadScratch = (*ctx->scratch)[ THREADutils::getRangeIndex( ctx->firstSlice, ctx->firstSlice + ctx->nbSlices, begin, ctx->nbThreads ) ];
+  float* lines = &threadScratch.plane[0];
+  float* convolvedLines = &threadScratch.buffer[0];
+  FFTutils::Complex* work = threadScratch.work.empty() ? 0 : &threadScratch.work[0];
+  float* sliceFactors = threadScratch.sliceFactors.empty() ? 0 : &threadScratch.sliceFactors[0];
+  float* attenuationSums = threadScratch.attenuationSums.empty() ? 0 : &threadScratch.attenuationSums[0];
+  int* mapLine = &threadScratch.mapLine[0];
+
+  for( unsigned int z = begin; z < end; z++ ) {
+
+    float* slice = ctx->backProjection + ( z - ctx->firstSlice )*dim*dim;
+    std::fill( slice, slice + dim*dim, 0.0f );
+
+    for( unsigned int i = 0; i < ctx->nbProjections; i++ ) {
+
+      const float* projection = ctx->projections[i];
+      const CPUBackend::MapRef& mapRef = ctx->backProjectionMaps[i];
+
+      // attenuation factors of the slice, the same as the projector
+      const float* factors = 0;
+      if( ctx->attenuation ) {
+
+        factors = ctx->attenuation[i] ? ctx->attenuation[i] + z*dim*dim : sliceFactors;
+        if( !ctx->attenuation[i] )
+          backend->attenuationTables.computeSlice( z, ctx->samplingMaps + i * dim * dim, ctx->fullBackProjectionMaps + i * dim * dim, sliceFactors, attenuationSums );
+      }
+
+      // the map is read line by line (voxels of the line j of the slice)
+      if( !ctx->convolve ) {
+
+        const float* line = projection + z*dim;
+        for( unsigned int j = 0; j < dim; j++ ) {
+
+          const int* map = backend->getMapLine( mapRef, j, mapLine );
+          float* sliceLine = slice + j*dim;
+          if( factors ) {
+            const float* factorLine = factors + j*dim;
+            for( unsigned int x = 0; x < dim; x++ )
+              if( map[x] >= 0 ) sliceLine[x] += factorLine[x] * line[ map[x] % dim ];
+            continue;
+          }
+
+          for( unsigned int x = 0; x < dim; x++ )
+            if( map[x] >= 0 ) sliceLine[x] += line[ map[x] % dim ];
+        }
+        continue;
+      }
+
+      // line of the plane v: vertical then horizontal convolution with the PSF of v
+      // only the line z is needed: the vertical convolution stays direct, the horizontal one can be recursive or use the FFT
+      for( int v = 0; v <= last; v++ ) {
+
+        const float* coefs = backend->psf.getCoefs( v );
+        float* line = lines + v*dim;
+        for( int u = 0; u <= last; u++ ) {
+
+          float sum = coefs[0] * projection[ u + z*dim ];
+          for( int k = 1; k <= radius; k++ )
+            sum += coefs[k] * ( projection[ u + std::min( (int)z+k, last )*dim ] + projection[ u + std::max( (int)z-k, 0 )*dim ] );
+          line[u] = sum;
+        }
+
+        float* convolvedLine = convolvedLines + v*dim;
+        if( backend->recursiveGaussian.isUsed( v ) ) {
+
+          std::copy( line, line + dim, convolvedLine );
+          backend->recursiveGaussian.convolveLine( convolvedLine, v );
+          continue;
+        }
+        
+        if( backend->useFFTConvolution ) {
+
+          std::copy( line, line + dim, convolvedLine );
+          backend->fftConvolution.convolveLines( convolvedLine, 0, 1, dim, v, work );
+          continue;
+        }
+
+        for( int u = 0; u <= last; u++ ) {
+
+          float sum = coefs[0] * line[u];
+          for( int k = 1; k <= radius; k++ )
+            sum += coefs[k] * ( line[ std::min( u+k, last ) ] + line[ std::max( u-k, 0 ) ] );
+          convolvedLine[u] = sum;
+        }
+      }
+
+      for( unsigned int j = 0; j < dim; j++ ) {
+
+        const int* map = backend->getMapLine( mapRef, j, mapLine );
+        float* sliceLine = slice + j*dim;
+        if( factors ) {
+          const float* factorLine = factors + j*dim;
+          for( unsigned int x = 0; x < dim; x++ )
+            if( map[x] >= 0 ) sliceLine[x] += factorLine[x] * convolvedLines[ map[x] ];
+          continue;
+        }
+
+        for( unsigned int x = 0; x < dim; x++ )
+          if( map[x] >= 0 ) sliceLine[x] += convolvedLines[ map[x] ];
+      }
+    }
+  }
+}
+
+
+// slabs: the backprojection of a slab is computed by update(), right before the update of its slices
+void CPUBackend::backProject( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve ) {
+
+  if( slabSize < dim ) {
+
+    pendingRatios = &ratios;
+    pendingFirstProjection = firstProjection;
+    pendingStep = step;
+    pendingConvolve = convolve;
+    return;
+  }
+
+  // attenuation (no slabs): the sensitivity of the subset first, it goes through the same buffer
+  if( attenuationTables.hasMap() )
+    sensitivity = getSensitivity( ratios, firstProjection, step, convolve );
+
+  backProjectSlab( ratios, firstProjection, step, convolve, 0, dim );
+}
+
+
+const float* CPUBackend::getSensitivity( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve ) {
+
+  subsetAngles.clear();
+  for( unsigned int p = firstProjection; p < ratios.getNbProjection(); p += step )
+    subsetAngles.push_back( ratios.getAngle( p ) );
+
+  const float* stored = attenuationTables.findSensitivity( subsetAngles, convolve );
+  if( stored ) return stored;
+
+  backProjectSlab( ratios, firstProjection, step, convolve, 0, dim, &ones[0] );
+
+  float* destination = attenuationTables.storeSensitivity( subsetAngles, convolve );
+  if( !destination ) {
+    sensitivityBuffer.resize( (size_t)dim * dim * dim );
+    destination = &sensitivityBuffer[0];
+  }
+  std::copy( &backProjection[0], &backProjection[0] + (size_t)dim * dim * dim, destination );
+  return destination;
+}
+
+
+void CPUBackend::backProjectSlab( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve,
+                                  unsigned int firstSlice, unsigned int nbSlices, const float* constantProjection ) {
+
+  DBGutils::timerBegin("CPU Backprojection");
+
+  subsetProjections.clear();
+  subsetRatios.clear();
+  for( unsigned int p = firstProjection; p < ratios.getNbProjection(); p += step ) {
+    subsetProjections.push_back( p );
+    subsetRatios.push_back( constantProjection ? constantProjection : ratios.getData( p ) );
+  }
+  unsigned int nbProjections = subsetProjections.size();
+
+  // FDR: the ratios of the subset are blurred together (the filter is its own adjoint) before a plain backprojection
+  if( convolve && context.psfModel == FDR_PSF ) {
+
+    prepareFDR( ratios, firstProjection, step );
+    blurredRatios.resize( nbProjections * dim * dim );
+    fdrProjections.resize( nbProjections );
+    for( unsigned int i = 0; i < nbProjections; i++ ) {
+
+      fdrProjections[i] = &blurredRatios[ i * dim * dim ];
+      std::copy( subsetRatios[i], subsetRatios[i] + dim * dim, fdrProjections[i] );
+      subsetRatios[i] = fdrProjections[i];
+    }
+    fdr.apply( &fdrProjections[0], nbThreads, workers );
+  }
+
+  // the maps that aren't stored are computed in their own buffer (the buffers are only added)
+  if( subsetMapBuffers.size() < nbProjections )
+    subsetMapBuffers.resize( nbProjections );
+  subsetMaps.clear();
+  for( unsigned int i = 0; i < nbProjections; i++ )
+    subsetMaps.push_back( getBackProjectionMap( ratios.getAngle( subsetProjections[i] ), subsetMapBuffers[i] ) );
+
+  // attenuation: the factors are stored up to the budget, the others are computed by the threads for their slices
+  // from the whole maps
+  if( attenuationTables.hasMap() ) {
+
+    subsetAttenuation.assign( nbProjections, 0 );
+    subsetFullMaps.resize( nbProjections * dim * dim );
+    for( unsigned int i = 0; i < nbProjections; i++ ) {
+
+      float angle = ratios.getAngle( subsetProjections[i] );
+      int* backProjectionMap = &subsetFullMaps[ i * dim * dim ];
+      copyMap( subsetMaps[i], backProjectionMap );
+      subsetAttenuation[i] = attenuationTables.find( angle );
+      if( subsetAttenuation[i] ) continue;
+
+      subsetSamplingMaps.resize( nbProjections * dim * dim );
+      int* samplingMap = &subsetSamplingMaps[ i * dim * dim ];
+      copyMap( getSamplingMap( angle, samplingMapBuffer ), samplingMap );
+      subsetAttenuation[i] = attenuationTables.store( angle, samplingMap, backProjectionMap, nbThreads, workers );
+    }
+  }
+
+  BackProjectionContext loopContext;
+  loopContext.backend = this;
+  loopContext.scratch = &scratch;
+  loopContext.nbProjections = nbProjections;
+  loopContext.projections = &subsetRatios[0];
+  loopContext.backProjectionMaps = &subsetMaps[0];
+  loopContext.fullBackProjectionMaps = subsetFullMaps.empty() ? 0 : &subsetFullMaps[0];
+  loopContext.attenuation = attenuationTables.hasMap() ? &subsetAttenuation[0] : 0;
+  loopContext.samplingMaps = subsetSamplingMaps.empty() ? 0 : &subsetSamplingMaps[0];
+  loopContext.convolve = convolve && context.psfModel == GAUSSIAN_PSF;
+  loopContext.firstSlice = firstSlice;
+  loopContext.nbSlices = nbSlices;
+  loopContext.nbThreads = nbThreads;
+  loopContext.backProjection = &backProjection[0];
+  THREADutils::parallelFor( firstSlice, firstSlice + nbSlices, backProjectSlices, &loopContext, nbThreads, workers );
+
+  DBGutils::timerEnd("CPU Backprojection");
+}
+
+
+void CPUBackend::updateSlices( unsigned int begin, unsigned int end, void* context ) {
+
+  UpdateContext* ctx = (UpdateContext*)context;
+
+  if( ctx->sensitivity ) {
+    for( unsigned int i = begin * ctx->sliceSize; i < end * ctx->sliceSize; i++ )
+      ctx->volume[i] = ( ctx->sensitivity[i] > 0.0f ) ? std::min( ctx->volume[i] * ctx->backProjection[i] / ctx->sensitivity[i], 60000.0f ) : 0.0f;
+    return;
+  }
+
+  for( unsigned int i = begin * ctx->sliceSize; i < end * ctx->sliceSize; i++ )
+    ctx->volume[i] = std::min( ctx->volume[i] * ctx->backProjection[i] * ctx->normalizationFactor, 60000.0f );
+}
+
+
+void CPUBackend::update( Volume& volume, float normalizationFactor ) {
+
+  assert( volume.getDim() == dim );
+
+  UpdateContext loopContext;
+  loopContext.backProjection = &backProjection[0];
+  loopContext.normalizationFactor = normalizationFactor;
+  loopContext.sliceSize = dim * dim;
+
+  for( unsigned int firstSlice = 0; firstSlice < dim; firstSlice += slabSize ) {
+
+    unsigned int nbSlices = std::min( slabSize, dim - firstSlice );
+    if( pendingRatios )
+      backProjectSlab( *pendingRatios, pendingFirstProjection, pendingStep, pendingConvolve, firstSlice, nbSlices );
+
+    loopContext.volume = volume.getData() + (size_t)firstSlice * dim * dim;
+    loopContext.sensitivity = sensitivity ? sensitivity + (size_t)firstSlice * dim * dim : 0;
+    THREADutils::parallelFor( 0, nbSlices, updateSlices, &loopContext, nbThreads, workers );
+    volume.releaseSlices( firstSlice, nbSlices );
+  }
+  pendingRatios = 0;
+}
@@ -0,0 +1,189 @@
+#ifndef _CPUBACKEND_H
+#define _CPUBACKEND_H
+
+#include <vector>
+
+#include "ReconstructionBackend.h"
+#include "GaussianPSF.h"
+#include "FDRFilter.h"
+#include "FFTConvolution.h"
+#include "RecursiveGaussian.h"
+#include "SamplingTables.h"
+#include "AttenuationTables.h"
+#include "PSFCache.h"
+#include "THREADutils.h"
+
+namespace GPURec {
+
+
+// Multithreaded implementation of the kernels in main memory
+// the sampling follows the GL path: nearest voxel, planes perpendicular to the projection axis
+// with a mu map in the context the projector and the backprojector are attenuated (AttenuationTables) and
+// the update divides by the sensitivity of the subset instead of the normalization factor
+// with slabs (out-of-core volumes) the kernels go through the volume slab by slab: the lines z of the projections
+// only depend on the slices z +/- PSF radius (halo), the backprojection is kept for one slab
+class CPUBackend : public ReconstructionBackend {
+
+public:
+
+  CPUBackend( const ReconstructionContext& _context );   // nbThreads 0: one thread per hardware thread
+  virtual ~CPUBackend() { terminate(); }
+  
+  virtual const char* getName( void ) const { return "CPU"; }
+  
+  virtual void reset( unsigned int _dim, float pixelSize );
+  virtual void terminate( void );
+  
+  virtual void uploadVolume( Volume& volume );
+  virtual void downloadVolume( Volume& volume );
+  virtual void uploadProjections( VolumeProjectionSet& projSet );
+  virtual void downloadProjections( VolumeProjectionSet& projSet );
+  
+  virtual void project( const Volume& volume, float angle, bool convolve );
+  virtual void ratio( const VolumeProjectionSet& scan, VolumeProjectionSet& ratios, unsigned int projNum );
+  virtual void projectSubset( const Volume& volume, const VolumeProjectionSet& scan, VolumeProjectionSet& ratios,
+                              unsigned int firstProjection, unsigned int step, bool convolve );
+  virtual void backProject( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve );
+  virtual void update( Volume& volume, float normalizationFactor );
+
+  // bytes allocated by a backend of this context reconstructing a set of nbProjections:
+  // buffers, PSF tables, sampling and attenuation tables and the scratch memory of the kernels
+  static size_t estimateMemory( unsigned int dim, float pixelSize, unsigned int nbProjections, const ReconstructionContext& context );
+
+  // sampling map of an angle given to the kernels: a stored table read line by line, or a full map in a buffer
+  struct MapRef {
+    const SamplingTables::Table* table;
+    const int* indices;
+    unsigned int nbTurns;              // quarter turns of the points of a stored backprojection table
+  };
+
+  // scratch memory of a thread of the kernels, allocated by reset() on the thread (and core) that uses it
+  struct ThreadScratch {
+    std::vector<float> accumulator;          // partial projection of a chunk of planes (dim x dim)
+    std::vector<float> plane;                // sampled plane (projector) or lines of a slice (backprojector), dim x dim
+    std::vector<float> buffer;               // convolution buffer or convolved lines, dim x dim
+    std::vector<FFTutils::Complex> work;     // FFT convolution
+    std::vector<float> sliceFactors;         // attenuation factors of a slice and their scratch, with attenuation only
+    std::vector<float> attenuationSums;
+    std::vector<int> mapLine;                // decoded line of a sampling map
+  };
+
+protected:
+
+  // PSF hook: convolve a (dim x nbLines) image, line major, with the PSF of a plane
+  // buffer is a scratch image of the same size, work the scratch of the FFT convolution
+  // the far planes use the recursive gaussian, the others the FFT convolution when the PSF radius
+  // exceeds the crossover measured by reset()
+  virtual void convolvePlane( float* image, float* buffer, unsigned int nbLines, unsigned int planeNum, FFTutils::Complex* work ) const;
+  void convolvePlaneDirect( float* image, float* buffer, unsigned int nbLines, unsigned int planeNum ) const;
+  
+  // time both convolutions on the farthest plane
+  void measureConvolutionCrossover( void );
+  double timeConvolution( bool fft, float* image, float* buffer, FFTutils::Complex* work ) const;
+
+  // scratch memory of the threads, sized for the current dim and attenuation map
+  void allocateScratch( void );
+
+  // mu map of the context, the attenuation tables are kept while the map doesn't change
+  void loadAttenuationMap( void );
+
+  // index of the voxel (in a slice) sampled by the point (u,v) of a projection plane, -1 outside the volume
+  void computeSamplingMap( float angle, int* map ) const;
+  
+  // index of the projection point (u + v*dim) sampled by each voxel of a slice, -1 outside the projection
+  void computeBackProjectionMap( float angle, int* map ) const;
+  
+  // the same maps, read from the sampling tables when they are stored, else computed in buffer
+  // with the quarter turn symmetry only the maps of the first quadrant are computed or stored,
+  // the maps of the other quadrants are rotated (projection) or have their indices rotated (backprojection)
+  MapRef getSamplingMap( float angle, std::vector<int>& buffer );
+  MapRef getBackProjectionMap( float angle, std::vector<int>& buffer );
+  void rotatePoints( int* points, unsigned int nbPoints, unsigned int nbTurns ) const;
+
+  // line l of a map (dim indices), decoded in buffer if needed
+  const int* getMapLine( const MapRef& map, unsigned int l, int* buffer ) const;
+  void copyMap( const MapRef& map, int* destination ) const;
+  
+  // angle = baseAngle + nbTurns * 90 degrees, baseAngle is one of the first quarterSteps angles of the set
+  // the angles outside the set are not split (nbTurns = 0)
+  void splitQuarterTurns( float angle, float& baseAngle, unsigned int& nbTurns ) const;
+  
+  // attenuation factors of the angle (volume layout): the stored ones, else computed in buffer
+  // 0 without attenuation
+  const float* getAttenuation( float angle, const MapRef& samplingMap, std::vector<float>& buffer );
+
+  // sensitivity of the subset firstProjection + i*step: the stored one, else computed in sensitivityBuffer
+  // (uses the backprojection buffer, with attenuation only)
+  const float* getSensitivity( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve );
+
+  // lines firstSlice..firstSlice+nbSlices-1 of the estimated projection, from the slices of the lines and their halo
+  void projectSlab( const Volume& volume, float angle, bool convolve, unsigned int firstSlice, unsigned int nbSlices );
+  
+  // backprojection of the slices firstSlice..firstSlice+nbSlices-1, kept for the update of these slices
+  // with a constant projection, this projection is backprojected at the angles of the ratios (sensitivity)
+  void backProjectSlab( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve,
+                        unsigned int firstSlice, unsigned int nbSlices, const float* constantProjection = 0 );
+  
+  // FDR PSF of the subset firstProjection + i*step, computed again when the subsets change
+  void prepareFDR( const VolumeProjectionSet& projSet, unsigned int firstProjection, unsigned int step );
+
+  // parallel loop bodies
+  static void allocateThreadScratch( unsigned int begin, unsigned int end, void* context );
+  static void projectPlanes( unsigned int begin, unsigned int end, void* context );
+  static void backProjectSlices( unsigned int begin, unsigned int end, void* context );
+  static void updateSlices( unsigned int begin, unsigned int end, void* context );
+
+  
+  unsigned int dim;
+  unsigned int nbThreads;
+  float pixelSize;
+  PSFKey key;                          // camera parameters of the PSF and of the tables below
+  GaussianPSF psf;
+  FDRFilter fdr;
+  FFTConvolution fftConvolution;
+  bool useFFTConvolution;
+  float crossoverRadius;               // the direct convolution is slower above this radius
+  RecursiveGaussian recursiveGaussian;
+  SamplingTables samplingTables;
+  AttenuationTables attenuationTables;
+  bool quarterTurnSymmetry;            // the rotation increment of the projection sets divides 90 degrees
+  float symmetryStartAngle;            // angles of the set: start + p * increment
+  float symmetryIncrement;
+  int quarterSteps;                    // number of increments in 90 degrees
+  
+  unsigned int slabSize;               // slices per slab, dim without slabs
+  const VolumeProjectionSet* pendingRatios;   // slabs: backprojection done slab by slab by update()
+  unsigned int pendingFirstProjection;
+  unsigned int pendingStep;
+  bool pendingConvolve;
+  
+  std::vector<float> estimate;         // last estimated projection (dim x dim)
+  THREADutils::Array backProjection;   // last backprojection (dim x dim x slabSize), each slice placed by the thread of its backprojection
+  const float* sensitivity;            // sensitivity of the last backprojected subset, 0 without attenuation
+  std::vector<float> sensitivityBuffer;   // sensitivity computed again for each subset, out of the budget
+  std::vector<ThreadScratch> scratch;  // one per thread
+
+  // buffers of the kernels kept from one call to the next: the maps and the factors computed on the fly,
+  // the lists of the current subset (the subsets of a reconstruction have the same size)
+  std::vector<int> samplingMapBuffer;
+  std::vector<int> backProjectionMapBuffer;
+  std::vector<int> samplingIndices;    // whole maps given to the attenuation tables
+  std::vector<int> backProjectionIndices;
+  std::vector<float> attenuationBuffer;
+  std::vector<unsigned int> subsetProjections;
+  std::vector<const float*> subsetRatios;
+  std::vector<float> blurredRatios;    // FDR: ratios of the subset blurred before the backprojection
+  std::vector<float*> fdrProjections;  // FDR: projections of the subset given to the filter
+  std::vector< std::vector<int> > subsetMapBuffers;
+  std::vector<MapRef> subsetMaps;
+  std::vector<int> subsetFullMaps;
+  std::vector<const float*> subsetAttenuation;
+  std::vector<int> subsetSamplingMaps;
+  std::vector<float> subsetAngles;     // key of the sensitivity of the subset
+  std::vector<float> ones;             // constant projection of the sensitivity, with attenuation only
+};
+
+
+} // end namespace GPURec
+
+#endif  // _CPUBACKEND_H
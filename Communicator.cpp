@@ -0,0 +1,368 @@
+#include "common.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <ctime>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#endif
+
+#include "Communicator.h"
+
+using namespace GPURec;
+
+// time given to the other workers to start
+const unsigned int CONNECTION_TIMEOUT = 60;   // in seconds
+
+
+Communicator* Communicator::create( DistributedMode mode, unsigned int rank, unsigned int size, const std::string& address ) {
+
+  if( rank >= size ) {
+    std::cerr << "Distributed reconstruction: worker rank " << rank << " with " << size << " workers" << std::endl;
+    throw std::exception();
+  }
+
+#ifdef _WIN32
+  std::cerr << "Distributed reconstruction is only available on POSIX systems" << std::endl;
+  throw std::exception();
+#else
+  switch( mode ) {
+  
+    case SHARED_MEMORY_DISTRIBUTION:  return new SharedMemoryCommunicator( rank, size, address );
+    case TCP_DISTRIBUTION:            return new TCPCommunicator( rank, size, address );
+    case NO_DISTRIBUTION:             break;
+  }
+  
+  std::cerr << "Unknown distributed mode" << std::endl;
+  throw std::exception();
+#endif
+}
+
+
+#ifndef _WIN32
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  SHARED MEMORY
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+// beginning of the segment, followed by one slot of *capacity* floats per worker
+// a segment left by a crashed run can still be linked when the workers start: they only join a segment
+// whose worker 0 is alive, and the later segments of the run have to carry the generation of the first one
+struct SharedMemoryHeader {
+
+  pthread_barrier_t barrier;
+  volatile pid_t creator;                 // process of the worker 0
+  volatile unsigned long generation;      // token of the run, published by the worker 0
+  volatile int ready;
+};
+
+static size_t slotsOffset( void ) {
+
+  // slots aligned on 64 bytes
+  return ( sizeof(SharedMemoryHeader) + 63 ) / 64 * 64;
+}
+
+
+SharedMemoryCommunicator::SharedMemoryCommunicator( unsigned int _rank, unsigned int _size, const std::string& _name ) 
+  : Communicator( _rank, _size ), name( _name ), capacity(0), segmentSize(0), segment(0), generation(0) {
+
+  if( name.empty() || name[0] != '/' ) name = "/" + name;
+}
+
+
+SharedMemoryCommunicator::~SharedMemoryCommunicator() {
+
+  release();
+}
+
+
+void SharedMemoryCommunicator::release( void ) {
+
+  if( segment ) {
+    munmap( segment, segmentSize );
+    segment = 0;
+  }
+  
+  if( rank == 0 && !segmentName.empty() ) shm_unlink( segmentName.c_str() );
+  segmentName = "";
+  capacity = 0;
+}
+
+
+void SharedMemoryCommunicator::allocate( size_t count ) {
+
+  if( segment && count <= capacity ) return;
+  release();
+  
+  std::stringstream fullName;
+  fullName << name << "_" << count;
+  segmentName = fullName.str();
+  capacity = count;
+  segmentSize = slotsOffset() + size * capacity * sizeof(float);
+  
+  if( rank == 0 ) {
+  
+    // a segment left by a previous run is replaced
+    shm_unlink( segmentName.c_str() );
+    int fd = shm_open( segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+    if( fd < 0 || ftruncate( fd, segmentSize ) != 0 ) {
+      std::cerr << "Distributed reconstruction: can't create the shared memory " << segmentName << std::endl;
+      throw std::exception();
+    }
+    
+    segment = mmap( 0, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( segment == MAP_FAILED ) {
+      segment = 0;
+      std::cerr << "Distributed reconstruction: can't map the shared memory " << segmentName << std::endl;
+      throw std::exception();
+    }
+    
+    if( !generation ) generation = ( (unsigned long)time( 0 ) << 16 ) ^ (unsigned long)getpid();
+    
+    SharedMemoryHeader* header = (SharedMemoryHeader*)segment;
+    pthread_barrierattr_t attributes;
+    pthread_barrierattr_init( &attributes );
+    pthread_barrierattr_setpshared( &attributes, PTHREAD_PROCESS_SHARED );
+    pthread_barrier_init( &header->barrier, &attributes, size );
+    pthread_barrierattr_destroy( &attributes );
+    header->creator = getpid();
+    header->generation = generation;
+    __sync_synchronize();
+    header->ready = 1;
+    return;
+  }
+  
+  // wait for the worker 0 to create and initialize the segment of this run
+  for( unsigned int i = 0; i < CONNECTION_TIMEOUT * 100 && !segment; i++ ) {
+  
+    segment = joinSegment();
+    if( !segment ) usleep( 10000 );
+  }
+  
+  if( !segment ) {
+    std::cerr << "Distributed reconstruction: shared memory " << segmentName << " not found or not initialized" << std::endl;
+    throw std::exception();
+  }
+}
+
+
+// the segment linked under the name if it is initialized by the worker 0 of this run, else 0
+void* SharedMemoryCommunicator::joinSegment( void ) {
+
+  int fd = shm_open( segmentName.c_str(), O_RDWR, 0600 );
+  if( fd < 0 ) return 0;
+  
+  struct stat info;
+  if( fstat( fd, &info ) != 0 || (size_t)info.st_size < segmentSize ) {
+    close( fd );
+    return 0;
+  }
+  
+  void* mapped = mmap( 0, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+  if( mapped == MAP_FAILED ) return 0;
+  
+  SharedMemoryHeader* header = (SharedMemoryHeader*)mapped;
+  bool current = header->ready != 0;
+  __sync_synchronize();
+  
+  // the worker 0 is alive and the segment belongs to the same run as the previous ones
+  current = current && ( kill( header->creator, 0 ) == 0 || errno == EPERM );
+  current = current && ( !generation || header->generation == generation );
+  
+  if( !current ) {
+    munmap( mapped, segmentSize );
+    return 0;
+  }
+  
+  generation = header->generation;
+  return mapped;
+}
+
+
+void SharedMemoryCommunicator::allReduceSum( float* data, size_t count ) {
+
+  allocate( count );
+  
+  SharedMemoryHeader* header = (SharedMemoryHeader*)segment;
+  float* slots = (float*)( (char*)segment + slotsOffset() );
+  
+  memcpy( slots + rank * capacity, data, count * sizeof(float) );
+  pthread_barrier_wait( &header->barrier );
+  
+  memcpy( data, slots, count * sizeof(float) );
+  for( unsigned int r = 1; r < size; r++ ) {
+  
+    const float* slot = slots + r * capacity;
+    for( size_t i = 0; i < count; i++ )
+      data[i] += slot[i];
+  }
+  
+  // the slots are written again by the next reduction
+  pthread_barrier_wait( &header->barrier );
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  TCP
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+TCPCommunicator::TCPCommunicator( unsigned int _rank, unsigned int _size, const std::string& address ) 
+  : Communicator( _rank, _size ), sockets( _size, -1 ) {
+
+  std::string host = address.substr( 0, address.rfind(":") );
+  std::string port = ( address.find(":") != std::string::npos ) ? address.substr( address.rfind(":") + 1 ) : "";
+  if( host.empty() || port.empty() ) {
+    std::cerr << "Distributed reconstruction: the TCP address has to be host:port, not " << address << std::endl;
+    throw std::exception();
+  }
+  
+  int one = 1;
+  if( rank == 0 ) {
+  
+    int listener = socket( AF_INET, SOCK_STREAM, 0 );
+    setsockopt( listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) );
+    
+    struct sockaddr_in local;
+    memset( &local, 0, sizeof(local) );
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl( INADDR_ANY );
+    local.sin_port = htons( (unsigned short)atoi( port.c_str() ) );
+    if( listener < 0 || bind( listener, (struct sockaddr*)&local, sizeof(local) ) != 0 || listen( listener, size ) != 0 ) {
+      std::cerr << "Distributed reconstruction: can't listen on port " << port << std::endl;
+      throw std::exception();
+    }
+    
+    // each worker sends its rank first
+    for( unsigned int i = 1; i < size; i++ ) {
+    
+      int connection = accept( listener, 0, 0 );
+      unsigned int workerRank = 0;
+      if( connection >= 0 ) receiveAll( connection, &workerRank, sizeof(workerRank) );
+      if( connection < 0 || workerRank == 0 || workerRank >= size || sockets[workerRank] >= 0 ) {
+        std::cerr << "Distributed reconstruction: invalid worker connection" << std::endl;
+        throw std::exception();
+      }
+      setsockopt( connection, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+      sockets[workerRank] = connection;
+    }
+    close( listener );
+  }
+  else {
+  
+    struct addrinfo hints;
+    struct addrinfo* addresses = 0;
+    memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if( getaddrinfo( host.c_str(), port.c_str(), &hints, &addresses ) != 0 ) {
+      std::cerr << "Distributed reconstruction: unknown host " << host << std::endl;
+      throw std::exception();
+    }
+    
+    // the worker 0 may not listen yet
+    int connection = -1;
+    for( unsigned int i = 0; i < CONNECTION_TIMEOUT * 10 && connection < 0; i++ ) {
+    
+      connection = socket( AF_INET, SOCK_STREAM, 0 );
+      if( connection >= 0 && connect( connection, addresses->ai_addr, addresses->ai_addrlen ) != 0 ) {
+        close( connection );
+        connection = -1;
+        usleep( 100000 );
+      }
+    }
+    freeaddrinfo( addresses );
+    
+    if( connection < 0 ) {
+      std::cerr << "Distributed reconstruction: can't connect to " << address << std::endl;
+      throw std::exception();
+    }
+    
+    setsockopt( connection, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+    sendAll( connection, &rank, sizeof(rank) );
+    sockets[0] = connection;
+  }
+}
+
+
+TCPCommunicator::~TCPCommunicator() {
+
+  for( unsigned int i = 0; i < sockets.size(); i++ )
+    if( sockets[i] >= 0 ) close( sockets[i] );
+}
+
+
+void TCPCommunicator::sendAll( int socket, const void* data, size_t length ) {
+
+  const char* bytes = (const char*)data;
+  while( length > 0 ) {
+  
+    ssize_t sent = send( socket, bytes, length, 0 );
+    if( sent <= 0 ) {
+      std::cerr << "Distributed reconstruction: connection lost" << std::endl;
+      throw std::exception();
+    }
+    bytes += sent;
+    length -= sent;
+  }
+}
+
+
+void TCPCommunicator::receiveAll( int socket, void* data, size_t length ) {
+
+  char* bytes = (char*)data;
+  while( length > 0 ) {
+  
+    ssize_t received = recv( socket, bytes, length, 0 );
+    if( received <= 0 ) {
+      std::cerr << "Distributed reconstruction: connection lost" << std::endl;
+      throw std::exception();
+    }
+    bytes += received;
+    length -= received;
+  }
+}
+
+
+void TCPCommunicator::allReduceSum( float* data, size_t count ) {
+
+  if( rank != 0 ) {
+  
+    sendAll( sockets[0], data, count * sizeof(float) );
+    receiveAll( sockets[0], data, count * sizeof(float) );
+    return;
+  }
+  
+  buffer.resize( count );
+  for( unsigned int r = 1; r < size; r++ ) {
+  
+    receiveAll( sockets[r], &buffer[0], count * sizeof(float) );
+    for( size_t i = 0; i < count; i++ )
+      data[i] += buffer[i];
+  }
+  
+  for( unsigned int r = 1; r < size; r++ )
+    sendAll( sockets[r], data, count * sizeof(float) );
+}
+
+#endif  // _WIN32
@@ -0,0 +1,89 @@
+#ifndef _COMMUNICATOR_H
+#define _COMMUNICATOR_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace GPURec {
+
+
+// Collective operations between the worker processes of a distributed reconstruction
+// the workers are numbered from 0 to size-1, all of them call the operations in the same order
+class Communicator {
+
+public:
+
+  Communicator( unsigned int _rank, unsigned int _size ) : rank(_rank), size(_size) {}
+  virtual ~Communicator() {}
+  
+  // create the communicator selected by DISTRIBUTED_MODE
+  static Communicator* create( DistributedMode mode, unsigned int rank, unsigned int size, const std::string& address );
+  
+  unsigned int getRank( void ) const { return rank; }
+  unsigned int getSize( void ) const { return size; }
+  
+  // prepare the buffers of the next reductions of *count* values
+  virtual void allocate( size_t count ) = 0;
+  
+  // data = sum of the data of all the workers, added in rank order: the result is the same on every worker
+  virtual void allReduceSum( float* data, size_t count ) = 0;
+  
+protected:
+
+  unsigned int rank;
+  unsigned int size;
+};
+
+
+// workers on one host: one slot per worker in a shared memory segment, synchronized by a process shared barrier
+// *address* is the name of the segment (e.g. "/gpurec"), worker 0 creates it
+class SharedMemoryCommunicator : public Communicator {
+
+public:
+
+  SharedMemoryCommunicator( unsigned int _rank, unsigned int _size, const std::string& _name );
+  virtual ~SharedMemoryCommunicator();
+  
+  virtual void allocate( size_t count );
+  virtual void allReduceSum( float* data, size_t count );
+  
+protected:
+
+  void release( void );
+  void* joinSegment( void );
+  
+  std::string name;
+  std::string segmentName;        // name + capacity: a new segment for each buffer size
+  size_t capacity;
+  size_t segmentSize;
+  void* segment;
+  unsigned long generation;       // token of the run, 0 until the first segment
+};
+
+
+// workers on several hosts: the workers send their data to the worker 0 (*address* is "host:port"),
+// which adds them and sends the result back. The hosts have to share the same float representation.
+class TCPCommunicator : public Communicator {
+
+public:
+
+  TCPCommunicator( unsigned int _rank, unsigned int _size, const std::string& address );
+  virtual ~TCPCommunicator();
+  
+  virtual void allocate( size_t count ) { buffer.resize( count ); }
+  virtual void allReduceSum( float* data, size_t count );
+  
+protected:
+
+  static void sendAll( int socket, const void* data, size_t length );
+  static void receiveAll( int socket, void* data, size_t length );
+  
+  std::vector<int> sockets;       // worker 0: one socket per rank (the slot 0 is unused), others: the socket to worker 0
+  std::vector<float> buffer;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _COMMUNICATOR_H
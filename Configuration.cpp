@@ -0,0 +1,260 @@
+
+#include "common.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+#include "Configuration.h"
+#include "ReconstructionContext.h"
+#include "PSFCache.h"
+
+namespace GPURec {
+
+bool USE_OSEM3D = true;
+bool USE_GLSL = false;
+float CAMERA_ROTATION_RADIUS;
+float CAMERA_RESOLUTION;
+float COLLIMATOR_HOLES_DIAMETER;
+float COLLIMATOR_DEPTH;
+unsigned int NB_SUBSETS = 10;
+unsigned int NB_ITERATIONS = 3;
+BackendType BACKEND = GL_BACKEND;
+unsigned int NB_THREADS = 0;
+bool PIN_THREADS = false;
+PSFModel PSF_MODEL = GAUSSIAN_PSF;
+unsigned int SAMPLING_TABLES_MEMORY = 64;
+unsigned int SLAB_SLICES = 0;
+std::string ATTENUATION_MAP = "";
+unsigned int ATTENUATION_TABLES_MEMORY = 512;
+unsigned int BATCH_MEMORY = 4096;
+unsigned int BATCH_MAX_JOBS = 0;
+bool WARM_START = false;
+unsigned int WARM_START_ITERATIONS = 1;
+bool WARM_START_SCALING = true;
+bool KEEP_RAW_COUNTS = false;
+bool STAGING_HUGE_PAGES = false;
+int NOISE_SEED = -1;
+DistributedMode DISTRIBUTED_MODE = NO_DISTRIBUTION;
+unsigned int NB_WORKERS = 1;
+unsigned int WORKER_RANK = 0;
+std::string DISTRIBUTED_ADDRESS = "/gpurec";
+
+
+ReconstructionContext::ReconstructionContext() {
+
+  cameraRotationRadius = CAMERA_ROTATION_RADIUS;
+  cameraResolution = CAMERA_RESOLUTION;
+  collimatorHolesDiameter = COLLIMATOR_HOLES_DIAMETER;
+  collimatorDepth = COLLIMATOR_DEPTH;
+
+  useOSEM3D = USE_OSEM3D;
+  nbSubsets = NB_SUBSETS;
+  nbIterations = NB_ITERATIONS;
+  warmStart = WARM_START;
+  warmStartIterations = WARM_START_ITERATIONS;
+  warmStartScaling = WARM_START_SCALING;
+  keepRawCounts = KEEP_RAW_COUNTS;
+  stagingHugePages = STAGING_HUGE_PAGES;
+
+  backend = BACKEND;
+  nbThreads = NB_THREADS;
+  pinThreads = PIN_THREADS;
+  psfModel = PSF_MODEL;
+  samplingTablesMemory = SAMPLING_TABLES_MEMORY;
+  slabSlices = SLAB_SLICES;
+  attenuationMap = ATTENUATION_MAP;
+  attenuationTablesMemory = ATTENUATION_TABLES_MEMORY;
+  distributedMode = DISTRIBUTED_MODE;
+  nbWorkers = NB_WORKERS;
+  workerRank = WORKER_RANK;
+  distributedAddress = DISTRIBUTED_ADDRESS;
+}
+
+
+// one "PARAMETER = value" line of the config file, or a parameter override of a daemon job
+void parseConfigLine( const std::string& ln ) {
+
+  // separate parameter name and value    
+  std::string paramName = ln.substr( 0, ln.find("=") );    
+    // remove blanks
+  paramName.erase( std::remove(paramName.begin(), paramName.end(), ' '), paramName.end() );
+ 
+  // retrieve the value if any
+  std::stringstream paramValue("undefined");
+  if( ln.size() > (ln.find("=") +1) )  {
+    paramValue.str( ln.substr( ln.find("=")+1 ) );
+  }
+  
+  if( paramName == ("USE_OSEM3D") )
+  {       
+    paramValue >> USE_OSEM3D;
+  }
+  else if( paramName == ("USE_GLSL") )
+  {
+    paramValue >> USE_GLSL;
+  }
+  else if( paramName == ("BACKEND") )
+  {
+    std::string backendName;
+    paramValue >> backendName;
+    if( backendName == "GL" ) BACKEND = GL_BACKEND;
+    else if( backendName == "CPU" ) BACKEND = CPU_BACKEND;
+    else {
+      std::cerr << "Initialization: unknown BACKEND " << backendName << " (GL or CPU)" << std::endl;
+      throw std::exception();
+    }
+  }
+  else if( paramName == ("NB_THREADS") )
+  {
+    paramValue >> NB_THREADS;
+  }
+  else if( paramName == ("PIN_THREADS") )
+  {
+    paramValue >> PIN_THREADS;
+  }
+  else if( paramName == ("DISTRIBUTED") )
+  {
+    std::string modeName;
+    paramValue >> modeName;
+    if( modeName == "NONE" ) DISTRIBUTED_MODE = NO_DISTRIBUTION;
+    else if( modeName == "SHM" ) DISTRIBUTED_MODE = SHARED_MEMORY_DISTRIBUTION;
+    else if( modeName == "TCP" ) DISTRIBUTED_MODE = TCP_DISTRIBUTION;
+    else {
+      std::cerr << "Initialization: unknown DISTRIBUTED mode " << modeName << " (NONE, SHM or TCP)" << std::endl;
+      throw std::exception();
+    }
+  }
+  else if( paramName == ("NB_WORKERS") )
+  {
+    paramValue >> NB_WORKERS;
+  }
+  else if( paramName == ("WORKER_RANK") )
+  {
+    paramValue >> WORKER_RANK;
+  }
+  else if( paramName == ("DISTRIBUTED_ADDRESS") )
+  {
+    paramValue >> DISTRIBUTED_ADDRESS;
+  }
+  else if( paramName == ("SAMPLING_TABLES_MEMORY") )
+  {
+    paramValue >> SAMPLING_TABLES_MEMORY;
+  }
+  else if( paramName == ("SLAB_SLICES") )
+  {
+    paramValue >> SLAB_SLICES;
+  }
+  else if( paramName == ("ATTENUATION_MAP") )
+  {
+    paramValue >> ATTENUATION_MAP;
+    if( ATTENUATION_MAP == "NONE" || ATTENUATION_MAP == "undefined" ) ATTENUATION_MAP = "";
+  }
+  else if( paramName == ("ATTENUATION_TABLES_MEMORY") )
+  {
+    paramValue >> ATTENUATION_TABLES_MEMORY;
+  }
+  else if( paramName == ("BATCH_MEMORY") )
+  {
+    paramValue >> BATCH_MEMORY;
+  }
+  else if( paramName == ("BATCH_MAX_JOBS") )
+  {
+    paramValue >> BATCH_MAX_JOBS;
+  }
+  else if( paramName == ("KEEP_RAW_COUNTS") )
+  {
+    paramValue >> KEEP_RAW_COUNTS;
+  }
+  else if( paramName == ("STAGING_HUGE_PAGES") )
+  {
+    paramValue >> STAGING_HUGE_PAGES;
+  }
+  else if( paramName == ("NOISE_SEED") )
+  {
+    paramValue >> NOISE_SEED;
+  }
+  else if( paramName == ("PSF_MODEL") )
+  {
+    std::string modelName;
+    paramValue >> modelName;
+    if( modelName == "GAUSSIAN" ) PSF_MODEL = GAUSSIAN_PSF;
+    else if( modelName == "FDR" ) PSF_MODEL = FDR_PSF;
+    else {
+      std::cerr << "Initialization: unknown PSF_MODEL " << modelName << " (GAUSSIAN or FDR)" << std::endl;
+      throw std::exception();
+    }
+  }
+  else if( paramName == ("PSF_CACHE_DIRECTORY") )
+  {
+    std::string directory;
+    paramValue >> directory;
+    PSFCache::setDirectory( directory == "undefined" ? "" : directory );
+  }
+  else if( paramName == ("NB_SUBSETS") )
+  {       
+    paramValue >> NB_SUBSETS;
+  }
+  else if( paramName == ("NB_ITERATIONS") )
+  {       
+    paramValue >> NB_ITERATIONS;
+  }
+  else if( paramName == ("WARM_START") )
+  {
+    paramValue >> WARM_START;
+  }
+  else if( paramName == ("WARM_START_ITERATIONS") )
+  {
+    paramValue >> WARM_START_ITERATIONS;
+  }
+  else if( paramName == ("WARM_START_SCALING") )
+  {
+    paramValue >> WARM_START_SCALING;
+  }
+  else if( paramName == ("CAMERA_ROTATION_RADIUS") )
+  {
+    paramValue >> CAMERA_ROTATION_RADIUS;
+  }
+  else if( paramName == ("CAMERA_RESOLUTION") )
+  {
+    paramValue >> CAMERA_RESOLUTION;
+  }
+  else if( paramName == ("COLLIMATOR_HOLES_DIAMETER") )
+  {            
+    paramValue >> COLLIMATOR_HOLES_DIAMETER;
+  }
+  else if( paramName == ("COLLIMATOR_DEPTH") )
+  {
+    paramValue >> COLLIMATOR_DEPTH;
+  }
+}
+
+
+void loadConfigFile( const char* fileName ) {
+
+  std::ifstream file( fileName, std::ios::in );
+      
+  if( !file ) {
+    std::cerr << "Initialization: error opening file " << fileName << std::endl;
+    throw std::exception();
+  }
+ 
+  std::string ln;
+  while( file.good() )
+  {
+    // read the next line
+    std::getline( file, ln );
+    parseConfigLine( ln );
+  }
+  
+  file.close();
+  
+  // the local workers of a distributed reconstruction share the config file
+  if( getenv( "GPUREC_WORKER_RANK" ) )
+    WORKER_RANK = atoi( getenv( "GPUREC_WORKER_RANK" ) );
+}
+
+
+} // end of namespace GPURec
@@ -0,0 +1,18 @@
+#ifndef _CONFIGURATION_H
+#define _CONFIGURATION_H
+
+#include <string>
+
+namespace GPURec {
+
+
+// the reconstruction parameters of common.h are read from "PARAMETER = value" lines,
+// unknown parameters are ignored and invalid values throw std::exception
+// the GPUREC_WORKER_RANK environment variable overrides the WORKER_RANK of the file
+void loadConfigFile( const char* fileName );
+void parseConfigLine( const std::string& ln );
+
+
+} // end namespace GPURec
+
+#endif  // _CONFIGURATION_H
@@ -0,0 +1,60 @@
+#include "common.h"
+
+#include <iostream>
+
+#include "DistributedBackend.h"
+#include "Volume.h"
+#include "VolumeProjectionSet.h"
+#include "DBGutils.h"
+
+using namespace GPURec;
+
+
+DistributedBackend::DistributedBackend( const ReconstructionContext& _context, Communicator* _communicator ) 
+  : CPUBackend( _context ), communicator( _communicator ) {
+}
+
+
+DistributedBackend::~DistributedBackend() {
+
+  delete communicator;
+}
+
+
+void DistributedBackend::reset( unsigned int _dim, float _pixelSize ) {
+
+  // the FDR PSF needs all the projections of a subset in the same worker
+  if( context.useOSEM3D && context.psfModel == FDR_PSF ) {
+    std::cerr << "The FDR PSF model can't be used by a distributed reconstruction" << std::endl;
+    throw std::exception();
+  }
+
+  CPUBackend::reset( _dim, _pixelSize );
+  communicator->allocate( dim * dim * dim );
+  
+  std::cout << "Distributed reconstruction: worker " << communicator->getRank() << " of " << communicator->getSize() << std::endl;
+}
+
+
+// projections firstProjection + (rank + i*size)*step
+void DistributedBackend::projectSubset( const Volume& volume, const VolumeProjectionSet& scan, VolumeProjectionSet& ratios,
+                                        unsigned int firstProjection, unsigned int step, bool convolve ) {
+
+  CPUBackend::projectSubset( volume, scan, ratios, firstProjection + communicator->getRank() * step, step * communicator->getSize(), convolve );
+}
+
+
+void DistributedBackend::backProject( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve ) {
+
+  CPUBackend::backProject( ratios, firstProjection + communicator->getRank() * step, step * communicator->getSize(), convolve );
+}
+
+
+void DistributedBackend::update( Volume& volume, float normalizationFactor ) {
+
+  DBGutils::timerBegin("All-reduce");
+  communicator->allReduceSum( &backProjection[0], backProjection.size() );
+  DBGutils::timerEnd("All-reduce");
+  
+  CPUBackend::update( volume, normalizationFactor );
+}
@@ -0,0 +1,38 @@
+#ifndef _DISTRIBUTEDBACKEND_H
+#define _DISTRIBUTEDBACKEND_H
+
+#include "CPUBackend.h"
+#include "Communicator.h"
+
+namespace GPURec {
+
+
+// CPU backend of one worker process of a distributed reconstruction
+// the projections of each subset are dealt between the workers (the projection i of the subset goes to the
+// worker i % size), each worker backprojects its own ratios and the partial backprojections are added
+// with an all-reduce before the update: all the workers keep the same volume
+class DistributedBackend : public CPUBackend {
+
+public:
+
+  DistributedBackend( const ReconstructionContext& _context, Communicator* _communicator );   // takes the ownership of the communicator
+  virtual ~DistributedBackend();
+  
+  virtual const char* getName( void ) const { return "distributed CPU"; }
+  
+  virtual void reset( unsigned int _dim, float _pixelSize );
+  
+  virtual void projectSubset( const Volume& volume, const VolumeProjectionSet& scan, VolumeProjectionSet& ratios,
+                              unsigned int firstProjection, unsigned int step, bool convolve );
+  virtual void backProject( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve );
+  virtual void update( Volume& volume, float normalizationFactor );
+  
+protected:
+
+  Communicator* communicator;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _DISTRIBUTEDBACKEND_H
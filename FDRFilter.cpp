@@ -0,0 +1,208 @@
+
+#include "common.h"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "FDRFilter.h"
+#include "GaussianPSF.h"
+#include "THREADutils.h"
+#include "DBGutils.h"
+
+using namespace GPURec;
+
+
+// contexts shared by the threads of a parallel loop
+struct FDRTransformContext {
+
+  FFTutils::Complex* data;
+  const FFTutils::Plan* plan;
+  bool inverse;
+  unsigned int nbLines;
+  unsigned int nbThreads;
+  std::vector< std::vector<FFTutils::Complex> >* works;
+  
+  // first sample of the line L: (L % innerCount)*innerStride + (L / innerCount)*outerStride
+  unsigned int innerCount;
+  unsigned int innerStride;
+  unsigned int outerStride;
+  unsigned int sampleStride;
+};
+
+struct FDRFilterContext {
+
+  FFTutils::Complex* data;
+  const float* sigmas2;
+  unsigned int dim;
+};
+
+
+// signed frequency of the index k of a transform of size n
+static inline int signedFrequency( unsigned int k, unsigned int n ) {
+
+  return ( k <= n/2 ) ? (int)k : (int)k - (int)n;
+}
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  INITIALIZATION
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void FDRFilter::compute( const PSFKey& _key, unsigned int _nbAngles, float _angleIncrement ) {
+
+  assert( _key.dim > 0 && _nbAngles > 0 );
+
+  if( fabs( fabs( _angleIncrement ) * _nbAngles - 2.0 * M_PI ) > 1e-3 ) {
+    std::cerr << "FDR PSF: the projections have to be evenly spaced over 360 degrees" << std::endl;
+    std::cerr << "Number of projections:" << _nbAngles << " Angle increment:" << _angleIncrement << std::endl;
+    throw std::exception();
+  }
+
+  key = _key;
+  dim = key.dim;
+  pixelSize = key.pixelSize;
+  nbAngles = _nbAngles;
+  angleIncrement = _angleIncrement;
+  
+  dimPlan.initialize( dim );
+  anglePlan.initialize( nbAngles );
+  
+  // distance of the frequency (n, m) to the rotation axis, clamped to the volume
+  // the frequencies n = 0 carry no distance: the gaussian of the axis is used
+  float c = (dim - 1) / 2.0f;
+  sigmas2.resize( dim * nbAngles );
+  spectrum.resize( (size_t)dim * dim * nbAngles );
+  for( unsigned int m = 0; m < nbAngles; m++ )
+  for( unsigned int n = 0; n < dim; n++ ) {
+  
+    float t = 0.0f;
+    int fn = signedFrequency( n, dim );
+    if( fn != 0 ) {
+      t = - ( signedFrequency( m, nbAngles ) / (float)nbAngles ) * dim / ( fn * angleIncrement );
+      t = std::max( -c, std::min( t, c ) );
+    }
+    
+    float sigma = GaussianPSF::sigmaAtDistance( key.cameraRotationRadius / pixelSize + t, key );
+    sigmas2[ n + m*dim ] = sigma * sigma;
+  }
+  
+  std::cout << "FDR PSF: " << nbAngles << " projections per set" << std::endl;
+}
+
+
+void FDRFilter::clear( void ) {
+
+  dim = 0;
+  nbAngles = 0;
+  pixelSize = 0.0f;
+  angleIncrement = 0.0f;
+  dimPlan.initialize( 0 );
+  anglePlan.initialize( 0 );
+  sigmas2.clear();
+  std::vector<FFTutils::Complex>().swap( spectrum );
+  works.clear();
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  FILTERING
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void FDRFilter::transformLines( unsigned int begin, unsigned int end, void* context ) {
+
+  FDRTransformContext* ctx = (FDRTransformContext*)context;
+  std::vector<FFTutils::Complex>& work = (*ctx->works)[ THREADutils::getRangeIndex( 0, ctx->nbLines, begin, ctx->nbThreads ) ];
+  
+  for( unsigned int line = begin; line < end; line++ ) {
+  
+    FFTutils::Complex* first = ctx->data + (line % ctx->innerCount) * ctx->innerStride + (line / ctx->innerCount) * ctx->outerStride;
+    ctx->plan->transform( first, ctx->sampleStride, ctx->inverse, work.empty() ? 0 : &work[0] );
+  }
+}
+
+
+// layer m of the transform: frequencies (n, l) of the angular frequency m
+void FDRFilter::filterLayers( unsigned int begin, unsigned int end, void* context ) {
+
+  FDRFilterContext* ctx = (FDRFilterContext*)context;
+  unsigned int dim = ctx->dim;
+  
+  for( unsigned int m = begin; m < end; m++ ) {
+  
+    FFTutils::Complex* layer = ctx->data + m*dim*dim;
+    const float* sigmas2 = ctx->sigmas2 + m*dim;
+    
+    for( unsigned int l = 0; l < dim; l++ ) {
+    
+      float fl = signedFrequency( l, dim ) / (float)dim;
+      for( unsigned int n = 0; n < dim; n++ ) {
+      
+        // transfer function of a normalized gaussian: exp( -2 pi^2 sigma^2 f^2 )
+        float fn = signedFrequency( n, dim ) / (float)dim;
+        layer[ n + l*dim ] *= exp( -2.0 * M_PI * M_PI * sigmas2[n] * ( fn*fn + fl*fl ) );
+      }
+    }
+  }
+}
+
+
+void FDRFilter::apply( float* const* projections, unsigned int nbThreads, THREADutils::WorkerPool* workers ) {
+
+  assert( dim > 0 );
+  DBGutils::timerBegin("FDR PSF");
+
+  if( nbThreads == 0 ) nbThreads = THREADutils::getNbHardwareThreads();
+  if( works.size() != nbThreads ) {
+    works.resize( nbThreads );
+    for( unsigned int t = 0; t < nbThreads; t++ )
+      works[t].resize( std::max( dimPlan.getWorkSize(), anglePlan.getWorkSize() ) );
+  }
+
+  unsigned int layerSize = dim * dim;
+  for( unsigned int p = 0; p < nbAngles; p++ )
+    std::copy( projections[p], projections[p] + layerSize, spectrum.begin() + p*layerSize );
+    
+  // lines along u, z then angle; the inverse transforms in the same order
+  FDRTransformContext lines[3];
+  for( unsigned int axis = 0; axis < 3; axis++ ) {
+    lines[axis].data = &spectrum[0];
+    lines[axis].nbThreads = nbThreads;
+    lines[axis].works = &works;
+  }
+  
+  lines[0].plan = &dimPlan;   lines[0].innerCount = dim;        lines[0].innerStride = dim; lines[0].outerStride = layerSize; lines[0].sampleStride = 1;
+  lines[1].plan = &dimPlan;   lines[1].innerCount = dim;        lines[1].innerStride = 1;   lines[1].outerStride = layerSize; lines[1].sampleStride = dim;
+  lines[2].plan = &anglePlan; lines[2].innerCount = layerSize;  lines[2].innerStride = 1;   lines[2].outerStride = 0;         lines[2].sampleStride = layerSize;
+  unsigned int nbLines[3] = { dim * nbAngles, dim * nbAngles, layerSize };
+  for( unsigned int axis = 0; axis < 3; axis++ ) lines[axis].nbLines = nbLines[axis];
+  
+  for( unsigned int axis = 0; axis < 3; axis++ ) {
+    lines[axis].inverse = false;
+    THREADutils::parallelFor( 0, nbLines[axis], transformLines, &lines[axis], nbThreads, workers );
+  }
+  
+  FDRFilterContext filter;
+  filter.data = &spectrum[0];
+  filter.sigmas2 = &sigmas2[0];
+  filter.dim = dim;
+  THREADutils::parallelFor( 0, nbAngles, filterLayers, &filter, nbThreads, workers );
+  
+  for( unsigned int axis = 0; axis < 3; axis++ ) {
+    lines[axis].inverse = true;
+    THREADutils::parallelFor( 0, nbLines[axis], transformLines, &lines[axis], nbThreads, workers );
+  }
+  
+  // the filter is symmetric: the imaginary part is rounding noise
+  for( unsigned int p = 0; p < nbAngles; p++ )
+  for( unsigned int i = 0; i < layerSize; i++ )
+    projections[p][i] = (float)spectrum[ p*layerSize + i ].real();
+    
+  DBGutils::timerEnd("FDR PSF");
+}
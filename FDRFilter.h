@@ -0,0 +1,62 @@
+#ifndef _FDRFILTER_H
+#define _FDRFILTER_H
+
+#include <vector>
+
+#include "FFTutils.h"
+#include "PSFCache.h"
+#include "THREADutils.h"
+
+namespace GPURec {
+
+
+// Distance dependent PSF applied in the projection domain with the frequency-distance relation:
+// in the 2D Fourier transform of a sinogram (u, angle), the energy of the frequency (n, m) comes
+// from the points at the distance t = -(m/nbAngles) * dim / (n * angleIncrement) of the rotation axis.
+// Each frequency of the 3D transform (u, z, angle) of the set is multiplied by the transfer function
+// of the gaussian of that distance.
+// The set has to be evenly spaced over 360 degrees: an OSEM subset is such a set.
+class FDRFilter {
+
+public:
+
+  FDRFilter() : dim(0), nbAngles(0), pixelSize(0.0f), angleIncrement(0.0f) {}
+  
+  // angleIncrement is the signed angle between two consecutive projections of the set
+  // the key gives the dimension, the pixel size and the camera
+  void compute( const PSFKey& _key, unsigned int _nbAngles, float _angleIncrement );
+  void clear( void );
+  bool matches( const PSFKey& _key, unsigned int _nbAngles, float _angleIncrement ) const {
+    return dim == _key.dim && key == _key && nbAngles == _nbAngles && angleIncrement == _angleIncrement; 
+  }
+  
+  // filter in place the nbAngles projections (dim x dim, line major) of the set
+  // the filter is real and symmetric: it is its own adjoint, the same call blurs the projections and the ratios
+  // the spectrum and the work buffers are kept for the next calls, the loops run on the workers if given
+  void apply( float* const* projections, unsigned int nbThreads, THREADutils::WorkerPool* workers = 0 );
+  
+protected:
+
+  // parallel loop bodies
+  static void transformLines( unsigned int begin, unsigned int end, void* context );
+  static void filterLayers( unsigned int begin, unsigned int end, void* context );
+
+  unsigned int dim;
+  unsigned int nbAngles;
+  float pixelSize;
+  float angleIncrement;
+  PSFKey key;
+  
+  FFTutils::Plan dimPlan;      // u and z transforms
+  FFTutils::Plan anglePlan;    // angle transforms, Bluestein for the subsets of 120 or 40 projections
+  
+  std::vector<float> sigmas2;  // squared sigma (pixels) of the distance of each frequency (n, m), n + m*dim
+  
+  std::vector<FFTutils::Complex> spectrum;                    // 3D transform of the set
+  std::vector< std::vector<FFTutils::Complex> > works;        // work buffer of each range of the transforms
+};
+
+
+} // end namespace GPURec
+
+#endif  // _FDRFILTER_H
@@ -0,0 +1,105 @@
+
+#include "common.h"
+
+#include <algorithm>
+
+#include "FFTConvolution.h"
+#include "GaussianPSF.h"
+
+using namespace GPURec;
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  INITIALIZATION
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void FFTConvolution::compute( const GaussianPSF& psf ) {
+
+  dim = psf.getDim();
+  radius = psf.getRadius();
+  length = FFTutils::nextPowerOf2( dim + 2*radius );
+  plan.initialize( length );
+  
+  // the kernel is centered on the sample 0 of the circular transform
+  std::vector<FFTutils::Complex> kernel( length );
+  std::vector<FFTutils::Complex> work( plan.getWorkSize() );
+  kernelSpectra.resize( dim * length );
+  
+  for( unsigned int planeNum = 0; planeNum < dim; planeNum++ ) {
+  
+    const float* coefs = psf.getCoefs( planeNum );
+    std::fill( kernel.begin(), kernel.end(), FFTutils::Complex(0.0) );
+    kernel[0] = coefs[0];
+    for( unsigned int k = 1; k <= radius; k++ )
+      kernel[k] = kernel[ length-k ] = coefs[k];
+      
+    plan.transform( &kernel[0], 1, false, &work[0] );
+    for( unsigned int k = 0; k < length; k++ )
+      kernelSpectra[ planeNum * length + k ] = (float)kernel[k].real();
+  }
+}
+
+
+void FFTConvolution::clear( void ) {
+
+  dim = 0;
+  radius = 0;
+  length = 0;
+  plan.initialize( 0 );
+  kernelSpectra.clear();
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  CONVOLUTION
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void FFTConvolution::convolveLines( float* line0, float* line1, unsigned int stride, unsigned int nbSamples, unsigned int planeNum, FFTutils::Complex* work ) const {
+
+  FFTutils::Complex* buffer = work;
+  FFTutils::Complex* planWork = work + length;
+  int last = nbSamples - 1;
+  
+  // line0 in the real part, line1 in the imaginary part, clamped to the edge on radius samples
+  for( unsigned int i = 0; i < length; i++ ) {
+  
+    int u = (int)i - (int)radius;
+    if( u > last + (int)radius ) {
+      buffer[i] = 0.0;
+      continue;
+    }
+    
+    unsigned int index = std::min( std::max( u, 0 ), last ) * stride;
+    buffer[i] = FFTutils::Complex( line0[index], line1 ? line1[index] : 0.0f );
+  }
+  
+  plan.transform( buffer, 1, false, planWork );
+  
+  const float* spectrum = &kernelSpectra[ planeNum * length ];
+  for( unsigned int k = 0; k < length; k++ )
+    buffer[k] *= spectrum[k];
+    
+  plan.transform( buffer, 1, true, planWork );
+  
+  for( unsigned int u = 0; u < nbSamples; u++ ) {
+  
+    line0[ u*stride ] = (float)buffer[ u + radius ].real();
+    if( line1 ) line1[ u*stride ] = (float)buffer[ u + radius ].imag();
+  }
+}
+
+
+void FFTConvolution::convolvePlane( float* image, unsigned int nbLines, unsigned int planeNum, FFTutils::Complex* work ) const {
+
+  // pairs of lines, then pairs of columns
+  for( unsigned int z = 0; z < nbLines; z += 2 )
+    convolveLines( image + z*dim, ( z+1 < nbLines ) ? image + (z+1)*dim : 0, 1, dim, planeNum, work );
+    
+  for( unsigned int u = 0; u < dim; u += 2 )
+    convolveLines( image + u, ( u+1 < dim ) ? image + u+1 : 0, dim, nbLines, planeNum, work );
+}
@@ -0,0 +1,48 @@
+#ifndef _FFTCONVOLUTION_H
+#define _FFTCONVOLUTION_H
+
+#include <vector>
+
+#include "FFTutils.h"
+
+namespace GPURec {
+
+class GaussianPSF;
+
+
+// Convolution of projection lines with the PSF of a plane through FFTs: the cost per pixel
+// does not grow with the radius. The lines are extended by clamping to the edge, like the direct convolution.
+// The spectra of the kernels are real (symmetric kernels): two real lines share one complex transform.
+// The plan and the spectra of all the planes are computed once and reused for all the angles.
+class FFTConvolution {
+
+public:
+
+  FFTConvolution() : dim(0), radius(0), length(0) {}
+  
+  void compute( const GaussianPSF& psf );
+  void clear( void );
+  
+  unsigned int getLength( void ) const { return length; }                               // size of the transforms
+  unsigned int getWorkSize( void ) const { return length + plan.getWorkSize(); }        // work buffer of convolveLines
+  
+  // convolve in place the lines line0 and line1 (line1 may be null) of nbSamples <= dim samples spaced by stride
+  void convolveLines( float* line0, float* line1, unsigned int stride, unsigned int nbSamples, unsigned int planeNum, FFTutils::Complex* work ) const;
+  
+  // separable convolution of a (dim x nbLines) image, line major: horizontal (u) then vertical (z)
+  // work: getWorkSize() values
+  void convolvePlane( float* image, unsigned int nbLines, unsigned int planeNum, FFTutils::Complex* work ) const;
+  
+protected:
+
+  unsigned int dim;
+  unsigned int radius;
+  unsigned int length;                  // power of 2 >= dim + 2*radius: the circular convolution never wraps
+  FFTutils::Plan plan;
+  std::vector<float> kernelSpectra;     // length values per plane
+};
+
+
+} // end namespace GPURec
+
+#endif  // _FFTCONVOLUTION_H
@@ -0,0 +1,127 @@
+
+#include "common.h"
+
+#include "GLBackend.h"
+#include "Volume.h"
+#include "VolumeProjectionSet.h"
+#include "GPURecOpenGL.h"
+#include "GPUGaussianConv.h"
+#include "GPURecGLSL.h"
+#include "GLutils.h"
+#include "MEMutils.h"
+#include "DBGutils.h"
+
+using namespace GPURec;
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  INITIALIZATION
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void GLBackend::reset( unsigned int dim, float pixelSize ) {
+
+  if( context.useOSEM3D && context.psfModel == FDR_PSF ) {
+    std::cerr << "The FDR PSF model is only implemented by the CPU backend" << std::endl;
+    throw std::exception();
+  }
+
+  if( !context.attenuationMap.empty() ) {
+    std::cerr << "The attenuation correction is only implemented by the CPU backend" << std::endl;
+    throw std::exception();
+  }
+
+  GPURecOpenGL::reset( dim );
+  GPUGaussianConv::reset( PSFKey( dim, pixelSize, context ) );
+  if( USE_GLSL ) GPURecGLSL::reset( dim );
+}
+
+
+void GLBackend::terminate( void ) {
+
+  GPURecOpenGL::terminate();
+  GPUGaussianConv::terminate();
+  if( USE_GLSL ) GPURecGLSL::terminate();
+  MEMutils::clear();
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  TRANSFERS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+void GLBackend::uploadVolume( Volume& volume ) {
+
+  volume.sendToGraphicMemory();
+}
+
+
+void GLBackend::downloadVolume( Volume& volume ) {
+
+  volume.retrieveFromGraphicMemory();
+}
+
+
+// projections created from a file or a phantom are already in graphic memory
+void GLBackend::uploadProjections( VolumeProjectionSet& projSet ) {
+
+  if( projSet.getTexId() == 0 )
+    projSet.sendToGraphicMemory();
+}
+
+
+void GLBackend::downloadProjections( VolumeProjectionSet& projSet ) {
+
+  projSet.retrieveFromGraphicMemory();
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  KERNELS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+// the estimated projection is rendered in texQuarterDim
+void GLBackend::project( const Volume& volume, float angle, bool convolve ) {
+
+  glViewport( 0, 0, volume.getDim(), volume.getDim()/4 );
+  glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 ); GL_TEST_ERROR
+  
+  DBGutils::timerBegin("1 Projection");    
+  volume.projection( angle, convolve ); 
+  DBGutils::timerEnd("1 Projection");     
+}
+
+
+void GLBackend::ratio( const VolumeProjectionSet& scan, VolumeProjectionSet& ratios, unsigned int projNum ) {
+
+  ratios.divideProjection( scan, projNum, GPURecOpenGL::texQuarterDim );
+}
+
+
+void GLBackend::backProject( const VolumeProjectionSet& _ratios, unsigned int _firstProjection, unsigned int _step, bool convolve ) {
+
+  ratios = &_ratios;
+  firstProjection = _firstProjection;
+  step = _step;
+  convolveBackProjection = convolve;
+}
+
+
+void GLBackend::update( Volume& volume, float normalizationFactor ) {
+
+  assert( ratios != 0 );
+  
+  glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 ); GL_TEST_ERROR
+  glViewport( 0, 0, volume.getDim(), volume.getDim() );
+  
+  ratios->backProjection( volume, firstProjection, step, convolveBackProjection, normalizationFactor ); 
+  ratios = 0;
+}
+
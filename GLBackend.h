@@ -0,0 +1,47 @@
+#ifndef _GLBACKEND_H
+#define _GLBACKEND_H
+
+#include "ReconstructionBackend.h"
+
+namespace GPURec {
+
+
+// The kernels run on the GPU with the ARB programs, or the GLSL shaders when USE_GLSL is set
+// the backprojection of a slice group is only kept in graphic memory while the slices are updated:
+// backProject() records the subset and update() runs the two passes slice group by slice group
+class GLBackend : public ReconstructionBackend {
+
+public:
+
+  GLBackend( const ReconstructionContext& _context ) :
+    ReconstructionBackend( _context ), firstProjection(0), step(1), convolveBackProjection(false), ratios(0) {}
+  virtual ~GLBackend() {}
+  
+  virtual const char* getName( void ) const { return USE_GLSL ? "GL (GLSL)" : "GL (ARB)"; }
+  
+  virtual void reset( unsigned int dim, float pixelSize );
+  virtual void terminate( void );
+  
+  virtual void uploadVolume( Volume& volume );
+  virtual void downloadVolume( Volume& volume );
+  virtual void uploadProjections( VolumeProjectionSet& projSet );
+  virtual void downloadProjections( VolumeProjectionSet& projSet );
+  
+  virtual void project( const Volume& volume, float angle, bool convolve );
+  virtual void ratio( const VolumeProjectionSet& scan, VolumeProjectionSet& ratios, unsigned int projNum );
+  virtual void backProject( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve );
+  virtual void update( Volume& volume, float normalizationFactor );
+  
+protected:
+
+  // subset recorded by backProject()
+  unsigned int firstProjection;
+  unsigned int step;
+  bool convolveBackProjection;
+  const VolumeProjectionSet* ratios;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _GLBACKEND_H
@@ -9,6 +9,7 @@
 #include <sstream>
 
 #include "GPUGaussianConv.h"
+#include "PSFCache.h"
 #include "GPURecOpenGL.h"
 #include "GLutils.h"
 #include "DBGutils.h"
@@ -22,7 +23,7 @@ GLuint GPUGaussianConv::programVConv = 0;
 GLuint GPUGaussianConv::programVConvBackProject = 0;
 GLuint GPUGaussianConv::programHConvBackProject = 0;
 
-std::map< int, std::vector<float> > GPUGaussianConv::volumeGaussianCoefs;
+GaussianPSF GPUGaussianConv::psf;
 GLuint GPUGaussianConv::gaussianCoefsTex = 0; 
 GLuint GPUGaussianConv::packedGaussianCoefsTex = 0; 
 
@@ -32,44 +33,27 @@ unsigned int GPUGaussianConv::projHeight;
 
 GLuint GPUGaussianConv::bufferTex = 0; 
 bool GPUGaussianConv::initialized = false;
+PSFKey GPUGaussianConv::key;
 
-void GPUGaussianConv::initialize( unsigned int dim, float pixelSize ) {
 
-  assert( dim > 0 );
-  
-  // compute the convolution radius : use the last plane where sigma is maximum
-  // the computations has to be done in PIXEL unit !
-  float distMax = (CAMERA_ROTATION_RADIUS / pixelSize) + dim/2 + 0.5;
-  float sigmaMax = sqrt( ((distMax * COLLIMATOR_HOLES_DIAMETER / COLLIMATOR_DEPTH) * (distMax * COLLIMATOR_HOLES_DIAMETER / COLLIMATOR_DEPTH) + pow(CAMERA_RESOLUTION / pixelSize, 2) ) / ( 8 * M_LN2 ) ); 
-  convolutionRadius = (unsigned int)( CONVOLUTION_RADIUS_TRUNCATION_FACTOR * sigmaMax );
-  std::cout <<  "Convolution radius: " << convolutionRadius << std::endl;
+// the programs and the textures of the previous scan are kept when the PSF parameters didn't change
+void GPUGaussianConv::reset( const PSFKey& _key ) {
 
-  // compute the gaussian coefficients : There is 1 gaussian by projection plane
-  float sigma = 0;
-  for( unsigned int vsliceNum = 0; vsliceNum < dim; vsliceNum++ ) {
-    
-    float dist = (CAMERA_ROTATION_RADIUS / pixelSize) - (dim/2 - 0.5) + vsliceNum; 
-  
-    // compute gaussian sigma
-    float Rt2 = (dist * COLLIMATOR_HOLES_DIAMETER / COLLIMATOR_DEPTH) * (dist * COLLIMATOR_HOLES_DIAMETER / COLLIMATOR_DEPTH) + pow( CAMERA_RESOLUTION / pixelSize, 2 );
-    float sigma = sqrt( Rt2 / ( 8 * M_LN2 ) );
+  if( initialized && key == _key ) return;
 
-    float sum=0.0;
-    for( unsigned int iFilter = 0; iFilter <= convolutionRadius; iFilter++ ) {
+  terminate(); 
+  initialize( _key );
+}
 
-      float coef = exp( iFilter*iFilter / ( -2.0 * sigma * sigma ) ) / ( sqrt(2.0*M_PI) * sigma );   
-  
-      sum += coef;
-      volumeGaussianCoefs[vsliceNum].push_back( coef );
-    }  
-    
-    // we have the sum of a demi-gaussian, this operation deduces the whole gaussian sum
-    sum = 2 * sum - volumeGaussianCoefs[vsliceNum][0];
 
-    // normalize coefficients according to the sum
-    for( unsigned int i = 0; i < volumeGaussianCoefs[vsliceNum].size(); i++ )
-      volumeGaussianCoefs[vsliceNum][i] /= sum;    
-  }
+void GPUGaussianConv::initialize( const PSFKey& _key ) {
+
+  assert( _key.dim > 0 );
+  
+  key = _key;
+  unsigned int dim = key.dim;
+  psf = PSFCache::getPSF( key );
+  convolutionRadius = psf.getRadius();
   
   // create texture to store convolution intermediate results
   projWidth = dim;
@@ -86,6 +70,9 @@ void GPUGaussianConv::initialize( unsigned int dim, float pixelSize ) {
   // Definition of the horizontal convolution Fragment Program
   glGenProgramsARB(1, &programHConv);
 
+  std::string hcCode;
+  if( !PSFCache::findProgram( key, "hconv", hcCode ) ) {
+
   ////////////////// PROGRAM VERIFIED ////////////////////
   std::stringstream hcProgramCode;
   hcProgramCode << 
@@ -116,10 +103,13 @@ void GPUGaussianConv::initialize( unsigned int dim, float pixelSize ) {
       "MOV result.color, center;\n"
       "END\n";
   ///////////////////////////////////////////////////////
+  hcCode = hcProgramCode.str();
+  PSFCache::storeProgram( key, "hconv", hcCode );
+  }
 
   glBindProgramARB(GL_FRAGMENT_PROGRAM_ARB, programHConv);  
   glProgramStringARB(GL_FRAGMENT_PROGRAM_ARB, GL_PROGRAM_FORMAT_ASCII_ARB,
-                      hcProgramCode.str().length(), hcProgramCode.str().c_str() );
+                      hcCode.length(), hcCode.c_str() );
   
   GLint error_pos;
   glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &error_pos);
@@ -134,6 +124,9 @@ void GPUGaussianConv::initialize( unsigned int dim, float pixelSize ) {
   // Definition of the vertical convolution Fragment Program
   glGenProgramsARB(1, &programVConv);
 
+  std::string vcCode;
+  if( !PSFCache::findProgram( key, "vconv", vcCode ) ) {
+
   ////////////////// PROGRAM VERIFIED ////////////////////
   std::stringstream vcProgramCode;
   vcProgramCode << 
@@ -183,11 +176,13 @@ void GPUGaussianConv::initialize( unsigned int dim, float pixelSize ) {
       "MOV result.color, center;\n"
       "END\n";
   /////////////////////////////////////////////////////////
-  
-  
+  vcCode = vcProgramCode.str();
+  PSFCache::storeProgram( key, "vconv", vcCode );
+  }
+
   glBindProgramARB(GL_FRAGMENT_PROGRAM_ARB, programVConv);  
   glProgramStringARB(GL_FRAGMENT_PROGRAM_ARB, GL_PROGRAM_FORMAT_ASCII_ARB,
-                      vcProgramCode.str().length(), vcProgramCode.str().c_str() );
+                      vcCode.length(), vcCode.c_str() );
   
   glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &error_pos);
   if( error_pos != -1 ) {
@@ -203,6 +198,7 @@ void GPUGaussianConv::initialize( unsigned int dim, float pixelSize ) {
 }
 
 
+// the generated programs are read from the PSF cache when available
 void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
   
   // the width of the texture corresponds to the maximum gaussian radius +1 for the center coef
@@ -238,6 +234,9 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
    // fragment program for Horizontal Convolution and BackProjection
     glGenProgramsARB(1, &programHConvBackProject);
   
+    std::string code;
+    if( !PSFCache::findProgram( key, "hconv_backproject", code ) ) {
+
     ////////////////// PROGRAM VERIFIED ////////////////////
     std::stringstream programCode;
     programCode << 
@@ -287,11 +286,13 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
         "MOV result.color, center;\n"
         "END\n"; 
     //////////////////////////////////////////////////////////
-        
+    code = programCode.str();
+    PSFCache::storeProgram( key, "hconv_backproject", code );
+    }
         
     glBindProgramARB(GL_FRAGMENT_PROGRAM_ARB, programHConvBackProject);  
     glProgramStringARB(GL_FRAGMENT_PROGRAM_ARB, GL_PROGRAM_FORMAT_ASCII_ARB,
-                        programCode.str().length(), programCode.str().c_str() );
+                        code.length(), code.c_str() );
     
     GLint error_pos;
     glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &error_pos);
@@ -345,8 +346,12 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
     
     
     // fragment program for Vertical Convolution and BackProjection
+    // texture[0] is the 3D texture of the projections, texcoord[0].z selects the projection
     glGenProgramsARB(1, &programVConvBackProject);
  
+    std::string code;
+    if( !PSFCache::findProgram( key, "vconv_backproject", code ) ) {
+
 #ifndef PACK_BUG
 ///////////////////////////////////////////////////////////////////////////////////////////
     ////////////////// PROGRAM VERIFIED ////////////////////
@@ -366,7 +371,7 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
 
     // center pixel contribution
     programCode <<  
-        "TEX pixelContribution, currentPixelCoords, texture[0], 2D;\n"
+        "TEX pixelContribution, currentPixelCoords, texture[0], 3D;\n"
         // fetch coefficients to multiply with center pixel
         "MOV currentCoefCoords.x, " << 0.5/packedTexWidth << ";\n"   
         "TEX currentCoef, currentCoefCoords, texture[1], 2D;\n" 
@@ -383,11 +388,11 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
         programCode <<  
         // fetch the bottom neighboor texel 
         "ADD currentPixelCoords.y, fragment.texcoord[0].y, " << iFilter/(float)projHeight << ";\n"
-        "TEX topNeighboor, currentPixelCoords, texture[0], 2D;\n"
+        "TEX topNeighboor, currentPixelCoords, texture[0], 3D;\n"
         
         // fetch the top neighboor texel 
         "SUB currentPixelCoords.y, fragment.texcoord[0].y, " << iFilter/(float)projHeight << ";\n"
-        "TEX bottomNeighboor, currentPixelCoords, texture[0], 2D;\n"
+        "TEX bottomNeighboor, currentPixelCoords, texture[0], 3D;\n"
         
         // fetch coefficients 1..4
         "MOV currentCoefCoords.x, " << currentRadius++/packedTexWidth << ";\n"   
@@ -446,7 +451,7 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
 
     // center pixel contribution
     programCode <<  
-        "TEX pixelContribution, currentPixelCoords, texture[0], 2D;\n"
+        "TEX pixelContribution, currentPixelCoords, texture[0], 3D;\n"
         // fetch coefficients to multiply with center pixel
         "MOV currentCoefCoords.x, " << 0.5/packedTexWidth << ";\n"   
         "TEX currentCoef, currentCoefCoords, texture[1], 2D;\n" 
@@ -463,11 +468,11 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
         programCode <<  
         // fetch the bottom neighboor texel 
         "ADD currentPixelCoords.y, fragment.texcoord[0].y, " << iFilter/(float)projHeight << ";\n"
-        "TEX topNeighboor, currentPixelCoords, texture[0], 2D;\n"
+        "TEX topNeighboor, currentPixelCoords, texture[0], 3D;\n"
         
         // fetch the top neighboor texel 
         "SUB currentPixelCoords.y, fragment.texcoord[0].y, " << iFilter/(float)projHeight << ";\n"
-        "TEX bottomNeighboor, currentPixelCoords, texture[0], 2D;\n"
+        "TEX bottomNeighboor, currentPixelCoords, texture[0], 3D;\n"
         
         // fetch coefficients 1..4
         "MOV currentCoefCoords.x, " << currentRadius++/packedTexWidth << ";\n"   
@@ -507,10 +512,13 @@ void GPUGaussianConv::computeGaussianCoefsTextures( unsigned int dim ) {
         "END\n";
     ///////////////////////////////////////////////////////////////////////////////////////////
 #endif 
-        
+    code = programCode.str();
+    PSFCache::storeProgram( key, "vconv_backproject", code );
+    }
+
     glBindProgramARB(GL_FRAGMENT_PROGRAM_ARB, programVConvBackProject);  
     glProgramStringARB(GL_FRAGMENT_PROGRAM_ARB, GL_PROGRAM_FORMAT_ASCII_ARB,
-                        programCode.str().length(), programCode.str().c_str() );
+                        code.length(), code.c_str() );
     
     GLint error_pos;
     glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &error_pos);
@@ -544,7 +552,7 @@ void GPUGaussianConv::convolveTexture( GLuint inputTex, unsigned int vsliceNum )
   glEnable( GL_FRAGMENT_PROGRAM_ARB );
   glBindProgramARB( GL_FRAGMENT_PROGRAM_ARB, programHConv );  GL_TEST_ERROR
   
-  for( unsigned int iFilter = 0; iFilter < volumeGaussianCoefs[vsliceNum].size(); iFilter++ )
+  for( unsigned int iFilter = 0; iFilter <= convolutionRadius; iFilter++ )
     glProgramLocalParameter4fARB( GL_FRAGMENT_PROGRAM_ARB, iFilter, getCoef(vsliceNum,iFilter), getCoef(vsliceNum,iFilter), getCoef(vsliceNum,iFilter), getCoef(vsliceNum,iFilter) );
      
   glBegin(GL_QUADS);
@@ -585,7 +593,7 @@ void GPUGaussianConv::convolveTexture( GLuint inputTex, unsigned int vsliceNum )
 }
 
 
-void GPUGaussianConv::convolveAndBackProject( GLuint inputTex, float angle, unsigned int hsliceNum ) {
+void GPUGaussianConv::convolveAndBackProject( GLuint projectionsTex, float layerCoord, float angle, unsigned int hsliceNum ) {
 
   DBGutils::timerBegin("convback");
 
@@ -594,7 +602,7 @@ void GPUGaussianConv::convolveAndBackProject( GLuint inputTex, float angle, unsi
   glPushAttrib( GL_ENABLE_BIT ); GL_TEST_ERROR
 
   glActiveTextureARB(GL_TEXTURE0_ARB);  GL_TEST_ERROR 
-  glBindTexture( GL_TEXTURE_2D, inputTex ); GL_TEST_ERROR  
+  glBindTexture( GL_TEXTURE_3D, projectionsTex ); GL_TEST_ERROR  
   
    glActiveTextureARB(GL_TEXTURE1_ARB);  GL_TEST_ERROR 
    glEnable( GL_TEXTURE_2D );
@@ -607,10 +615,10 @@ void GPUGaussianConv::convolveAndBackProject( GLuint inputTex, float angle, unsi
   glClear(GL_COLOR_BUFFER_BIT);
   
   glBegin(GL_QUADS);
-    glTexCoord2f( 0, (0.5+hsliceNum)/projHeight ); glVertex3f(-1,-1,0); 
-    glTexCoord2f( 1, (0.5+hsliceNum)/projHeight ); glVertex3f(1,-1,0); 
-    glTexCoord2f( 1, (0.5+hsliceNum)/projHeight ); glVertex3f(1,1,0); 
-    glTexCoord2f( 0, (0.5+hsliceNum)/projHeight ); glVertex3f(-1,1,0);
+    glTexCoord3f( 0, (0.5+hsliceNum)/projHeight, layerCoord ); glVertex3f(-1,-1,0); 
+    glTexCoord3f( 1, (0.5+hsliceNum)/projHeight, layerCoord ); glVertex3f(1,-1,0); 
+    glTexCoord3f( 1, (0.5+hsliceNum)/projHeight, layerCoord ); glVertex3f(1,1,0); 
+    glTexCoord3f( 0, (0.5+hsliceNum)/projHeight, layerCoord ); glVertex3f(-1,1,0);
   glEnd();  
   
   glActiveTextureARB(GL_TEXTURE1_ARB);  GL_TEST_ERROR 
@@ -652,7 +660,8 @@ void GPUGaussianConv::convolveAndBackProject( GLuint inputTex, float angle, unsi
 
 void GPUGaussianConv::terminate( void ) {
 
-  volumeGaussianCoefs.clear();
+  psf.clear();
+  initialized = false;
     
   if( programVConv ) {
     glDeleteProgramsARB( 1, &programVConv );
@@ -2,8 +2,8 @@
 #ifndef _GPUGAUSSIANCONV_H
 #define _GPUGAUSSIANCONV_H
 
-#include <vector>
-#include <map>
+#include "GaussianPSF.h"
+#include "PSFCache.h"
 
 
 namespace GPURec {
@@ -14,24 +14,29 @@ class GPUGaussianConv {
 
 public:
 
-  static void initialize( unsigned int dim, float pixelSize );
+  // the PSF of the key: dimension, pixel size and camera
+  // the GL objects are shared by the process, the convolutions run in the GL thread only
+  static void initialize( const PSFKey& _key );
   static void terminate( void );  
-  static void reset( unsigned int dim, float pixelSize ) { terminate(); initialize(dim, pixelSize); }
+  static void reset( const PSFKey& _key );    // no-op when the PSF parameters didn't change
  
   static void convolveTexture       ( GLuint inputTex, unsigned int vsliceNum ); 
-  static void convolveAndBackProject( GLuint inputTex, float angle, unsigned int hsliceNum ); 
+  static void convolveAndBackProject( GLuint projectionsTex, float layerCoord, float angle, unsigned int hsliceNum ); 
+  
+  // coefficient tables shared with the GLSL path
+  // getCoef returns the value of the gaussian coef or zero if outside the domain definition
+  static unsigned int getConvolutionRadius( void ) { return convolutionRadius; }
+  static float getCoef( unsigned int vsliceNum, unsigned int index ) { return psf.getCoef( vsliceNum, index ); }
     
 private:
 
   // create textures storing the gaussian coefficients
   static void computeGaussianCoefsTextures( unsigned int dim ); 
   
-  // return the value of the gaussian coef or zero if outside the domain definition
-  static float getCoef( unsigned int vsliceNum, unsigned int index ) { return (index < volumeGaussianCoefs[vsliceNum].size()) ? volumeGaussianCoefs[vsliceNum][index] : 0.0; }
-  
   
-  // container and textures to store gaussian coefficients
-  static std::map<int /*vsliceNum*/, std::vector<float> /*gaussianCoefs*/> volumeGaussianCoefs;
+  // gaussian coefficients and textures storing them
+  static GaussianPSF psf;
+  static PSFKey key;
   static GLuint gaussianCoefsTex; 
   static GLuint packedGaussianCoefsTex; 
   
@@ -0,0 +1,718 @@
+
+#include "common.h"
+#include <GL/glew.h>
+#include <GL/glut.h>
+
+#include "GPURecGLSL.h"
+#include "GPUGaussianConv.h"
+#include "GLutils.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+
+using namespace GPURec;
+
+GLuint GPURecGLSL::dim = 0;
+
+GLuint GPURecGLSL::quadVAO = 0;
+GLuint GPURecGLSL::quadVBO = 0;
+
+GLuint GPURecGLSL::projectionProgram = 0;
+GLuint GPURecGLSL::projectionHConvProgram = 0;
+GLuint GPURecGLSL::projectionVConvProgram = 0;
+GLuint GPURecGLSL::divideProgram = 0;
+GLuint GPURecGLSL::backProjectProgram = 0;
+GLuint GPURecGLSL::backProjectVConvProgram = 0;
+GLuint GPURecGLSL::backProjectHConvProgram = 0;
+GLuint GPURecGLSL::updateSliceProgram = 0;
+
+GLuint GPURecGLSL::coefsBuffer = 0;
+GLuint GPURecGLSL::coefsTex = 0;
+unsigned int GPURecGLSL::convolutionRadius = 0;
+
+GLuint GPURecGLSL::anglesBuffer = 0;
+GLuint GPURecGLSL::anglesTex = 0;
+unsigned int GPURecGLSL::maxSubsetSize = 0;
+
+GLuint GPURecGLSL::planesTex = 0;
+GLuint GPURecGLSL::subsetLinesTex = 0;
+
+bool GPURecGLSL::initialized = false;
+
+
+// texture units used by all the programs
+enum { INPUT_UNIT = 0, SECOND_INPUT_UNIT = 1, COEFS_UNIT = 2, ANGLES_UNIT = 3 };
+
+
+// ============================================================================================
+// --------------------------------------------------------------------------------------------
+//  SHADERS
+// ============================================================================================
+
+// the planes of a projection: one instance per plane, rotated in texture space around the volume axis
+static const char* planesVertexCode =
+    "#version 150 core\n"
+    "in vec2 corner;\n"
+    "uniform vec2 rotation;\n"        // cosine and sine of the projection angle
+    "uniform float dim;\n"
+    "out VertexData { vec3 volumeCoord; flat int plane; } vs;\n"
+    "void main() {\n"
+    "  vec2 st = vec2( corner.x, (0.5 + float(gl_InstanceID)) / dim ) - 0.5;\n"
+    "  vs.volumeCoord = vec3( 0.5 + rotation.x * st.x - rotation.y * st.y,\n"
+    "                         0.5 + rotation.y * st.x + rotation.x * st.y, corner.y );\n"
+    "  vs.plane = gl_InstanceID;\n"
+    "  gl_Position = vec4( 2.0 * corner - 1.0, 0.0, 1.0 );\n"
+    "}\n";
+
+// full screen quads: one instance per layer
+static const char* layersVertexCode =
+    "#version 150 core\n"
+    "in vec2 corner;\n"
+    "out VertexData { vec3 volumeCoord; flat int plane; } vs;\n"
+    "void main() {\n"
+    "  vs.volumeCoord = vec3( corner, 0.0 );\n"
+    "  vs.plane = gl_InstanceID;\n"
+    "  gl_Position = vec4( 2.0 * corner - 1.0, 0.0, 1.0 );\n"
+    "}\n";
+
+// send each instance to the layer of the same index
+static const char* layeredGeometryCode =
+    "#version 150 core\n"
+    "layout(triangles) in;\n"
+    "layout(triangle_strip, max_vertices = 3) out;\n"
+    "in VertexData { vec3 volumeCoord; flat int plane; } vs[];\n"
+    "out VertexData { vec3 volumeCoord; flat int plane; } gs;\n"
+    "void main() {\n"
+    "  for( int i = 0; i < 3; i++ ) {\n"
+    "    gl_Layer = vs[i].plane;\n"
+    "    gs.volumeCoord = vs[i].volumeCoord;\n"
+    "    gs.plane = vs[i].plane;\n"
+    "    gl_Position = gl_in[i].gl_Position;\n"
+    "    EmitVertex();\n"
+    "  }\n"
+    "  EndPrimitive();\n"
+    "}\n";
+
+static const char* screenVertexCode =
+    "#version 150 core\n"
+    "in vec2 corner;\n"
+    "flat out int instance;\n"
+    "void main() {\n"
+    "  instance = gl_InstanceID;\n"
+    "  gl_Position = vec4( 2.0 * corner - 1.0, 0.0, 1.0 );\n"
+    "}\n";
+
+// one quad per projection of the subset, rotated with the projection angle (top view)
+static const char* backProjectVertexCode =
+    "#version 150 core\n"
+    "in vec2 corner;\n"
+    "uniform samplerBuffer angles;\n"
+    "uniform int firstProjection;\n"
+    "uniform int projectionStep;\n"
+    "out BackProjectData { vec2 texCoord; flat int projNum; flat int subsetIndex; } vs;\n"
+    "void main() {\n"
+    "  float angle = texelFetch( angles, gl_InstanceID ).r;\n"
+    "  vec2 position = 2.0 * corner - 1.0;\n"
+    "  gl_Position = vec4( cos(angle) * position.x - sin(angle) * position.y,\n"
+    "                      sin(angle) * position.x + cos(angle) * position.y, 0.0, 1.0 );\n"
+    "  vs.texCoord = corner;\n"
+    "  vs.projNum = firstProjection + gl_InstanceID * projectionStep;\n"
+    "  vs.subsetIndex = gl_InstanceID;\n"
+    "}\n";
+
+static const char* projectionFragmentCode =
+    "#version 150 core\n"
+    "uniform sampler3D volume;\n"
+    "in VertexData { vec3 volumeCoord; flat int plane; } fs;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  if( any( lessThan( fs.volumeCoord.xy, vec2(0.0) ) ) || any( greaterThan( fs.volumeCoord.xy, vec2(1.0) ) ) )\n"
+    "    discard;\n"  // outside the volume
+    "  color = texture( volume, fs.volumeCoord );\n"
+    "}\n";
+
+// horizontal convolution of a plane, computed while sampling the volume
+static const char* projectionHConvFragmentCode =
+    "#version 150 core\n"
+    "uniform sampler3D volume;\n"
+    "uniform samplerBuffer coefs;\n"
+    "uniform int radius;\n"
+    "uniform vec2 rotation;\n"
+    "uniform float dim;\n"
+    "in VertexData { vec3 volumeCoord; flat int plane; } fs;\n"
+    "out vec4 color;\n"
+    "vec4 planeSample( float offset ) {\n"
+    "  vec3 coord = fs.volumeCoord + vec3( rotation * offset / dim, 0.0 );\n"
+    "  if( any( lessThan( coord.xy, vec2(0.0) ) ) || any( greaterThan( coord.xy, vec2(1.0) ) ) )\n"
+    "    return vec4(0.0);\n"
+    "  return texture( volume, coord );\n"
+    "}\n"
+    "void main() {\n"
+    "  int first = fs.plane * (radius + 1);\n"
+    "  vec4 sum = texelFetch( coefs, first ).r * planeSample( 0.0 );\n"
+    "  for( int k = 1; k <= radius; k++ )\n"
+    "    sum += texelFetch( coefs, first + k ).r * ( planeSample( float(k) ) + planeSample( float(-k) ) );\n"
+    "  color = sum;\n"
+    "}\n";
+
+// vertical convolution of images whose lines are packed by 4 in RGBA texels (line 4t in A, 4t+3 in R)
+// PACKED_SAMPLER has to be defined before: sampler2DArray or sampler3D, both indexed by (column, texel line, layer)
+static const char* packedVerticalConvolutionCode =
+    "uniform PACKED_SAMPLER packedLines;\n"
+    "uniform samplerBuffer coefs;\n"
+    "uniform int radius;\n"
+    "uniform int nbTexelLines;\n"
+    "vec4 verticalConvolution( ivec2 texel, int layer, int plane ) {\n"
+    "  int first = plane * (radius + 1);\n"
+    "  int span = (radius + 3) / 4;\n"
+    "  vec4 sum = vec4(0.0);\n"
+    "  for( int dt = -span; dt <= span; dt++ ) {\n"
+    "    int t = texel.y + dt;\n"
+    "    vec4 lines;\n"  // clamp to edge
+    "    if( t < 0 ) lines = vec4( texelFetch( packedLines, ivec3( texel.x, 0, layer ), 0 ).a );\n"
+    "    else if( t >= nbTexelLines ) lines = vec4( texelFetch( packedLines, ivec3( texel.x, nbTexelLines - 1, layer ), 0 ).r );\n"
+    "    else lines = texelFetch( packedLines, ivec3( texel.x, t, layer ), 0 );\n"
+    "    for( int c = 0; c < 4; c++ )\n"
+    "    for( int o = 0; o < 4; o++ ) {\n"
+    "      int k = abs( 4 * dt + o - c );\n"  // distance between the lines of channels c and o
+    "      if( k <= radius ) sum[o] += texelFetch( coefs, first + k ).r * lines[c];\n"
+    "    }\n"
+    "  }\n"
+    "  return sum;\n"
+    "}\n";
+
+static const char* projectionVConvFragmentCode =
+    "#version 150 core\n"
+    "#define PACKED_SAMPLER sampler2DArray\n";
+
+static const char* projectionVConvMainCode =
+    "flat in int instance;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  color = verticalConvolution( ivec2( gl_FragCoord.xy ), instance, instance );\n"
+    "}\n";
+
+static const char* divideFragmentCode =
+    "#version 150 core\n"
+    "uniform sampler3D measured;\n"
+    "uniform sampler2D estimated;\n"
+    "uniform int projNum;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  ivec2 texel = ivec2( gl_FragCoord.xy );\n"
+    "  color = texelFetch( measured, ivec3( texel, projNum ), 0 ) / max( texelFetch( estimated, texel, 0 ), vec4(0.1) );\n"
+    "}\n";
+
+static const char* backProjectFragmentCode =
+    "#version 150 core\n"
+    "uniform sampler3D projections;\n"
+    "uniform int sliceNum;\n"
+    "uniform float dim;\n"
+    "in BackProjectData { vec2 texCoord; flat int projNum; flat int subsetIndex; } fs;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  int column = clamp( int( fs.texCoord.x * dim ), 0, int(dim) - 1 );\n"
+    "  color = texelFetch( projections, ivec3( column, sliceNum, fs.projNum ), 0 );\n"
+    "}\n";
+
+// one layer per projection of the subset: line v holds the slice lines convolved with the gaussian of plane v
+static const char* backProjectVConvFragmentCode =
+    "#version 150 core\n"
+    "#define PACKED_SAMPLER sampler3D\n";
+
+static const char* backProjectVConvMainCode =
+    "uniform int sliceNum;\n"
+    "uniform int firstProjection;\n"
+    "uniform int projectionStep;\n"
+    "in VertexData { vec3 volumeCoord; flat int plane; } fs;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  color = verticalConvolution( ivec2( gl_FragCoord.x, sliceNum ), firstProjection + fs.plane * projectionStep, int( gl_FragCoord.y ) );\n"
+    "}\n";
+
+// horizontal convolution with the gaussian of the plane the fragment belongs to
+static const char* backProjectHConvFragmentCode =
+    "#version 150 core\n"
+    "uniform sampler2DArray subsetLines;\n"
+    "uniform samplerBuffer coefs;\n"
+    "uniform int radius;\n"
+    "uniform float dim;\n"
+    "in BackProjectData { vec2 texCoord; flat int projNum; flat int subsetIndex; } fs;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  int last = int(dim) - 1;\n"
+    "  ivec2 texel = clamp( ivec2( fs.texCoord * dim ), ivec2(0), ivec2(last) );\n"
+    "  int first = texel.y * (radius + 1);\n"
+    "  vec4 sum = texelFetch( coefs, first ).r * texelFetch( subsetLines, ivec3( texel, fs.subsetIndex ), 0 );\n"
+    "  for( int k = 1; k <= radius; k++ ) {\n"
+    "    vec4 right = texelFetch( subsetLines, ivec3( min( texel.x + k, last ), texel.y, fs.subsetIndex ), 0 );\n"
+    "    vec4 left = texelFetch( subsetLines, ivec3( max( texel.x - k, 0 ), texel.y, fs.subsetIndex ), 0 );\n"
+    "    sum += texelFetch( coefs, first + k ).r * ( right + left );\n"
+    "  }\n"
+    "  color = sum;\n"
+    "}\n";
+
+static const char* updateSliceFragmentCode =
+    "#version 150 core\n"
+    "uniform sampler3D volume;\n"
+    "uniform sampler2D backProjection;\n"
+    "uniform int sliceNum;\n"
+    "uniform float normalizationFactor;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "  ivec2 texel = ivec2( gl_FragCoord.xy );\n"
+    "  vec4 value = texelFetch( volume, ivec3( texel, sliceNum ), 0 ) * texelFetch( backProjection, texel, 0 ) * normalizationFactor;\n"
+    "  color = min( value, vec4(60000.0) );\n"
+    "}\n";
+
+
+
+// ============================================================================================
+// --------------------------------------------------------------------------------------------
+//  INITIALIZATION
+// ============================================================================================
+
+void GPURecGLSL::initialize( unsigned int _dim ) {
+
+  if( !GLEW_VERSION_3_2 ) {
+    std::cerr << "The GLSL path requires OpenGL 3.2 (instanced drawing, geometry shaders and texture buffers)" << std::endl;
+    throw std::exception();
+  }
+
+  dim = _dim;
+  initBuffers();
+  initPrograms();
+  initPSFResources();
+
+  initialized = true;
+}
+
+void GPURecGLSL::reset( unsigned int _dim ) {
+
+  if( !initialized ) {
+
+    initialize( _dim );
+    return;
+  }
+
+  terminatePSFResources();
+  dim = _dim;
+  initPSFResources();
+}
+
+void GPURecGLSL::terminate( void ) {
+
+  terminatePSFResources();
+
+  GLuint* programs[] = { &projectionProgram, &projectionHConvProgram, &projectionVConvProgram, &divideProgram,
+                         &backProjectProgram, &backProjectVConvProgram, &backProjectHConvProgram, &updateSliceProgram };
+  for( unsigned int i = 0; i < sizeof(programs)/sizeof(GLuint*); i++ ) {
+    if( *programs[i] ) {
+      glDeleteProgram( *programs[i] );
+      *programs[i] = 0;
+    }
+  }
+
+  if( quadVBO ) {
+    glDeleteBuffers( 1, &quadVBO );
+    quadVBO = 0;
+  }
+
+  if( quadVAO ) {
+    glDeleteVertexArrays( 1, &quadVAO );
+    quadVAO = 0;
+  }
+
+  initialized = false;
+}
+
+void GPURecGLSL::initBuffers( void ) {
+
+  // unit quad as a triangle strip, the attribute 0 is the corner position in [0,1]
+  const float corners[] = { 0,0,  1,0,  0,1,  1,1 };
+
+  glGenVertexArrays( 1, &quadVAO );  GL_TEST_ERROR
+  glBindVertexArray( quadVAO );  GL_TEST_ERROR
+
+  glGenBuffers( 1, &quadVBO );  GL_TEST_ERROR
+  glBindBuffer( GL_ARRAY_BUFFER, quadVBO );  GL_TEST_ERROR
+  glBufferData( GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW );  GL_TEST_ERROR
+  glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 0, 0 );  GL_TEST_ERROR
+  glEnableVertexAttribArray( 0 );  GL_TEST_ERROR
+
+  glBindVertexArray( 0 );
+  glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+void GPURecGLSL::initPrograms( void ) {
+
+  std::string projectionVConvCode = std::string( projectionVConvFragmentCode ) + packedVerticalConvolutionCode + projectionVConvMainCode;
+  std::string backProjectVConvCode = std::string( backProjectVConvFragmentCode ) + packedVerticalConvolutionCode + backProjectVConvMainCode;
+
+  projectionProgram       = linkProgram( planesVertexCode, 0, projectionFragmentCode );
+  projectionHConvProgram  = linkProgram( planesVertexCode, layeredGeometryCode, projectionHConvFragmentCode );
+  projectionVConvProgram  = linkProgram( screenVertexCode, 0, projectionVConvCode.c_str() );
+  divideProgram           = linkProgram( screenVertexCode, 0, divideFragmentCode );
+  backProjectProgram      = linkProgram( backProjectVertexCode, 0, backProjectFragmentCode );
+  backProjectVConvProgram = linkProgram( layersVertexCode, layeredGeometryCode, backProjectVConvCode.c_str() );
+  backProjectHConvProgram = linkProgram( backProjectVertexCode, 0, backProjectHConvFragmentCode );
+  updateSliceProgram      = linkProgram( screenVertexCode, 0, updateSliceFragmentCode );
+
+  // samplers are bound to fixed texture units (unused names are ignored)
+  GLuint programs[] = { projectionProgram, projectionHConvProgram, projectionVConvProgram, divideProgram,
+                        backProjectProgram, backProjectVConvProgram, backProjectHConvProgram, updateSliceProgram };
+  for( unsigned int i = 0; i < sizeof(programs)/sizeof(GLuint); i++ ) {
+
+    glUseProgram( programs[i] );
+    glUniform1i( glGetUniformLocation( programs[i], "volume" ), INPUT_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "measured" ), INPUT_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "projections" ), INPUT_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "packedLines" ), INPUT_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "subsetLines" ), INPUT_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "estimated" ), SECOND_INPUT_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "backProjection" ), SECOND_INPUT_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "coefs" ), COEFS_UNIT );
+    glUniform1i( glGetUniformLocation( programs[i], "angles" ), ANGLES_UNIT );
+  }
+  glUseProgram( 0 );  GL_TEST_ERROR
+}
+
+// resources depending on the volume dimension and on the PSF coefficients
+void GPURecGLSL::initPSFResources( void ) {
+
+  // copy all the gaussian coefficients in a texture buffer: (radius+1) coefficients per plane
+  convolutionRadius = GPUGaussianConv::getConvolutionRadius();
+  std::vector<float> coefs( dim * (convolutionRadius + 1) );
+  for( unsigned int v = 0; v < dim; v++ )
+  for( unsigned int k = 0; k <= convolutionRadius; k++ )
+    coefs[ v * (convolutionRadius + 1) + k ] = GPUGaussianConv::getCoef( v, k );
+
+  glGenBuffers( 1, &coefsBuffer );  GL_TEST_ERROR
+  glBindBuffer( GL_TEXTURE_BUFFER, coefsBuffer );  GL_TEST_ERROR
+  glBufferData( GL_TEXTURE_BUFFER, coefs.size() * sizeof(float), &coefs[0], GL_STATIC_DRAW );  GL_TEST_ERROR
+  glGenTextures( 1, &coefsTex );  GL_TEST_ERROR
+  glBindTexture( GL_TEXTURE_BUFFER, coefsTex );  GL_TEST_ERROR
+  glTexBuffer( GL_TEXTURE_BUFFER, GL_R32F, coefsBuffer );  GL_TEST_ERROR
+
+  // the angles buffer grows with the subset size
+  glGenBuffers( 1, &anglesBuffer );  GL_TEST_ERROR
+  glGenTextures( 1, &anglesTex );  GL_TEST_ERROR
+  maxSubsetSize = 0;
+
+  glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+  glBindTexture( GL_TEXTURE_BUFFER, 0 );
+
+  // the planes of a projection
+  glGenTextures( 1, &planesTex );  GL_TEST_ERROR
+  glBindTexture( GL_TEXTURE_2D_ARRAY, planesTex );  GL_TEST_ERROR
+  glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, GL_RGBA16F, dim, dim/4, dim, 0, GL_RGBA, GL_FLOAT, NULL );  GL_TEST_ERROR
+  glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+  glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+  glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+
+  subsetLinesTex = 0;
+
+  glUseProgram( projectionHConvProgram );
+  glUniform1i( glGetUniformLocation( projectionHConvProgram, "radius" ), convolutionRadius );
+  glUniform1f( glGetUniformLocation( projectionHConvProgram, "dim" ), (float)dim );
+  glUseProgram( projectionProgram );
+  glUniform1f( glGetUniformLocation( projectionProgram, "dim" ), (float)dim );
+  glUseProgram( projectionVConvProgram );
+  glUniform1i( glGetUniformLocation( projectionVConvProgram, "radius" ), convolutionRadius );
+  glUniform1i( glGetUniformLocation( projectionVConvProgram, "nbTexelLines" ), dim/4 );
+  glUseProgram( backProjectProgram );
+  glUniform1f( glGetUniformLocation( backProjectProgram, "dim" ), (float)dim );
+  glUseProgram( backProjectVConvProgram );
+  glUniform1i( glGetUniformLocation( backProjectVConvProgram, "radius" ), convolutionRadius );
+  glUniform1i( glGetUniformLocation( backProjectVConvProgram, "nbTexelLines" ), dim/4 );
+  glUseProgram( backProjectHConvProgram );
+  glUniform1i( glGetUniformLocation( backProjectHConvProgram, "radius" ), convolutionRadius );
+  glUniform1f( glGetUniformLocation( backProjectHConvProgram, "dim" ), (float)dim );
+  glUseProgram( 0 );  GL_TEST_ERROR
+}
+
+void GPURecGLSL::terminatePSFResources( void ) {
+
+  GLuint* textures[] = { &coefsTex, &anglesTex, &planesTex, &subsetLinesTex };
+  for( unsigned int i = 0; i < sizeof(textures)/sizeof(GLuint*); i++ ) {
+    if( *textures[i] ) {
+      glDeleteTextures( 1, textures[i] );
+      *textures[i] = 0;
+    }
+  }
+
+  if( coefsBuffer ) {
+    glDeleteBuffers( 1, &coefsBuffer );
+    coefsBuffer = 0;
+  }
+
+  if( anglesBuffer ) {
+    glDeleteBuffers( 1, &anglesBuffer );
+    anglesBuffer = 0;
+  }
+
+  maxSubsetSize = 0;
+}
+
+GLuint GPURecGLSL::compileShader( GLenum type, const char* code ) {
+
+  GLuint shader = glCreateShader( type );
+  glShaderSource( shader, 1, &code, NULL );
+  glCompileShader( shader );
+
+  GLint status;
+  glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+  if( status != GL_TRUE ) {
+
+    char log[1024];
+    glGetShaderInfoLog( shader, sizeof(log), NULL, log );
+    std::cerr << "Shader compilation error: " << log << std::endl;
+    throw std::exception();
+  }
+
+  return shader;
+}
+
+GLuint GPURecGLSL::linkProgram( const char* vertexCode, const char* geometryCode, const char* fragmentCode ) {
+
+  GLuint program = glCreateProgram();
+
+  GLuint vertexShader = compileShader( GL_VERTEX_SHADER, vertexCode );
+  glAttachShader( program, vertexShader );
+
+  GLuint geometryShader = 0;
+  if( geometryCode ) {
+    geometryShader = compileShader( GL_GEOMETRY_SHADER, geometryCode );
+    glAttachShader( program, geometryShader );
+  }
+
+  GLuint fragmentShader = compileShader( GL_FRAGMENT_SHADER, fragmentCode );
+  glAttachShader( program, fragmentShader );
+
+  glBindAttribLocation( program, 0, "corner" );
+  glBindFragDataLocation( program, 0, "color" );
+  glLinkProgram( program );
+
+  // shaders are no more needed once linked
+  glDeleteShader( vertexShader );
+  if( geometryShader ) glDeleteShader( geometryShader );
+  glDeleteShader( fragmentShader );
+
+  GLint status;
+  glGetProgramiv( program, GL_LINK_STATUS, &status );
+  if( status != GL_TRUE ) {
+
+    char log[1024];
+    glGetProgramInfoLog( program, sizeof(log), NULL, log );
+    std::cerr << "Program link error: " << log << std::endl;
+    throw std::exception();
+  }
+
+  return program;
+}
+
+
+
+// ============================================================================================
+// --------------------------------------------------------------------------------------------
+//  KERNELS
+// ============================================================================================
+
+void GPURecGLSL::drawQuad( unsigned int nbInstances ) {
+
+  glBindVertexArray( quadVAO );  GL_TEST_ERROR
+  glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, nbInstances );  GL_TEST_ERROR
+  glBindVertexArray( 0 );
+}
+
+GLuint GPURecGLSL::currentColorAttachment( void ) {
+
+  GLint attachedTex = 0;
+  glGetFramebufferAttachmentParameterivEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME_EXT, &attachedTex );
+  assert( attachedTex > 0 );
+
+  return (GLuint)attachedTex;
+}
+
+// the viewport has to be (dim x dim/4) and the attached texture cleared
+// without PSF all the planes are accumulated with one instanced draw
+// with PSF the horizontally convolved planes are drawn in the layers of planesTex, then
+// accumulated in the projection with the vertical convolution: 2 instanced draws
+void GPURecGLSL::projection( GLuint volumeTex, double angle, bool convolve ) {
+
+  assert( initialized );
+
+  float rotation[2] = { (float)cos(angle), (float)sin(angle) };
+
+  glActiveTexture( GL_TEXTURE0 + INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_3D, volumeTex );  GL_TEST_ERROR
+
+  if( !convolve ) {
+
+    glUseProgram( projectionProgram );
+    glUniform2fv( glGetUniformLocation( projectionProgram, "rotation" ), 1, rotation );
+
+    glEnable( GL_BLEND );
+    glBlendFunc( GL_ONE, GL_ONE );
+    drawQuad( dim );
+    glDisable( GL_BLEND );
+
+    glUseProgram( 0 );
+    return;
+  }
+
+  GLuint projTex = currentColorAttachment();
+
+  // horizontal convolution of every plane
+  glFramebufferTexture( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, planesTex, 0 );  GL_TEST_ERROR
+
+  glActiveTexture( GL_TEXTURE0 + COEFS_UNIT );
+  glBindTexture( GL_TEXTURE_BUFFER, coefsTex );  GL_TEST_ERROR
+
+  glUseProgram( projectionHConvProgram );
+  glUniform2fv( glGetUniformLocation( projectionHConvProgram, "rotation" ), 1, rotation );
+  drawQuad( dim );
+
+  // vertical convolution and accumulation
+  glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, projTex, 0 );  GL_TEST_ERROR
+
+  glActiveTexture( GL_TEXTURE0 + INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_2D_ARRAY, planesTex );  GL_TEST_ERROR
+
+  glUseProgram( projectionVConvProgram );
+  glEnable( GL_BLEND );
+  glBlendFunc( GL_ONE, GL_ONE );
+  drawQuad( dim );
+  glDisable( GL_BLEND );
+
+  glUseProgram( 0 );
+}
+
+// the viewport has to be (dim x dim/4)
+void GPURecGLSL::divide( GLuint measuredTex, unsigned int projNum, GLuint estimatedTex ) {
+
+  assert( initialized );
+
+  glActiveTexture( GL_TEXTURE0 + INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_3D, measuredTex );  GL_TEST_ERROR
+  glActiveTexture( GL_TEXTURE0 + SECOND_INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_2D, estimatedTex );  GL_TEST_ERROR
+
+  glUseProgram( divideProgram );
+  glUniform1i( glGetUniformLocation( divideProgram, "projNum" ), projNum );
+  drawQuad();
+  glUseProgram( 0 );
+
+  glActiveTexture( GL_TEXTURE0 );
+}
+
+// the viewport has to be (dim x dim) and the attached texture cleared
+// the projections firstProjection + i*step, i < nbSubsetProjections, are accumulated
+void GPURecGLSL::backProjectSlice( GLuint projectionsTex, unsigned int nbProjection, const float* angles,
+                                   unsigned int firstProjection, unsigned int step, unsigned int sliceNum, bool convolve ) {
+
+  assert( initialized );
+
+  unsigned int nbSubsetProjections = (nbProjection - firstProjection + step - 1) / step;
+
+  glBindBuffer( GL_TEXTURE_BUFFER, anglesBuffer );  GL_TEST_ERROR
+  if( nbSubsetProjections > maxSubsetSize ) {
+
+    glBufferData( GL_TEXTURE_BUFFER, nbSubsetProjections * sizeof(float), NULL, GL_DYNAMIC_DRAW );  GL_TEST_ERROR
+    glBindTexture( GL_TEXTURE_BUFFER, anglesTex );
+    glTexBuffer( GL_TEXTURE_BUFFER, GL_R32F, anglesBuffer );  GL_TEST_ERROR
+
+    // one layer of convolved lines per projection of the subset
+    if( subsetLinesTex ) glDeleteTextures( 1, &subsetLinesTex );
+    glGenTextures( 1, &subsetLinesTex );  GL_TEST_ERROR
+    glBindTexture( GL_TEXTURE_2D_ARRAY, subsetLinesTex );  GL_TEST_ERROR
+    glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, GL_RGBA16F, dim, dim, nbSubsetProjections, 0, GL_RGBA, GL_FLOAT, NULL );  GL_TEST_ERROR
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+
+    maxSubsetSize = nbSubsetProjections;
+  }
+
+  // angles of the subset, written in the buffer
+  float* subsetAngles = (float*)glMapBufferRange( GL_TEXTURE_BUFFER, 0, nbSubsetProjections * sizeof(float),
+                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );  GL_TEST_ERROR
+  for( unsigned int i = 0; i < nbSubsetProjections; i++ )
+    subsetAngles[i] = angles[ firstProjection + i * step ];
+  glUnmapBuffer( GL_TEXTURE_BUFFER );  GL_TEST_ERROR
+  glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+  glActiveTexture( GL_TEXTURE0 + ANGLES_UNIT );
+  glBindTexture( GL_TEXTURE_BUFFER, anglesTex );  GL_TEST_ERROR
+  glActiveTexture( GL_TEXTURE0 + INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_3D, projectionsTex );  GL_TEST_ERROR
+
+  if( !convolve ) {
+
+    glUseProgram( backProjectProgram );
+    glUniform1i( glGetUniformLocation( backProjectProgram, "firstProjection" ), firstProjection );
+    glUniform1i( glGetUniformLocation( backProjectProgram, "projectionStep" ), step );
+    glUniform1i( glGetUniformLocation( backProjectProgram, "sliceNum" ), sliceNum );
+
+    glEnable( GL_BLEND );
+    glBlendFunc( GL_ONE, GL_ONE );
+    drawQuad( nbSubsetProjections );
+    glDisable( GL_BLEND );
+
+    glUseProgram( 0 );
+    return;
+  }
+
+  GLuint backProjectionTex = currentColorAttachment();
+
+  // vertical convolution of the slice lines with the gaussian of every plane
+  glFramebufferTexture( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, subsetLinesTex, 0 );  GL_TEST_ERROR
+
+  glActiveTexture( GL_TEXTURE0 + COEFS_UNIT );
+  glBindTexture( GL_TEXTURE_BUFFER, coefsTex );  GL_TEST_ERROR
+
+  glUseProgram( backProjectVConvProgram );
+  glUniform1i( glGetUniformLocation( backProjectVConvProgram, "firstProjection" ), firstProjection );
+  glUniform1i( glGetUniformLocation( backProjectVConvProgram, "projectionStep" ), step );
+  glUniform1i( glGetUniformLocation( backProjectVConvProgram, "sliceNum" ), sliceNum );
+  drawQuad( nbSubsetProjections );
+
+  // horizontal convolution and accumulation of the rotated projections
+  glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, backProjectionTex, 0 );  GL_TEST_ERROR
+
+  glActiveTexture( GL_TEXTURE0 + INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_2D_ARRAY, subsetLinesTex );  GL_TEST_ERROR
+
+  glUseProgram( backProjectHConvProgram );
+  glUniform1i( glGetUniformLocation( backProjectHConvProgram, "firstProjection" ), firstProjection );
+  glUniform1i( glGetUniformLocation( backProjectHConvProgram, "projectionStep" ), step );
+  glEnable( GL_BLEND );
+  glBlendFunc( GL_ONE, GL_ONE );
+  drawQuad( nbSubsetProjections );
+  glDisable( GL_BLEND );
+
+  glUseProgram( 0 );
+}
+
+// the viewport has to be (dim x dim)
+void GPURecGLSL::updateSlice( GLuint volumeTex, GLuint backProjectionTex, unsigned int sliceNum, float normalizationFactor ) {
+
+  assert( initialized );
+
+  glActiveTexture( GL_TEXTURE0 + INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_3D, volumeTex );  GL_TEST_ERROR
+  glActiveTexture( GL_TEXTURE0 + SECOND_INPUT_UNIT );
+  glBindTexture( GL_TEXTURE_2D, backProjectionTex );  GL_TEST_ERROR
+
+  glUseProgram( updateSliceProgram );
+  glUniform1i( glGetUniformLocation( updateSliceProgram, "sliceNum" ), sliceNum );
+  glUniform1f( glGetUniformLocation( updateSliceProgram, "normalizationFactor" ), normalizationFactor );
+  drawQuad();
+  glUseProgram( 0 );
+
+  glActiveTexture( GL_TEXTURE0 );
+}
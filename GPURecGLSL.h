@@ -0,0 +1,75 @@
+#ifndef _GPURECGLSL_H
+#define _GPURECGLSL_H
+
+namespace GPURec {
+
+
+// GLSL implementation of the reconstruction kernels (selected with USE_GLSL)
+// shaders only use core profile features: every pass is drawn from a static vertex buffer,
+// the planes of a projection or the projections of a subset are drawn with one instanced call
+// and the PSF coefficients of all planes are read from a texture buffer
+class GPURecGLSL {
+
+public:
+
+      static void initialize( unsigned int _dim );
+      static void terminate( void );
+      static void reset( unsigned int _dim );   // has to be called after GPUGaussianConv::reset (the PSF coefficients are copied from it)
+
+      // all these methods render into the texture attached to the FBO
+      static void projection( GLuint volumeTex, double angle, bool convolve );
+      static void divide( GLuint measuredTex, unsigned int projNum, GLuint estimatedTex );
+      static void backProjectSlice( GLuint projectionsTex, unsigned int nbProjection, const float* angles,
+                                    unsigned int firstProjection, unsigned int step, unsigned int sliceNum, bool convolve );
+      static void updateSlice( GLuint volumeTex, GLuint backProjectionTex, unsigned int sliceNum, float normalizationFactor );
+
+protected:
+
+      static void initBuffers( void );
+      static void initPrograms( void );
+      static void initPSFResources( void );
+      static void terminatePSFResources( void );
+
+      static GLuint compileShader( GLenum type, const char* code );
+      static GLuint linkProgram( const char* vertexCode, const char* geometryCode, const char* fragmentCode );
+
+      static void drawQuad( unsigned int nbInstances = 1 );
+      static GLuint currentColorAttachment( void );
+
+public:
+      static GLuint dim;
+
+      // unit quad drawn by every pass
+      static GLuint quadVAO;
+      static GLuint quadVBO;
+
+      static GLuint projectionProgram;
+      static GLuint projectionHConvProgram;
+      static GLuint projectionVConvProgram;
+      static GLuint divideProgram;
+      static GLuint backProjectProgram;
+      static GLuint backProjectVConvProgram;
+      static GLuint backProjectHConvProgram;
+      static GLuint updateSliceProgram;
+
+      // PSF coefficients: (radius+1) values per plane
+      static GLuint coefsBuffer;
+      static GLuint coefsTex;
+      static unsigned int convolutionRadius;
+
+      // projection angles of the current subset
+      static GLuint anglesBuffer;
+      static GLuint anglesTex;
+      static unsigned int maxSubsetSize;
+
+      // layered intermediate results: planes of a projection, convolved lines of the subset projections
+      static GLuint planesTex;
+      static GLuint subsetLinesTex;
+
+      static bool initialized;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _GPURECGLSL_H
@@ -30,6 +30,12 @@ GLuint GPURecOpenGL::tex1Dim = 0;
 GLuint GPURecOpenGL::tex2Dim = 0; 
 GLuint GPURecOpenGL::unpackTex = 0; 
 
+GLuint GPURecOpenGL::uploadPBO = 0;
+unsigned int GPURecOpenGL::uploadSlotSize = 0;
+unsigned int GPURecOpenGL::currentUploadSlot = 0;
+float* GPURecOpenGL::persistentUploadPtr = 0;
+GLsync GPURecOpenGL::uploadFences[NB_UPLOAD_SLOTS];
+
 
 bool GPURecOpenGL::initialized = false;
 
@@ -56,6 +62,8 @@ void GPURecOpenGL::terminate( void ) {
     unpackTex = 0;
   }
   
+  terminateUploadRing();
+  
   if( textureAlphaProgram ) {
     glDeleteProgramsARB(1, &textureAlphaProgram);
     textureAlphaProgram = 0;
@@ -95,6 +103,7 @@ void GPURecOpenGL::initialize( unsigned int _dim ) {
   dim = _dim;
   initGLEW();              
   initFBO();        
+  initUploadRing();
   initFragmentPrograms();        
   initGLStatesInCurrentContext();
             
@@ -109,6 +118,9 @@ void GPURecOpenGL::reset( unsigned int _dim) {
     return;
   }
 
+  // same size: the FBO, its textures and the upload ring are kept (daemon mode, scans of a file)
+  if( _dim == dim ) return;
+
   // reset FBO settings with the new size
   if( fboId ) {
     glDeleteFramebuffersEXT(1, &fboId);   
@@ -134,9 +146,12 @@ void GPURecOpenGL::reset( unsigned int _dim) {
     glDeleteTextures( 1, &unpackTex );
     unpackTex = 0;
   }
+  
+  terminateUploadRing();
 
   dim = _dim;
   initFBO();  
+  initUploadRing();
 }
 
 void GPURecOpenGL::initGLEW() {
@@ -227,6 +242,100 @@ void GPURecOpenGL::initFBO() {
   glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT );
 }
 
+// the ring is sized for the biggest texture streamed per call: one RGBA projection of dim*dim/4 texels
+// with ARB_buffer_storage the buffer is mapped once for its whole lifetime
+void GPURecOpenGL::initUploadRing() {
+
+  uploadSlotSize = dim * dim;
+  currentUploadSlot = 0;
+  for( unsigned int slot = 0; slot < NB_UPLOAD_SLOTS; slot++ )
+    uploadFences[slot] = 0;
+    
+  GLsizeiptr ringSize = NB_UPLOAD_SLOTS * uploadSlotSize * sizeof(float);
+    
+  glGenBuffers( 1, &uploadPBO );  GL_TEST_ERROR
+  glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, uploadPBO );  GL_TEST_ERROR
+  
+  if( GLEW_ARB_buffer_storage && GLEW_ARB_sync ) {
+  
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage( GL_PIXEL_UNPACK_BUFFER_ARB, ringSize, NULL, flags );  GL_TEST_ERROR
+    persistentUploadPtr = (float*)glMapBufferRange( GL_PIXEL_UNPACK_BUFFER_ARB, 0, ringSize, flags );  GL_TEST_ERROR
+  }
+  else {
+  
+    // fallback: the slot is mapped and unmapped at each upload
+    glBufferData( GL_PIXEL_UNPACK_BUFFER_ARB, ringSize, NULL, GL_STREAM_DRAW );  GL_TEST_ERROR
+    persistentUploadPtr = 0;
+  }
+  
+  glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+}
+
+void GPURecOpenGL::terminateUploadRing() {
+
+  for( unsigned int slot = 0; slot < NB_UPLOAD_SLOTS; slot++ ) {
+    if( uploadFences[slot] ) {
+      glDeleteSync( uploadFences[slot] );
+      uploadFences[slot] = 0;
+    }
+  }
+
+  if( uploadPBO ) {
+  
+    if( persistentUploadPtr ) {
+      glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, uploadPBO );
+      glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER_ARB );
+      glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+      persistentUploadPtr = 0;
+    }
+    
+    glDeleteBuffers( 1, &uploadPBO );
+    uploadPBO = 0;
+  }
+}
+
+float* GPURecOpenGL::acquireUploadSlot( unsigned int nbFloats ) {
+
+  assert( initialized );
+  assert( nbFloats <= uploadSlotSize );
+  
+  GLintptr slotOffset = currentUploadSlot * uploadSlotSize * sizeof(float);
+  
+  glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, uploadPBO );  GL_TEST_ERROR
+  
+  // wait for the DMA that used this slot NB_UPLOAD_SLOTS uploads ago
+  if( uploadFences[currentUploadSlot] ) {
+    glClientWaitSync( uploadFences[currentUploadSlot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED );
+    glDeleteSync( uploadFences[currentUploadSlot] );
+    uploadFences[currentUploadSlot] = 0;
+  }
+  
+  if( persistentUploadPtr )
+    return persistentUploadPtr + currentUploadSlot * uploadSlotSize;
+  
+  return (float*)glMapBufferRange( GL_PIXEL_UNPACK_BUFFER_ARB, slotOffset, nbFloats * sizeof(float), 
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT );
+}
+
+const GLvoid* GPURecOpenGL::commitUploadSlot( void ) {
+
+  if( !persistentUploadPtr ) {
+    glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER_ARB );  GL_TEST_ERROR
+  }
+    
+  return (const GLvoid*)(currentUploadSlot * uploadSlotSize * sizeof(float));
+}
+
+void GPURecOpenGL::releaseUploadSlot( void ) {
+
+  if( GLEW_ARB_sync )
+    uploadFences[currentUploadSlot] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+  
+  glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+  currentUploadSlot = (currentUploadSlot + 1) % NB_UPLOAD_SLOTS;
+}
+
 void GPURecOpenGL::initFragmentPrograms() {
   
   glGenProgramsARB(1, &textureAlphaProgram);
@@ -275,6 +384,7 @@ void GPURecOpenGL::initFragmentPrograms() {
         "MOV result.color, tex0;\n"
         "END\n";  
         
+    // texture[0] is the 3D texture of the measured projections: texcoord[0].z selects the projection
     const char* textureDivPackCode =
         "!!ARBfp1.0\n"
         "TEMP tex0;\n"
@@ -283,7 +393,7 @@ void GPURecOpenGL::initFragmentPrograms() {
         "TEMP tex12;\n"
         "TEMP tex13;\n"
         "TEMP tex14;\n"
-        "TEX tex0, fragment.texcoord[0], texture[0], 2D;\n"
+        "TEX tex0, fragment.texcoord[0], texture[0], 3D;\n"
         "TEX tex1, fragment.texcoord[0], texture[1], 2D;\n"
         "MAX tex1, tex1, 0.1;\n"
         "RCP tex11, tex1.x;\n"
@@ -24,7 +24,13 @@ public:
       static void sideView();
       static void topView();
       
-      static int poisson_sample ( double a );
+      // streamed texture uploads through a ring of pixel-unpack buffer slots
+      // acquireUploadSlot returns a pointer where the caller writes nbFloats values,
+      // commitUploadSlot returns the offset to give as pixels pointer to a glTexSubImage call
+      // and releaseUploadSlot lets the DMA run while the next slot is filled
+      static float* acquireUploadSlot( unsigned int nbFloats );
+      static const GLvoid* commitUploadSlot( void );
+      static void releaseUploadSlot( void );
       
       //static blending( list of textureID );
       
@@ -34,6 +40,8 @@ protected:
       static void initGLStatesInCurrentContext( void );
       static void initGLEW();  
       static void initFBO();
+      static void initUploadRing();
+      static void terminateUploadRing();
       static void initFragmentPrograms( void );
       
 public:
@@ -52,6 +60,12 @@ public:
       static GLuint tex2Dim;
       static GLuint unpackTex;
       
+      static GLuint uploadPBO;
+      static unsigned int uploadSlotSize;     // in floats
+      static unsigned int currentUploadSlot;
+      static float* persistentUploadPtr;      // non null when the PBO is persistently mapped
+      static GLsync uploadFences[NB_UPLOAD_SLOTS];
+      
       static bool initialized;
 };
 
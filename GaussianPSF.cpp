@@ -0,0 +1,88 @@
+
+#include "common.h"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <iostream>
+
+#include "GaussianPSF.h"
+#include "PSFCache.h"
+
+using namespace GPURec;
+
+
+float GaussianPSF::sigmaAtDistance( float dist, const PSFKey& key ) {
+
+  float Rt2 = (dist * key.collimatorHolesDiameter / key.collimatorDepth) * (dist * key.collimatorHolesDiameter / key.collimatorDepth) + pow( key.cameraResolution / key.pixelSize, 2 );
+  return sqrt( Rt2 / ( 8 * M_LN2 ) );
+}
+
+
+void GaussianPSF::compute( const PSFKey& key ) {
+
+  assert( key.dim > 0 );
+  dim = key.dim;
+  float pixelSize = key.pixelSize;
+
+  // compute the convolution radius : use the last plane where sigma is maximum
+  // the computations has to be done in PIXEL unit !
+  float distMax = (key.cameraRotationRadius / pixelSize) + dim/2 + 0.5;
+  radius = (unsigned int)( key.truncationFactor * sigmaAtDistance( distMax, key ) );
+  std::cout <<  "Convolution radius: " << radius << std::endl;
+
+  // compute the gaussian coefficients : There is 1 gaussian by projection plane
+  sigmas.resize( dim );
+  coefs.resize( dim * (radius+1) );
+  for( unsigned int planeNum = 0; planeNum < dim; planeNum++ ) {
+    
+    float dist = (key.cameraRotationRadius / pixelSize) - (dim/2 - 0.5) + planeNum; 
+    float sigma = sigmaAtDistance( dist, key );
+    sigmas[planeNum] = sigma;
+
+    float* planeCoefs = &coefs[ planeNum * (radius+1) ];
+    float sum = 0.0;
+    for( unsigned int iFilter = 0; iFilter <= radius; iFilter++ ) {
+
+      planeCoefs[iFilter] = exp( iFilter*iFilter / ( -2.0 * sigma * sigma ) ) / ( sqrt(2.0*M_PI) * sigma );   
+      sum += planeCoefs[iFilter];
+    }  
+    
+    // we have the sum of a demi-gaussian, this operation deduces the whole gaussian sum
+    sum = 2 * sum - planeCoefs[0];
+
+    // normalize coefficients according to the sum
+    for( unsigned int i = 0; i <= radius; i++ )
+      planeCoefs[i] /= sum;    
+  }
+}
+
+
+void GaussianPSF::write( std::ostream& stream ) const {
+
+  stream.write( (const char*)&dim, sizeof(dim) );
+  stream.write( (const char*)&radius, sizeof(radius) );
+  stream.write( (const char*)&sigmas[0], sigmas.size() * sizeof(float) );
+  stream.write( (const char*)&coefs[0], coefs.size() * sizeof(float) );
+}
+
+
+bool GaussianPSF::read( std::istream& stream ) {
+
+  stream.read( (char*)&dim, sizeof(dim) );
+  stream.read( (char*)&radius, sizeof(radius) );
+  if( !stream || dim == 0 ) {
+    clear();
+    return false;
+  }
+  
+  sigmas.resize( dim );
+  coefs.resize( dim * (radius+1) );
+  stream.read( (char*)&sigmas[0], sigmas.size() * sizeof(float) );
+  stream.read( (char*)&coefs[0], coefs.size() * sizeof(float) );
+  if( !stream ) {
+    clear();
+    return false;
+  }
+  
+  return true;
+}
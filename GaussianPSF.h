@@ -0,0 +1,52 @@
+#ifndef _GAUSSIANPSF_H
+#define _GAUSSIANPSF_H
+
+#include <vector>
+#include <iostream>
+
+namespace GPURec {
+
+struct PSFKey;
+
+
+// Point Spread Function of the collimator: one normalized gaussian per projection plane
+// the gaussian width grows with the distance between the plane and the camera
+// the coefficients are computed in PIXEL unit and shared by all reconstruction backends
+class GaussianPSF {
+
+public:
+
+  GaussianPSF() : dim(0), radius(0) {}
+
+  void compute( const PSFKey& key );     // dimension, pixel size and camera of the key
+  void clear( void ) { dim = 0; radius = 0; sigmas.clear(); coefs.clear(); }
+
+  unsigned int getDim( void ) const { return dim; }
+  unsigned int getRadius( void ) const { return radius; }     // same radius for all planes: the one of the farthest plane
+  float getSigma( unsigned int planeNum ) const { return sigmas[planeNum]; }
+  
+  // (radius+1) coefficients of a plane, from the center to the border
+  const float* getCoefs( unsigned int planeNum ) const { return &coefs[ planeNum * (radius+1) ]; }
+  
+  // returns the value of the gaussian coef or zero if outside the domain definition
+  float getCoef( unsigned int planeNum, unsigned int index ) const { return (index <= radius) ? coefs[ planeNum * (radius+1) + index ] : 0.0f; }
+
+  // sigma of the plane at *dist* pixels from the camera
+  static float sigmaAtDistance( float dist, const PSFKey& key );
+  
+  // binary tables, used by the PSF cache
+  void write( std::ostream& stream ) const;
+  bool read( std::istream& stream );    // false if the stream is truncated
+  
+protected:
+
+  unsigned int dim;
+  unsigned int radius;
+  std::vector<float> sigmas;
+  std::vector<float> coefs;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _GAUSSIANPSF_H
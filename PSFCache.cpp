@@ -0,0 +1,217 @@
+#include "common.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "PSFCache.h"
+#include "ReconstructionContext.h"
+
+using namespace GPURec;
+
+std::string PSFCache::directory = "";
+std::map<PSFKey, GaussianPSF> PSFCache::psfs;
+std::map< std::pair<PSFKey, std::string>, std::string > PSFCache::programs;
+THREADutils::Mutex PSFCache::mutex;
+
+static const char PSF_CACHE_MAGIC[] = "GPURecPSF1";
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  KEYS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+PSFKey::PSFKey( unsigned int _dim, float _pixelSize ) {
+
+  *this = PSFKey( _dim, _pixelSize, ReconstructionContext() );
+}
+
+
+PSFKey::PSFKey( unsigned int _dim, float _pixelSize, const ReconstructionContext& context ) {
+
+  dim = _dim;
+  pixelSize = _pixelSize;
+  cameraRotationRadius = context.cameraRotationRadius;
+  cameraResolution = context.cameraResolution;
+  collimatorHolesDiameter = context.collimatorHolesDiameter;
+  collimatorDepth = context.collimatorDepth;
+  truncationFactor = CONVOLUTION_RADIUS_TRUNCATION_FACTOR;
+}
+
+
+bool PSFKey::operator<( const PSFKey& key ) const {
+
+  if( dim != key.dim ) return dim < key.dim;
+  
+  const float values[6] = { pixelSize, cameraRotationRadius, cameraResolution, collimatorHolesDiameter, collimatorDepth, truncationFactor };
+  const float keyValues[6] = { key.pixelSize, key.cameraRotationRadius, key.cameraResolution, key.collimatorHolesDiameter, key.collimatorDepth, key.truncationFactor };
+  for( unsigned int i = 0; i < 6; i++ )
+    if( values[i] != keyValues[i] ) return values[i] < keyValues[i];
+    
+  return false;
+}
+
+
+// FNV-1a hash of the parameters
+std::string PSFKey::getName( void ) const {
+
+  const float values[6] = { pixelSize, cameraRotationRadius, cameraResolution, collimatorHolesDiameter, collimatorDepth, truncationFactor };
+  
+  unsigned long hash = 2166136261UL;
+  const unsigned char* bytes = (const unsigned char*)&dim;
+  for( unsigned int i = 0; i < sizeof(dim); i++ ) hash = ( (hash ^ bytes[i]) * 16777619UL ) & 0xFFFFFFFFUL;
+  bytes = (const unsigned char*)values;
+  for( unsigned int i = 0; i < sizeof(values); i++ ) hash = ( (hash ^ bytes[i]) * 16777619UL ) & 0xFFFFFFFFUL;
+  
+  std::stringstream name;
+  name << dim << "_" << std::hex << std::setw(8) << std::setfill('0') << hash;
+  return name.str();
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  CACHE
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+std::string PSFCache::getFileName( const PSFKey& key, const std::string& suffix ) {
+
+  return directory + "/psf_" + key.getName() + suffix;
+}
+
+
+std::string PSFCache::getTemporaryName( const std::string& fileName ) {
+
+  std::stringstream name;
+#ifdef _WIN32
+  name << fileName << ".tmp" << _getpid();
+#else
+  name << fileName << ".tmp" << getpid();
+#endif
+  return name.str();
+}
+
+
+void PSFCache::replaceFile( const std::string& temporaryName, const std::string& fileName ) {
+
+#ifdef _WIN32
+  bool renamed = MoveFileExA( temporaryName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+  bool renamed = rename( temporaryName.c_str(), fileName.c_str() ) == 0;
+#endif
+  if( !renamed ) {
+    std::cerr << "PSF cache: can't write " << fileName << std::endl;
+    std::remove( temporaryName.c_str() );
+  }
+}
+
+
+void PSFCache::writeKey( std::ostream& stream, const PSFKey& key ) {
+
+  stream.write( PSF_CACHE_MAGIC, sizeof(PSF_CACHE_MAGIC) );
+  stream.write( (const char*)&key, sizeof(PSFKey) );
+}
+
+
+bool PSFCache::readKey( std::istream& stream, const PSFKey& key ) {
+
+  char magic[ sizeof(PSF_CACHE_MAGIC) ];
+  PSFKey fileKey;
+  stream.read( magic, sizeof(magic) );
+  stream.read( (char*)&fileKey, sizeof(PSFKey) );
+  
+  return stream && std::string( magic ) == PSF_CACHE_MAGIC && fileKey == key;
+}
+
+
+const GaussianPSF& PSFCache::getPSF( const PSFKey& key ) {
+
+  // the references to the tables stay valid when other keys are added
+  THREADutils::Lock lock( mutex );
+  std::map<PSFKey, GaussianPSF>::iterator it = psfs.find( key );
+  if( it != psfs.end() ) return it->second;
+  
+  GaussianPSF& psf = psfs[key];
+  
+  if( !directory.empty() ) {
+  
+    std::ifstream file( getFileName( key, ".bin" ).c_str(), std::ios::in | std::ios::binary );
+    if( file && readKey( file, key ) && psf.read( file ) && psf.getDim() == key.dim ) {
+      std::cout << "PSF tables read from the cache, convolution radius: " << psf.getRadius() << std::endl;
+      return psf;
+    }
+  }
+  
+  psf.compute( key );
+  
+  if( !directory.empty() ) {
+  
+    std::string fileName = getFileName( key, ".bin" );
+    std::string temporaryName = getTemporaryName( fileName );
+    std::ofstream file( temporaryName.c_str(), std::ios::out | std::ios::binary );
+    if( file ) {
+      writeKey( file, key );
+      psf.write( file );
+      file.close();
+      replaceFile( temporaryName, fileName );
+    }
+    else std::cerr << "PSF cache: can't write in " << directory << std::endl;
+  }
+  
+  return psf;
+}
+
+
+bool PSFCache::findProgram( const PSFKey& key, const std::string& name, std::string& code ) {
+
+  THREADutils::Lock lock( mutex );
+  std::pair<PSFKey, std::string> programKey( key, name );
+  std::map< std::pair<PSFKey, std::string>, std::string >::iterator it = programs.find( programKey );
+  if( it != programs.end() ) {
+    code = it->second;
+    return true;
+  }
+  
+  if( directory.empty() ) return false;
+  
+  std::ifstream file( getFileName( key, "_" + name + ".txt" ).c_str(), std::ios::in | std::ios::binary );
+  if( !file || !readKey( file, key ) ) return false;
+  
+  std::stringstream content;
+  content << file.rdbuf();
+  code = content.str();
+  programs[programKey] = code;
+  return !code.empty();
+}
+
+
+void PSFCache::storeProgram( const PSFKey& key, const std::string& name, const std::string& code ) {
+
+  THREADutils::Lock lock( mutex );
+  programs[ std::make_pair( key, name ) ] = code;
+  
+  if( directory.empty() ) return;
+  
+  std::string fileName = getFileName( key, "_" + name + ".txt" );
+  std::string temporaryName = getTemporaryName( fileName );
+  std::ofstream file( temporaryName.c_str(), std::ios::out | std::ios::binary );
+  if( file ) {
+    writeKey( file, key );
+    file << code;
+    file.close();
+    replaceFile( temporaryName, fileName );
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef _PSFCACHE_H
+#define _PSFCACHE_H
+
+#include <map>
+#include <string>
+
+#include "GaussianPSF.h"
+#include "THREADutils.h"
+
+namespace GPURec {
+
+struct ReconstructionContext;
+
+
+// parameters the PSF tables and the generated convolution kernels depend on
+struct PSFKey {
+
+  PSFKey( unsigned int _dim = 0, float _pixelSize = 0.0f );   // with the camera of the current configuration
+  PSFKey( unsigned int _dim, float _pixelSize, const ReconstructionContext& context );
+  
+  bool operator<( const PSFKey& key ) const;
+  bool operator==( const PSFKey& key ) const { return !( *this < key ) && !( key < *this ); }
+  
+  std::string getName( void ) const;    // hash of the parameters, used in the file names
+  
+  unsigned int dim;
+  float pixelSize;
+  float cameraRotationRadius;
+  float cameraResolution;
+  float collimatorHolesDiameter;
+  float collimatorDepth;
+  float truncationFactor;
+};
+
+
+// PSF tables and generated kernels kept across the scans of a run, and on the disk across runs
+// when a cache directory is given. Disk entries are checked against their key before use.
+// The tables are shared by the reconstructions running on several threads.
+class PSFCache {
+
+public:
+
+  static void setDirectory( const std::string& _directory ) { directory = _directory; }   // empty: memory only
+  static void clear( void ) { psfs.clear(); programs.clear(); }
+  
+  // PSF of the parameters of the key: computed once per key
+  static const GaussianPSF& getPSF( const PSFKey& key );
+  
+  // code of a generated kernel (e.g. a fragment program) of the given name
+  static bool findProgram( const PSFKey& key, const std::string& name, std::string& code );
+  static void storeProgram( const PSFKey& key, const std::string& name, const std::string& code );
+  
+protected:
+
+  static std::string getFileName( const PSFKey& key, const std::string& suffix );
+  static bool readKey( std::istream& stream, const PSFKey& key );
+  static void writeKey( std::ostream& stream, const PSFKey& key );
+  
+  // the entries are written to a temporary file of the process, then renamed: concurrent processes
+  // with the same key never read a partial file
+  static std::string getTemporaryName( const std::string& fileName );
+  static void replaceFile( const std::string& temporaryName, const std::string& fileName );
+  
+  static std::string directory;
+  static std::map<PSFKey, GaussianPSF> psfs;
+  static std::map< std::pair<PSFKey, std::string>, std::string > programs;
+  static THREADutils::Mutex mutex;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _PSFCACHE_H
@@ -125,7 +125,7 @@ void Phantom::saveProjections( VolumeProjectionSet& projSet, unsigned int nbProj
   for( unsigned int p = 0; p < nbProjections; p++ ) {
     
     // render to texture
-    glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, projSet.getTexId(p), 0 ); GL_TEST_ERROR
+    projSet.attachProjectionToFBO( p );
 
     projection( angle, false ); 
      
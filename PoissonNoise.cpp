@@ -0,0 +1,50 @@
+
+#include "common.h"
+
+#include "PoissonNoise.h"
+#include "VolumeProjectionSet.h"
+#include "RANDOMutils.h"
+#include "THREADutils.h"
+
+using namespace GPURec;
+
+
+void PoissonNoise::applyLine( float* line, unsigned int dim, unsigned int z, unsigned int projNum, unsigned int seed ) {
+
+  // second key word: stream of the simulated scans
+  const unsigned int key[2] = { seed, 0x5343414E };
+  
+  for( unsigned int u = 0; u < dim; u++ ) {
+  
+    unsigned int counter[4] = { u + z*dim, projNum, 0, 0 };
+    unsigned int words[4];
+    RANDOMutils::philox( counter, key, words );
+    line[u] = (float)RANDOMutils::poisson( line[u], words[0], words[1] );
+  }
+}
+
+
+void PoissonNoise::applyLines( unsigned int begin, unsigned int end, void* context ) {
+
+  NoiseContext* ctx = (NoiseContext*)context;
+  unsigned int dim = ctx->projSet->getDim();
+  
+  for( unsigned int index = begin; index < end; index++ ) {
+  
+    unsigned int p = index / dim;
+    unsigned int z = index % dim;
+    applyLine( ctx->projSet->getData(p) + z*dim, dim, z, p, ctx->seed );
+  }
+}
+
+
+void PoissonNoise::apply( VolumeProjectionSet& projSet, unsigned int seed, unsigned int nbThreads ) {
+
+  assert( projSet.hasData() );
+  
+  NoiseContext ctx;
+  ctx.projSet = &projSet;
+  ctx.seed = seed;
+  THREADutils::parallelFor( 0, projSet.getNbProjection() * projSet.getDim(), applyLines, &ctx, nbThreads );
+}
+
@@ -0,0 +1,36 @@
+#ifndef _POISSONNOISE_H
+#define _POISSONNOISE_H
+
+namespace GPURec {
+
+class VolumeProjectionSet;
+
+
+// Poisson noise of simulated scans: every noisy count is drawn from the counter-based generator
+// keyed by the seed, with the projection and the pixel as counter. A count never depends on the
+// others, so the result is the same for any number of threads and any order of the projections.
+class PoissonNoise {
+
+public:
+
+  // replace each value of the projections in main memory by a Poisson sample of that mean
+  static void apply( VolumeProjectionSet& projSet, unsigned int seed, unsigned int nbThreads = 0 );
+
+  // the same for the line z (dim values) of the projection projNum
+  static void applyLine( float* line, unsigned int dim, unsigned int z, unsigned int projNum, unsigned int seed );
+
+protected:
+
+  struct NoiseContext {
+    VolumeProjectionSet* projSet;
+    unsigned int seed;
+  };
+
+  // parallel loop body over the (projection, line) pairs
+  static void applyLines( unsigned int begin, unsigned int end, void* context );
+};
+
+
+} // end namespace GPURec
+
+#endif  // _POISSONNOISE_H
@@ -0,0 +1,64 @@
+
+#include "common.h"
+
+#include <iostream>
+
+#include "ReconstructionBackend.h"
+#include "GLBackend.h"
+#include "CPUBackend.h"
+#include "DistributedBackend.h"
+#include "VolumeProjectionSet.h"
+#include "MEMutils.h"
+
+using namespace GPURec;
+
+
+ReconstructionBackend* ReconstructionBackend::create( const ReconstructionContext& context ) {
+
+  // the staging buffers are shared by the volumes and projection sets of the process
+  MEMutils::setHugePages( context.stagingHugePages );
+
+  if( context.distributedMode != NO_DISTRIBUTION ) {
+  
+    if( context.backend != CPU_BACKEND ) {
+      std::cerr << "Distributed reconstruction requires the CPU backend" << std::endl;
+      throw std::exception();
+    }
+    return new DistributedBackend( context, Communicator::create( context.distributedMode, context.workerRank, context.nbWorkers, context.distributedAddress ) );
+  }
+
+  switch( context.backend ) {
+  
+    case CPU_BACKEND:  return new CPUBackend( context );
+    case GL_BACKEND:   return new GLBackend( context );
+  }
+  
+  std::cerr << "Unknown reconstruction backend" << std::endl;
+  throw std::exception();
+}
+
+
+void ReconstructionBackend::setContext( const ReconstructionContext& _context ) {
+
+  ReconstructionContext previous = context;
+  context = _context;
+  
+  context.backend = previous.backend;
+  context.nbThreads = previous.nbThreads;
+  context.pinThreads = previous.pinThreads;
+  context.distributedMode = previous.distributedMode;
+  context.nbWorkers = previous.nbWorkers;
+  context.workerRank = previous.workerRank;
+  context.distributedAddress = previous.distributedAddress;
+}
+
+
+void ReconstructionBackend::projectSubset( const Volume& volume, const VolumeProjectionSet& scan, VolumeProjectionSet& ratios,
+                                           unsigned int firstProjection, unsigned int step, bool convolve ) {
+
+  for( unsigned int p = firstProjection; p < scan.getNbProjection(); p += step ) {
+  
+    project( volume, scan.getAngle( p ), convolve );
+    ratio( scan, ratios, p );
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef _RECONSTRUCTIONBACKEND_H
+#define _RECONSTRUCTIONBACKEND_H
+
+#include <vector>
+
+#include "ReconstructionContext.h"
+#include "THREADutils.h"
+
+namespace GPURec {
+
+class Volume;
+class VolumeProjectionSet;
+
+
+// Operations of the OSEM algorithm on a given hardware
+// the algorithm (VolumeProjectionSet::osemIteration) only calls these methods,
+// the volume and the projection sets are the containers of the data, each backend
+// keeps them where it needs them (graphic memory for GL, main memory for CPU)
+// the parameters of the reconstruction are the ones of the context of the backend
+class ReconstructionBackend {
+
+public:
+
+  ReconstructionBackend( const ReconstructionContext& _context ) : context( _context ), workers( 0 ) {}
+  virtual ~ReconstructionBackend() { delete workers; }
+  
+  // create the backend selected by the context (backend, threads, distribution)
+  static ReconstructionBackend* create( const ReconstructionContext& context );
+  
+  virtual const char* getName( void ) const = 0;
+  
+  // parameters of the next reconstructions, taken into account by the next reset()
+  // the backend type, the threads and the distribution of the context given at the creation are kept
+  void setContext( const ReconstructionContext& _context );
+  const ReconstructionContext& getContext( void ) const { return context; }
+
+  // threads of the parallel loops of the backend (pinned with context.pinThreads), 0 if it has no CPU loops
+  // the buffers written first by these threads (volume, projection sets) stay with the slices they process
+  THREADutils::WorkerPool* getWorkers( void ) const { return workers; }
+  
+  virtual void reset( unsigned int dim, float pixelSize ) = 0;   // allocate the working buffers and compute the PSF
+  virtual void terminate( void ) = 0;
+  
+  
+  // TRANSFERS
+  // ------------------------------------------
+  // make the volume/projections usable by the kernels, or the main memory data up to date
+  virtual void uploadVolume( Volume& volume ) = 0;
+  virtual void downloadVolume( Volume& volume ) = 0;
+  virtual void uploadProjections( VolumeProjectionSet& projSet ) = 0;
+  virtual void downloadProjections( VolumeProjectionSet& projSet ) = 0;
+  
+  
+  // KERNELS
+  // ------------------------------------------
+  // estimated projection of the volume, kept by the backend for the next ratio()
+  virtual void project( const Volume& volume, float angle, bool convolve ) = 0;
+  
+  // ratios[projNum] = scan[projNum] / estimated projection
+  virtual void ratio( const VolumeProjectionSet& scan, VolumeProjectionSet& ratios, unsigned int projNum ) = 0;
+  
+  // ratios of the whole subset firstProjection + i*step
+  // calls project() and ratio() for each projection unless the backend needs the whole subset (FDR PSF)
+  virtual void projectSubset( const Volume& volume, const VolumeProjectionSet& scan, VolumeProjectionSet& ratios,
+                              unsigned int firstProjection, unsigned int step, bool convolve );
+  
+  // backprojection of the ratios firstProjection + i*step, kept by the backend for the next update()
+  virtual void backProject( const VolumeProjectionSet& ratios, unsigned int firstProjection, unsigned int step, bool convolve ) = 0;
+  
+  // volume = volume * backprojection * normalizationFactor
+  virtual void update( Volume& volume, float normalizationFactor ) = 0;
+  
+protected:
+
+  ReconstructionContext context;
+  THREADutils::WorkerPool* workers;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _RECONSTRUCTIONBACKEND_H
@@ -0,0 +1,55 @@
+#ifndef _RECONSTRUCTIONCONTEXT_H
+#define _RECONSTRUCTIONCONTEXT_H
+
+#include <string>
+
+#include "common.h"
+
+namespace GPURec {
+
+
+// Parameters of one reconstruction. The default constructor takes the current configuration
+// (config file and command line), the fields can then be changed for this reconstruction only.
+// Each backend keeps its own copy: the reconstructions of several CPU backends with different
+// parameters can run at the same time on different threads.
+// The GL objects belong to the GL context of the process, the GL backend stays single threaded
+// and USE_GLSL remains a process setting.
+struct ReconstructionContext {
+
+  ReconstructionContext();
+
+  // camera
+  float cameraRotationRadius;
+  float cameraResolution;
+  float collimatorHolesDiameter;
+  float collimatorDepth;
+
+  // algorithm
+  bool useOSEM3D;
+  unsigned int nbSubsets;
+  unsigned int nbIterations;
+  bool warmStart;
+  unsigned int warmStartIterations;
+  bool warmStartScaling;
+  bool keepRawCounts;                   // the scans of the CPU backend read without display keep their uint16 counts
+  bool stagingHugePages;                // staging buffers of 2 MB or more in huge pages
+
+  // backend: the type, the threads and the distribution are fixed when the backend is created
+  BackendType backend;
+  unsigned int nbThreads;
+  bool pinThreads;                      // the kernels always run the same slices on the same cores
+  PSFModel psfModel;
+  unsigned int samplingTablesMemory;    // in MB
+  unsigned int slabSlices;              // out-of-core volume, 0 in main memory
+  std::string attenuationMap;           // mu map file, empty without attenuation
+  unsigned int attenuationTablesMemory; // in MB
+  DistributedMode distributedMode;
+  unsigned int nbWorkers;
+  unsigned int workerRank;
+  std::string distributedAddress;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _RECONSTRUCTIONCONTEXT_H
@@ -0,0 +1,133 @@
+#include "common.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "ReconstructionDaemon.h"
+#include "DBGutils.h"
+
+using namespace GPURec;
+
+
+ReconstructionDaemon::ReconstructionDaemon( const std::string& _socketPath ) : socketPath( _socketPath ), listener(-1), nbJobs(0) {
+
+#ifdef _WIN32
+  std::cerr << "The daemon mode is only available on POSIX systems" << std::endl;
+  throw std::exception();
+#else
+  struct sockaddr_un address;
+  memset( &address, 0, sizeof(address) );
+  address.sun_family = AF_UNIX;
+  if( socketPath.size() >= sizeof(address.sun_path) ) {
+    std::cerr << "Daemon: socket path too long " << socketPath << std::endl;
+    throw std::exception();
+  }
+  strcpy( address.sun_path, socketPath.c_str() );
+  
+  // a socket left by a previous daemon is replaced
+  unlink( socketPath.c_str() );
+  listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+  if( listener < 0 || bind( listener, (struct sockaddr*)&address, sizeof(address) ) != 0 || listen( listener, 16 ) != 0 ) {
+    std::cerr << "Daemon: can't listen on " << socketPath << std::endl;
+    throw std::exception();
+  }
+  
+  std::cout << "Daemon: waiting for jobs on " << socketPath << std::endl;
+#endif
+}
+
+
+ReconstructionDaemon::~ReconstructionDaemon() {
+
+#ifndef _WIN32
+  if( listener >= 0 ) {
+    close( listener );
+    unlink( socketPath.c_str() );
+  }
+#endif
+}
+
+
+#ifndef _WIN32
+
+std::string ReconstructionDaemon::readLine( int connection ) {
+
+  std::string line;
+  char c;
+  while( recv( connection, &c, 1, 0 ) == 1 && c != '\n' )
+    if( c != '\r' ) line += c;
+  return line;
+}
+
+
+void ReconstructionDaemon::writeLine( int connection, const std::string& line ) {
+
+  std::string message = line + "\n";
+  size_t written = 0;
+  while( written < message.size() ) {
+  
+    ssize_t sent = send( connection, message.c_str() + written, message.size() - written, 0 );
+    if( sent <= 0 ) return;   // the client left, the job is done anyway
+    written += sent;
+  }
+}
+
+
+void ReconstructionDaemon::run( JobFunction job ) {
+
+  for( ;; ) {
+  
+    int connection = accept( listener, 0, 0 );
+    if( connection < 0 ) continue;
+    
+    std::string request = readLine( connection );
+    if( request == "QUIT" ) {
+      writeLine( connection, "OK 0" );
+      close( connection );
+      break;
+    }
+    
+    std::vector<std::string> arguments;
+    std::stringstream words( request );
+    std::string word;
+    while( words >> word ) arguments.push_back( word );
+    
+    // the latency covers the whole job: loading, reconstruction and saving
+    DBGutils::Timer timer;
+    bool success = true;
+    timer.start();
+    try {
+      if( arguments.empty() ) {
+        std::cerr << "Daemon: empty request" << std::endl;
+        throw std::exception();
+      }
+      job( arguments );
+    }
+    catch( std::exception& ) {
+      success = false;
+    }
+    timer.stop();
+    
+    nbJobs++;
+    std::stringstream reply;
+    reply << ( success ? "OK " : "ERROR " ) << timer.sum * 1000.0;
+    std::cout << "Daemon: job " << nbJobs << " " << request << ": " << reply.str() << " ms" << std::endl;
+    
+    writeLine( connection, reply.str() );
+    close( connection );
+  }
+}
+
+#else
+
+void ReconstructionDaemon::run( JobFunction job ) {
+}
+
+#endif  // _WIN32
@@ -0,0 +1,40 @@
+#ifndef _RECONSTRUCTIONDAEMON_H
+#define _RECONSTRUCTIONDAEMON_H
+
+#include <string>
+#include <vector>
+
+namespace GPURec {
+
+
+// Unix domain socket server of the daemon mode: the GL context, the programs, the PSF tables
+// and the backend buffers stay initialized between the jobs.
+// One job per connection, the request is one line:    hdrFile [outputFile] [PARAMETER=value ...]
+// the reply is one line:                                OK <latency ms>   or   ERROR <latency ms>
+// the request QUIT stops the daemon
+class ReconstructionDaemon {
+
+public:
+
+  // run a job, throws std::exception on failure
+  typedef void (*JobFunction)( const std::vector<std::string>& arguments );
+
+  ReconstructionDaemon( const std::string& _socketPath );
+  ~ReconstructionDaemon();
+  
+  void run( JobFunction job );
+  
+protected:
+
+  static std::string readLine( int connection );
+  static void writeLine( int connection, const std::string& line );
+  
+  std::string socketPath;
+  int listener;
+  unsigned int nbJobs;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _RECONSTRUCTIONDAEMON_H
@@ -0,0 +1,144 @@
+#include "common.h"
+
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "ReconstructionScheduler.h"
+
+using namespace GPURec;
+
+
+ReconstructionScheduler::ReconstructionScheduler( size_t _memoryBudget, unsigned int _maxJobs ) : memoryBudget( _memoryBudget ), maxJobs( _maxJobs ) {
+
+#ifdef _WIN32
+  std::cerr << "The batch mode is only available on POSIX systems" << std::endl;
+  throw std::exception();
+#endif
+
+  if( maxJobs == 0 ) maxJobs = 1;
+}
+
+
+void ReconstructionScheduler::addJob( const std::vector<std::string>& arguments, size_t footprint ) {
+
+  Job job;
+  job.arguments = arguments;
+  job.footprint = footprint;
+  job.pid = -1;
+  pendingJobs.push_back( job );
+}
+
+
+std::string ReconstructionScheduler::getDescription( const Job& job ) {
+
+  std::stringstream description;
+  for( unsigned int i = 0; i < job.arguments.size(); i++ )
+    description << ( i ? " " : "" ) << job.arguments[i];
+  description << " (" << job.footprint / (1024 * 1024) << " MB)";
+  return description.str();
+}
+
+
+#ifndef _WIN32
+
+unsigned int ReconstructionScheduler::run( JobFunction job ) {
+
+  std::vector<Job> runningJobs;
+  size_t usedMemory = 0;
+  unsigned int nbFailed = 0;
+
+  while( !pendingJobs.empty() || !runningJobs.empty() ) {
+
+    // ADMISSION: in order, while the next job fits the remaining budget
+    while( !pendingJobs.empty() && runningJobs.size() < maxJobs ) {
+
+      Job& next = pendingJobs.front();
+      if( next.footprint > memoryBudget ) {
+
+        std::cerr << "Scheduler: " << getDescription( next ) << " exceeds the memory budget of "
+                  << memoryBudget / (1024 * 1024) << " MB" << std::endl;
+        nbFailed++;
+        pendingJobs.pop_front();
+        continue;
+      }
+      if( usedMemory + next.footprint > memoryBudget ) break;
+
+      // the buffered output isn't written twice by the child
+      std::cout.flush();
+      std::cerr.flush();
+
+      next.timer.start();
+      int pid = fork();
+      if( pid < 0 ) {
+        std::cerr << "Scheduler: can't start a process for " << getDescription( next ) << std::endl;
+        throw std::exception();
+      }
+
+      if( pid == 0 ) {
+
+        // CHILD PROCESS: the job and nothing else
+        int status = 0;
+        try {
+          job( next.arguments );
+        }
+        catch( std::exception& ) {
+          status = 1;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        _exit( status );
+      }
+
+      next.pid = pid;
+      usedMemory += next.footprint;
+      std::cout << "Scheduler: started " << getDescription( next ) << ", "
+                << usedMemory / (1024 * 1024) << " MB in use" << std::endl;
+      runningJobs.push_back( next );
+      pendingJobs.pop_front();
+    }
+
+    if( runningJobs.empty() ) continue;
+
+    // COMPLETION: the memory of the first job to end is given back
+    int status = 0;
+    int pid = waitpid( -1, &status, 0 );
+    if( pid < 0 ) {
+      std::cerr << "Scheduler: lost track of the running jobs" << std::endl;
+      throw std::exception();
+    }
+
+    for( unsigned int j = 0; j < runningJobs.size(); j++ ) {
+
+      if( runningJobs[j].pid != pid ) continue;
+
+      Job& done = runningJobs[j];
+      done.timer.stop();
+      bool success = WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+      if( !success ) nbFailed++;
+
+      std::cout << "Scheduler: " << ( success ? "finished " : "FAILED " ) << getDescription( done )
+                << " in " << done.timer.sum << " s" << std::endl;
+
+      usedMemory -= done.footprint;
+      runningJobs.erase( runningJobs.begin() + j );
+      break;
+    }
+  }
+
+  return nbFailed;
+}
+
+#else
+
+unsigned int ReconstructionScheduler::run( JobFunction job ) {
+
+  return (unsigned int)pendingJobs.size();
+}
+
+#endif  // _WIN32
@@ -0,0 +1,53 @@
+#ifndef _RECONSTRUCTIONSCHEDULER_H
+#define _RECONSTRUCTIONSCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+#include "DBGutils.h"
+
+namespace GPURec {
+
+
+// Runs independent reconstruction jobs concurrently, each one in its own process (CPU backend,
+// no GL context). A job is started only while the sum of the memory footprints of the running
+// jobs fits the budget: the jobs are admitted in the order they were added, so a large job is
+// never overtaken forever by smaller ones.
+// A job whose footprint exceeds the whole budget fails without running.
+class ReconstructionScheduler {
+
+public:
+
+  // run a job in the child process, throws std::exception on failure
+  typedef void (*JobFunction)( const std::vector<std::string>& arguments );
+
+  ReconstructionScheduler( size_t _memoryBudget, unsigned int _maxJobs );
+
+  // footprint in bytes of all the allocations of the job
+  void addJob( const std::vector<std::string>& arguments, size_t footprint );
+
+  // returns when all the jobs are done, the number of failed jobs
+  unsigned int run( JobFunction job );
+
+protected:
+
+  struct Job {
+    std::vector<std::string> arguments;
+    size_t footprint;
+    int pid;
+    DBGutils::Timer timer;      // from the start of the process to its end
+  };
+
+  static std::string getDescription( const Job& job );
+
+  size_t memoryBudget;
+  unsigned int maxJobs;
+  std::deque<Job> pendingJobs;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _RECONSTRUCTIONSCHEDULER_H
@@ -0,0 +1,111 @@
+
+#include "common.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "RecursiveGaussian.h"
+#include "GaussianPSF.h"
+
+using namespace GPURec;
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  INITIALIZATION
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+// coefficients of Young and van Vliet, "Recursive implementation of the Gaussian filter" (1995)
+void RecursiveGaussian::compute( const GaussianPSF& psf, float minSigma ) {
+
+  dim = psf.getDim();
+  coefs.resize( dim );
+  used.resize( dim );
+  
+  for( unsigned int planeNum = 0; planeNum < dim; planeNum++ ) {
+  
+    float sigma = psf.getSigma( planeNum );
+    
+    // the approximation is only valid for sigma >= 0.5
+    used[planeNum] = ( sigma >= minSigma && sigma >= 0.5f );
+    if( !used[planeNum] ) continue;
+    
+    double q = ( sigma >= 2.5f ) ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt( 1.0 - 0.26891 * sigma );
+    double b0 = 1.57825 + 2.44413*q + 1.4281*q*q + 0.422205*q*q*q;
+    double b1 = 2.44413*q + 2.85619*q*q + 1.26661*q*q*q;
+    double b2 = -( 1.4281*q*q + 1.26661*q*q*q );
+    double b3 = 0.422205*q*q*q;
+    
+    Coefs& c = coefs[planeNum];
+    c.b1 = (float)( b1 / b0 );
+    c.b2 = (float)( b2 / b0 );
+    c.b3 = (float)( b3 / b0 );
+    c.B = 1.0f - ( c.b1 + c.b2 + c.b3 );
+  }
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  FILTERING
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+// the filter has a unit gain: a constant edge value is its own steady state
+void RecursiveGaussian::convolveLine( float* line, unsigned int planeNum ) const {
+
+  const Coefs& c = coefs[planeNum];
+  
+  float w1 = line[0], w2 = line[0], w3 = line[0];
+  for( unsigned int u = 0; u < dim; u++ ) {
+  
+    float w = c.B * line[u] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+    w3 = w2; w2 = w1; w1 = w;
+    line[u] = w;
+  }
+  
+  float y1 = line[dim-1], y2 = line[dim-1], y3 = line[dim-1];
+  for( int u = dim-1; u >= 0; u-- ) {
+  
+    float y = c.B * line[u] + c.b1 * y1 + c.b2 * y2 + c.b3 * y3;
+    y3 = y2; y2 = y1; y1 = y;
+    line[u] = y;
+  }
+}
+
+
+void RecursiveGaussian::convolvePlane( float* image, unsigned int nbLines, unsigned int planeNum, float* edge ) const {
+
+  const Coefs& c = coefs[planeNum];
+  
+  for( unsigned int z = 0; z < nbLines; z++ )
+    convolveLine( image + z*dim, planeNum );
+    
+  // vertical pass: the previous lines are the filtered ones, the edge line replaces the missing ones
+  std::copy( image, image + dim, edge );
+  for( unsigned int z = 0; z < nbLines; z++ ) {
+  
+    float* line = image + z*dim;
+    const float* w1 = ( z >= 1 ) ? line - dim : edge;
+    const float* w2 = ( z >= 2 ) ? line - 2*dim : edge;
+    const float* w3 = ( z >= 3 ) ? line - 3*dim : edge;
+    
+    for( unsigned int u = 0; u < dim; u++ )
+      line[u] = c.B * line[u] + c.b1 * w1[u] + c.b2 * w2[u] + c.b3 * w3[u];
+  }
+  
+  std::copy( image + (nbLines-1)*dim, image + nbLines*dim, edge );
+  for( int z = nbLines-1; z >= 0; z-- ) {
+  
+    float* line = image + z*dim;
+    const float* y1 = ( z <= (int)nbLines-2 ) ? line + dim : edge;
+    const float* y2 = ( z <= (int)nbLines-3 ) ? line + 2*dim : edge;
+    const float* y3 = ( z <= (int)nbLines-4 ) ? line + 3*dim : edge;
+    
+    for( unsigned int u = 0; u < dim; u++ )
+      line[u] = c.B * line[u] + c.b1 * y1[u] + c.b2 * y2[u] + c.b3 * y3[u];
+  }
+}
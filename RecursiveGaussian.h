@@ -0,0 +1,49 @@
+#ifndef _RECURSIVEGAUSSIAN_H
+#define _RECURSIVEGAUSSIAN_H
+
+#include <vector>
+
+namespace GPURec {
+
+class GaussianPSF;
+
+
+// Young - van Vliet recursive gaussian: a causal then an anticausal 3rd order IIR filter per line,
+// the cost per pixel does not depend on sigma. The coefficients are built from the sigma of each plane.
+// The filter is an approximation of the gaussian which gets poor for small sigmas: it is only used
+// for the planes far from the camera, with a sigma above minSigma.
+class RecursiveGaussian {
+
+public:
+
+  RecursiveGaussian() : dim(0) {}
+  
+  void compute( const GaussianPSF& psf, float minSigma );
+  void clear( void ) { dim = 0; coefs.clear(); used.clear(); }
+  
+  bool isUsed( unsigned int planeNum ) const { return used[planeNum] != 0; }
+  
+  // in place filtering of dim contiguous samples, the line is clamped to the edge
+  void convolveLine( float* line, unsigned int planeNum ) const;
+  
+  // separable filtering of a (dim x nbLines) image, line major: horizontal (u) then vertical (z)
+  // the vertical pass runs along the lines, all the columns of a line are filtered together
+  // edge: dim values, the copy of the edge line
+  void convolvePlane( float* image, unsigned int nbLines, unsigned int planeNum, float* edge ) const;
+  
+protected:
+
+  struct Coefs {
+    float B;                        // gain of the current sample
+    float b1, b2, b3;               // feedback coefficients, divided by b0
+  };
+
+  unsigned int dim;
+  std::vector<Coefs> coefs;         // one set per plane
+  std::vector<char> used;           // plane filtered recursively
+};
+
+
+} // end namespace GPURec
+
+#endif  // _RECURSIVEGAUSSIAN_H
@@ -0,0 +1,110 @@
+#include "common.h"
+
+#include <algorithm>
+
+#include "SamplingTables.h"
+
+using namespace GPURec;
+
+
+void SamplingTables::reset( unsigned int _dim, size_t _budget ) {
+
+  clear();
+  dim = _dim;
+  budget = _budget;
+}
+
+
+void SamplingTables::clear( void ) {
+
+  tables.clear();
+  memory = 0;
+}
+
+
+const SamplingTables::Table* SamplingTables::find( float angle, MapKind kind ) const {
+
+  std::map< std::pair<float, int>, Table >::const_iterator it = tables.find( std::make_pair( angle, (int)kind ) );
+  return ( it == tables.end() ) ? 0 : &it->second;
+}
+
+
+bool SamplingTables::encode( const int* map, Table& table ) const {
+
+  table.bases.assign( dim, -1 );
+  table.steps.resize( dim * dim );
+
+  for( unsigned int l = 0; l < dim; l++ ) {
+
+    const int* line = map + l*dim;
+    short* steps = &table.steps[ l*dim ];
+    int previous = -1;
+    for( unsigned int i = 0; i < dim; i++ ) {
+
+      if( line[i] < 0 ) {
+        steps[i] = OUTSIDE_STEP;
+        continue;
+      }
+
+      if( previous < 0 ) previous = table.bases[l] = line[i];
+      int step = line[i] - previous;
+      if( step <= OUTSIDE_STEP || step > 32767 ) return false;
+      steps[i] = (short)step;
+      previous = line[i];
+    }
+  }
+
+  return true;
+}
+
+
+const SamplingTables::Table* SamplingTables::store( float angle, MapKind kind, const int* map ) {
+
+  // the compact encoding is the smallest one: nothing is encoded once the budget is reached
+  if( memory + dim * ( sizeof(int) + dim * sizeof(short) ) > budget ) return 0;
+
+  Table table;
+  bool compact = encode( map, table );
+  size_t tableSize = compact ? dim * ( sizeof(int) + dim * sizeof(short) ) : dim * dim * sizeof(int);
+  if( memory + tableSize > budget ) return 0;
+
+  Table& stored = tables[ std::make_pair( angle, (int)kind ) ];
+  if( compact ) {
+    stored.bases.swap( table.bases );
+    stored.steps.swap( table.steps );
+  }
+  else stored.indices.assign( map, map + dim * dim );
+
+  memory += tableSize;
+  return &stored;
+}
+
+
+const int* SamplingTables::getLine( const Table& table, unsigned int l, int* buffer ) const {
+
+  if( !table.indices.empty() ) return &table.indices[ l*dim ];
+
+  const short* steps = &table.steps[ l*dim ];
+  int index = table.bases[l];
+  for( unsigned int i = 0; i < dim; i++ ) {
+
+    if( steps[i] == OUTSIDE_STEP ) {
+      buffer[i] = -1;
+      continue;
+    }
+    index += steps[i];
+    buffer[i] = index;
+  }
+
+  return buffer;
+}
+
+
+void SamplingTables::decode( const Table& table, int* map ) const {
+
+  for( unsigned int l = 0; l < dim; l++ ) {
+
+    const int* line = getLine( table, l, map + l*dim );
+    if( line != map + l*dim ) std::copy( line, line + dim, map + l*dim );
+  }
+}
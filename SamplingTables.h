@@ -0,0 +1,66 @@
+#ifndef _SAMPLINGTABLES_H
+#define _SAMPLINGTABLES_H
+
+#include <map>
+#include <vector>
+#include <cstddef>
+
+namespace GPURec {
+
+
+// Sampling maps of the CPU backend (dim x dim voxel or projection indices, -1 outside), one per
+// angle and kind, computed once and reused in all the iterations.
+// Along a line of a map the indices are the ones of neighbour voxels or points: a line is stored as
+// its first index and the 16 bits differences between consecutive indices, the tables whose steps
+// don't fit (jumps after a gap outside the volume) keep 32 bits indices.
+// The kernels read the stored tables line by line, nothing is copied.
+// The tables stop growing at the memory budget: the maps of the other angles are computed on the fly.
+class SamplingTables {
+
+public:
+
+  enum MapKind { PROJECTION_MAP, BACKPROJECTION_MAP };
+
+  struct Table {
+    std::vector<int> bases;           // first index inside the volume of each line, -1 if the line is outside
+    std::vector<short> steps;         // index - previous index inside the line, OUTSIDE_STEP outside
+    std::vector<int> indices;         // 32 bits tables
+  };
+
+  static const short OUTSIDE_STEP = -32768;
+
+  SamplingTables() : dim(0), budget(0), memory(0) {}
+
+  void reset( unsigned int _dim, size_t _budget );    // budget in bytes, 0 disables the tables
+  void clear( void );
+
+  // the stored table, 0 if it isn't stored
+  const Table* find( float angle, MapKind kind ) const;
+
+  // stores the map if the budget allows it, returns the table or 0
+  const Table* store( float angle, MapKind kind, const int* map );
+
+  // line l of a table (dim indices): a pointer to the stored indices, or the line decoded in buffer
+  const int* getLine( const Table& table, unsigned int l, int* buffer ) const;
+
+  // the whole map
+  void decode( const Table& table, int* map ) const;
+
+  size_t getMemory( void ) const { return memory; }
+  size_t getBudget( void ) const { return budget; }
+
+protected:
+
+  // the 16 bits encoding of the map, false if a step doesn't fit
+  bool encode( const int* map, Table& table ) const;
+
+  unsigned int dim;
+  size_t budget;
+  size_t memory;
+  std::map< std::pair<float, int>, Table > tables;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _SAMPLINGTABLES_H
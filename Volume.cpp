@@ -7,12 +7,23 @@
 #include <climits>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <iostream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 
 #include "Volume.h"
 #include "GPURecOpenGL.h"
 #include "GPUGaussianConv.h"
+#include "GPURecGLSL.h"
 #include "GLutils.h"
 #include "DBGutils.h"
+#include "THREADutils.h"
+#include "MEMutils.h"
 
 using namespace GPURec;
 
@@ -27,11 +38,24 @@ Volume::Volume() {
   data = 0;
   dim = 0;
   volumeTex = 0;
+  updateTex = 0;
+  vsliceTex = 0;
+  debugOnePlane = false;
+  debugPlaneNum = 0;
+  debugFinePlanes = false;
 }
 
 
 void Volume::terminate(void) {
  
+#ifndef _WIN32
+  if( isMapped() ) {
+    munmap( data, (size_t)dim * dim * dim * sizeof(float) );
+    unlink( mappingFileName.c_str() );
+    mappingFileName.clear();
+  }
+  else
+#endif
   delete [] data;
   data = 0;
         
@@ -39,22 +63,66 @@ void Volume::terminate(void) {
     glDeleteTextures(1, &volumeTex);
     volumeTex = 0;
   } 
+
+  if( updateTex ) {
+    glDeleteTextures(1, &updateTex);
+    updateTex = 0;
+  }
+
+  if( vsliceTex ) {
+    glDeleteTextures(1, &vsliceTex);
+    vsliceTex = 0;
+  }
 }
 
 
 void Volume::initialize( unsigned int _dim ) {
     
   dim = _dim;
-  data = new float[ dim * dim *dim ];
   
-  // create texture to store convolution result 
-  glGenTextures( 1, &vsliceTex );  GL_TEST_ERROR
-  glBindTexture( GL_TEXTURE_2D, vsliceTex );   GL_TEST_ERROR  
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, dim, dim/4, 0, GL_RGBA, GL_FLOAT, NULL );  GL_TEST_ERROR  
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, FILTERING_METHOD);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, FILTERING_METHOD);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);  
+  if( mappedFileName.empty() ) {
+    data = new float[ dim * dim *dim ];
+    return;
+  }
+  
+#ifdef _WIN32
+  std::cerr << "Out-of-core volumes are not implemented on Windows" << std::endl;
+  throw std::exception();
+#else
+  size_t size = (size_t)dim * dim * dim * sizeof(float);
+  int fd = open( mappedFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+  if( fd < 0 || ftruncate( fd, size ) != 0 ) {
+    std::cerr << "error creating the volume file " << mappedFileName << std::endl;
+    if( fd >= 0 ) close( fd );
+    throw std::exception();
+  }
+  
+  void* mapping = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+  if( mapping == MAP_FAILED ) {
+    std::cerr << "error mapping the volume file " << mappedFileName << std::endl;
+    unlink( mappedFileName.c_str() );
+    throw std::exception();
+  }
+  
+  data = (float*)mapping;
+  mappingFileName = mappedFileName;
+#endif
+}
+
+
+void Volume::releaseSlices( unsigned int firstSlice, unsigned int nbSlices ) const {
+
+#ifndef _WIN32
+  if( !isMapped() || nbSlices == 0 ) return;
+  
+  // the pages shared with the neighbour slices are released too, the shared mapping keeps their data
+  size_t pageSize = sysconf( _SC_PAGESIZE );
+  size_t sliceBytes = (size_t)dim * dim * sizeof(float);
+  size_t begin = firstSlice * sliceBytes / pageSize * pageSize;
+  size_t end = std::min( (firstSlice + nbSlices) * sliceBytes, dim * sliceBytes );
+  madvise( (char*)data + begin, end - begin, MADV_DONTNEED );
+#endif
 }
 
 
@@ -65,15 +133,16 @@ void Volume::initialize( unsigned int _dim ) {
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
 
-void Volume::createEmpty( unsigned int _dim ) {
-  
-  reset( _dim );
- 
-  for(unsigned int i = 0; i < dim; i++ ) 
+static void createSlices( unsigned int begin, unsigned int end, void* context ) {
+
+  Volume* volume = (Volume*)context;
+  unsigned int dim = volume->getDim();
+
+  for(unsigned int k = begin; k < end; k++ ) {
   for(unsigned int j = 0; j < dim; j++ )
-  for(unsigned int k = 0; k < dim; k++ ) {
+  for(unsigned int i = 0; i < dim; i++ ) {
   
-    value(i,j,k) = 1.0f;
+    volume->value(i,j,k) = 1.0f;
     
     /*// drop values outside cylinder
     float worldx = volumeToWorldCoord(i);
@@ -83,10 +152,22 @@ void Volume::createEmpty( unsigned int _dim ) {
     if( worldLength > 1 )
       value(i,j,k) = 0.0f;     */  
   }
+  
+    volume->releaseSlices( k, 1 );
+  }
+}
+
+
+void Volume::createEmpty( unsigned int _dim, bool sendToGPU, unsigned int nbThreads, THREADutils::WorkerPool* workers ) {
+  
+  reset( _dim );
+ 
+  THREADutils::parallelFor( 0, dim, createSlices, this, nbThreads, workers );
     
   maxValue = 1.0;
 
-  sendToGraphicMemory();
+  if( sendToGPU )
+    sendToGraphicMemory();
 }
 
 
@@ -104,7 +185,7 @@ void Volume::saveToRAW( const std::string& fileName, bool append ) const {
     throw std::exception();
   }
 
-  for( int k = dim-1; k >= 0; k-- )
+  for( int k = dim-1; k >= 0; k-- ) {
   for( int j = dim-1; j >= 0; j-- )
   for( unsigned int i = 0; i < dim; i++ ) {
    
@@ -112,8 +193,34 @@ void Volume::saveToRAW( const std::string& fileName, bool append ) const {
 	  file.write( (char*)&uinb, sizeof(unsigned short) );
   }
   
+    releaseSlices( k, 1 );
+  }
+  
   file.close();
 }
+
+
+void Volume::loadFromRAW( unsigned int _dim, const std::string& fileName ) {
+
+  std::ifstream file( fileName.c_str(), std::ios::in | std::ios::binary );
+  if( !file ) {
+    std::cerr << "error opening file " << fileName << std::endl;
+    throw std::exception();
+  }
+
+  reset( _dim );
+
+  for( int k = dim-1; k >= 0; k-- )
+  for( int j = dim-1; j >= 0; j-- )
+    file.read( (char*)&value(0,j,k), dim * sizeof(float) );
+
+  if( !file ) {
+    std::cerr << "error reading file " << fileName << ": " << dim << "^3 floats expected" << std::endl;
+    throw std::exception();
+  }
+
+  computeMaxValue();
+}
   
 
 // ============================================================================================ //
@@ -122,14 +229,15 @@ void Volume::saveToRAW( const std::string& fileName, bool append ) const {
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
 
-extern int thePlaneNum;
-extern bool onePlane;
-extern bool pleinplan;
-
 void Volume::projection( double angle, bool convolve ) const {
 
   glClear(GL_COLOR_BUFFER_BIT);
   
+  if( USE_GLSL ) {
+    GPURecGLSL::projection( volumeTex, angle, convolve );
+    return;
+  }
+
   // save current FBO attachment
   int projTex = 0;
   glGetFramebufferAttachmentParameterivEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME_EXT, &projTex);
@@ -175,12 +283,12 @@ void Volume::projection( double angle, bool convolve ) const {
   // the volume is sampled by *dim* planes perpendicular to the projection axis
   float deb =0;
   float fin = dim;
-  if( onePlane ) {
+  if( debugOnePlane ) {
   
-    deb = thePlaneNum;
-    fin = thePlaneNum + 0.1;
+    deb = debugPlaneNum;
+    fin = debugPlaneNum + 0.1;
   }
-  for( float vsliceNum = deb; vsliceNum < fin; vsliceNum+= (pleinplan?0.1:1) ) {
+  for( float vsliceNum = deb; vsliceNum < fin; vsliceNum+= (debugFinePlanes?0.1:1) ) {
 
     glEnable(GL_TEXTURE_3D); GL_TEST_ERROR
 
@@ -262,8 +370,13 @@ void Volume::sendToGraphicMemory() {
     glDeleteTextures(1, &volumeTex);
   }
 
+  if( updateTex ) {
+    glDeleteTextures(1, &updateTex);
+  }
+
   // reorganize data : one slice per RGBA channel
-  float *textureBuffer = new float[dim*dim*dim];
+  MEMutils::Buffer<float> staging( dim*dim*dim );
+  float *textureBuffer = staging.get();
   int indexBuffer = 0;
   
   // for each group of 4 slices
@@ -286,8 +399,6 @@ void Volume::sendToGraphicMemory() {
   glGenTextures( 1, &volumeTex ); GL_TEST_ERROR
   glBindTexture( GL_TEXTURE_3D, volumeTex ); GL_TEST_ERROR
   glTexImage3D( GL_TEXTURE_3D, 0, GL_RGBA16F_ARB, dim, dim, dim/4, 0, GL_RGBA, GL_FLOAT, textureBuffer ); GL_TEST_ERROR
-  
-  delete [] textureBuffer;
 
   glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
   glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
@@ -295,6 +406,27 @@ void Volume::sendToGraphicMemory() {
   glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP);   GL_TEST_ERROR 
   glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP);   GL_TEST_ERROR 
 
+  // create texture to store convolution result 
+  if( !vsliceTex ) {
+    glGenTextures( 1, &vsliceTex );  GL_TEST_ERROR
+    glBindTexture( GL_TEXTURE_2D, vsliceTex );   GL_TEST_ERROR  
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, dim, dim/4, 0, GL_RGBA, GL_FLOAT, NULL );  GL_TEST_ERROR  
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, FILTERING_METHOD);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, FILTERING_METHOD);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);  
+  }
+
+  // same storage for the update texture, its layers are rendered by the update pass
+  glGenTextures( 1, &updateTex ); GL_TEST_ERROR
+  glBindTexture( GL_TEXTURE_3D, updateTex ); GL_TEST_ERROR
+  glTexImage3D( GL_TEXTURE_3D, 0, GL_RGBA16F_ARB, dim, dim, dim/4, 0, GL_RGBA, GL_FLOAT, NULL ); GL_TEST_ERROR
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP);  GL_TEST_ERROR 
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP);   GL_TEST_ERROR 
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP);   GL_TEST_ERROR 
+
   glBindTexture( GL_TEXTURE_3D, 0 );   GL_TEST_ERROR  // force transfer to graphic memory
   glBindTexture( GL_TEXTURE_3D, volumeTex );
 
@@ -312,7 +444,8 @@ void Volume::retrieveFromGraphicMemory() {
   glDisable( GL_BLEND );
   glBindTexture( GL_TEXTURE_3D, volumeTex ); GL_TEST_ERROR
   
-  float *textureBuffer = new float[dim*dim*4];
+  MEMutils::Buffer<float> staging( dim*dim*4 );
+  float *textureBuffer = staging.get();
   
   glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::tex1Dim, 0 ); GL_TEST_ERROR
   
@@ -361,14 +494,43 @@ void Volume::retrieveFromGraphicMemory() {
   
   glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 ); GL_TEST_ERROR
   
-  delete [] textureBuffer;
-  
   glPopAttrib();
   
   std::cout << "Volume sum: " << sum << std::endl;
 }
 
 
+void Volume::scale( float factor ) {
+
+  for( unsigned int i = 0; i < dim * dim * dim; i++ )
+    data[i] *= factor;
+  maxValue *= factor;
+}
+
+
+void Volume::computeMaxValue() {
+
+  maxValue = 0.0f;
+  for( unsigned int i = 0; i < dim * dim * dim; i++ )
+    if( data[i] > maxValue ) maxValue = data[i];
+}
+
+
+// the layer *sliceGroup* of the update texture holds the slices 4*sliceGroup to 4*sliceGroup+3
+void Volume::attachUpdateLayerToFBO( unsigned int sliceGroup ) {
+
+  assert( updateTex != 0 && sliceGroup < dim/4 );
+  glFramebufferTexture3DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_3D, updateTex, 0, sliceGroup ); GL_TEST_ERROR
+}
+
+
+// to be called once all the layers of the update texture have been rendered
+void Volume::swapTextures() {
+
+  std::swap( volumeTex, updateTex );
+}
+
+
 
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
@@ -471,7 +633,8 @@ void Volume::drawBoundingBox() const {
 
 void Volume::loadSliceAsTexture( MajorAxis axis, int sliceNumber ) const {
 
-  float* textureBuffer = new float[ dim * dim ];
+  MEMutils::Buffer<float> staging( dim * dim );
+  float* textureBuffer = staging.get();
   
   switch( axis ) {
   
@@ -518,8 +681,6 @@ void Volume::loadSliceAsTexture( MajorAxis axis, int sliceNumber ) const {
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,GL_NEAREST); GL_TEST_ERROR 
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);  GL_TEST_ERROR 
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);  GL_TEST_ERROR 
-  
-  delete [] textureBuffer;
 }
 
 
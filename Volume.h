@@ -3,9 +3,12 @@
 #define _VOLUME_H
 
 #include <string>
+#include <vector>
 #include <GL/glew.h>
 #include <GL/glut.h>
 
+#include "THREADutils.h"
+
 namespace GPURec {
 
 
@@ -26,8 +29,18 @@ public:
         
         // IO methods
         // ------------------------------------------        
-        void createEmpty( unsigned int _dim = 64 );
+        // with sendToGPU false the volume is only in main memory, its slices are first written by the
+        // threads of parallelFor( 0, dim, ..., nbThreads, workers ) like in the CPU kernels
+        void createEmpty( unsigned int _dim = 64, bool sendToGPU = true, unsigned int nbThreads = 1, THREADutils::WorkerPool* workers = 0 );
         void saveToRAW( const std::string& fileName, bool append = false ) const;
+        void loadFromRAW( unsigned int _dim, const std::string& fileName );   // 32 bits floats in the slice/line order of saveToRAW, main memory only
+        
+        // out-of-core volumes: with a file name the data allocated by initialize() is a shared mapping of
+        // this file, created for the volume and removed by terminate()
+        // releaseSlices drops the resident pages of the slices, they are written back to the file and read again on use
+        void setMappedFile( const std::string& fileName ) { mappedFileName = fileName; }
+        bool isMapped( void ) const { return !mappingFileName.empty(); }
+        void releaseSlices( unsigned int firstSlice, unsigned int nbSlices ) const;
 
 
         //  MATHEMATICAL TRANSFORMS
@@ -35,18 +48,24 @@ public:
         void projection( double angle, bool convolve = true ) const;
         
         void downSample( Volume &destVolume );
+        void scale( float factor );         // multiply the values in main memory
         
         //  GRAPHIC MEMORY TRANSFERS
         // ------------------------------------------
         void sendToGraphicMemory();         // create a 3D texture with the data and load it to graphic memory
         void retrieveFromGraphicMemory();   // copy back the texture to the data array in main memory
+        void attachUpdateLayerToFBO( unsigned int sliceGroup );  // render target of the update of a group of 4 slices
+        void swapTextures();                // the updated texture becomes the volume texture
 
 
         // GETTERS
         // ------------------------------------------
-        GLuint getVolumeTex() { return volumeTex; }
+        GLuint getVolumeTex() const { return volumeTex; }
         unsigned int getDim( void ) const { return dim; }; 
         float getMaxValue() { return maxValue; }
+        void computeMaxValue();             // update the maximum value from the data in main memory
+        float* getData( void ) { return data; }
+        const float* getData( void ) const { return data; }
         float voxelSize( void ) const { return 2.0 / dim; };
         
         float& value( unsigned int i, unsigned int j, unsigned int k ) {  
@@ -64,6 +83,11 @@ public:
         void drawBoundingBox() const;
         void drawGrid() const;
         void loadSliceAsTexture( MajorAxis axis, int sliceNumber ) const;   // load a slice of the volume in the current texture 
+        
+        // planes drawn by projection(): only planeNum with onePlane, 10 planes per voxel with finePlanes
+        void setDebugPlanes( bool onePlane, unsigned int planeNum, bool finePlanes ) {
+          debugOnePlane = onePlane;  debugPlaneNum = planeNum;  debugFinePlanes = finePlanes;
+        }
         friend float diff( const Volume& v1, const Volume& v2 );  // compute the Relative Mean Error between 2 volumes 
 
         
@@ -79,13 +103,25 @@ protected:
   float *data;         // volume values    
   unsigned int dim;    // volume dimension: for non-cubic dimensions split into several cubic volumes 
   
+  std::string mappedFileName;   // storage of the next data arrays, empty for main memory
+  std::string mappingFileName;  // file of the current data, empty when data is in main memory
+  
   GLuint volumeTex;    // texture object IDs
+  GLuint updateTex;    // ping-pong pair of volumeTex: the update pass reads volumeTex and writes in its layers
   GLuint vsliceTex;
 
   float maxValue;
+  
+  bool debugOnePlane;
+  unsigned int debugPlaneNum;
+  bool debugFinePlanes;
 };
 
 
+// mean absolute error between 2 volumes, the borders outside the reconstructed cylinder are skipped
+float diff( const Volume& v1, const Volume& v2 );
+
+
 } // end namespace GPURec
 
 #endif  // _VOLUME_H
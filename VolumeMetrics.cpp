@@ -0,0 +1,318 @@
+
+#include "common.h"
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VOLUMEMETRICS_SSE2 1
+#endif
+
+#include "VolumeMetrics.h"
+#include "Volume.h"
+#include "THREADutils.h"
+
+using namespace GPURec;
+
+// side of the SSIM windows
+static const unsigned int BLOCK_SIZE = 8;
+
+
+void VolumeMetrics::Sums::add( const Sums& sums ) {
+
+  if( sums.n == 0 ) return;
+  if( n == 0 ) { *this = sums; return; }
+
+  n += sums.n;
+  x += sums.x;    y += sums.y;
+  xx += sums.xx;  yy += sums.yy;  xy += sums.xy;
+  absDiff += sums.absDiff;
+  sqDiff += sums.sqDiff;
+  minX = std::min( minX, sums.minX );
+  maxX = std::max( maxX, sums.maxX );
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  SUMS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+#ifdef VOLUMEMETRICS_SSE2
+
+static inline double horizontalSum( __m128d v ) {
+
+  double lanes[2];
+  _mm_storeu_pd( lanes, v );
+  return lanes[0] + lanes[1];
+}
+
+#endif
+
+
+// the sums are accumulated in double: in float the variances xx/n - mean^2 of the SSIM cancel
+// for the blocks of high values
+void VolumeMetrics::accumulateBlock( const float* x, const float* y, unsigned int dim, Sums& sums ) {
+
+  Sums block;
+  block.n = BLOCK_SIZE * BLOCK_SIZE;
+
+#ifdef VOLUMEMETRICS_SSE2
+  __m128d sx = _mm_setzero_pd(), sy = _mm_setzero_pd();
+  __m128d sxx = _mm_setzero_pd(), syy = _mm_setzero_pd(), sxy = _mm_setzero_pd();
+  __m128d sad = _mm_setzero_pd(), ssd = _mm_setzero_pd();
+  __m128 mn = _mm_loadu_ps( x ), mx = mn;
+
+  for( unsigned int r = 0; r < BLOCK_SIZE; r++ )
+  for( unsigned int h = 0; h < BLOCK_SIZE; h += 4 ) {
+
+    __m128 a4 = _mm_loadu_ps( x + h + r*dim );
+    __m128 b4 = _mm_loadu_ps( y + h + r*dim );
+    mn = _mm_min_ps( mn, a4 );
+    mx = _mm_max_ps( mx, a4 );
+
+    // lanes 0-1 then 2-3 in double
+    for( unsigned int half = 0; half < 2; half++ ) {
+
+      __m128d a = _mm_cvtps_pd( a4 );
+      __m128d b = _mm_cvtps_pd( b4 );
+      __m128d d = _mm_sub_pd( b, a );
+      sx = _mm_add_pd( sx, a );
+      sy = _mm_add_pd( sy, b );
+      sxx = _mm_add_pd( sxx, _mm_mul_pd( a, a ) );
+      syy = _mm_add_pd( syy, _mm_mul_pd( b, b ) );
+      sxy = _mm_add_pd( sxy, _mm_mul_pd( a, b ) );
+      sad = _mm_add_pd( sad, _mm_max_pd( d, _mm_sub_pd( _mm_setzero_pd(), d ) ) );
+      ssd = _mm_add_pd( ssd, _mm_mul_pd( d, d ) );
+      a4 = _mm_movehl_ps( a4, a4 );
+      b4 = _mm_movehl_ps( b4, b4 );
+    }
+  }
+
+  block.x = horizontalSum( sx );    block.y = horizontalSum( sy );
+  block.xx = horizontalSum( sxx );  block.yy = horizontalSum( syy );  block.xy = horizontalSum( sxy );
+  block.absDiff = horizontalSum( sad );
+  block.sqDiff = horizontalSum( ssd );
+
+  float lanes[4];
+  _mm_storeu_ps( lanes, mn );
+  block.minX = std::min( std::min( lanes[0], lanes[1] ), std::min( lanes[2], lanes[3] ) );
+  _mm_storeu_ps( lanes, mx );
+  block.maxX = std::max( std::max( lanes[0], lanes[1] ), std::max( lanes[2], lanes[3] ) );
+#else
+  block.minX = block.maxX = x[0];
+
+  for( unsigned int r = 0; r < BLOCK_SIZE; r++ )
+  for( unsigned int h = 0; h < BLOCK_SIZE; h++ ) {
+
+    double a = x[ h + r*dim ];
+    double b = y[ h + r*dim ];
+    double d = b - a;
+    block.x += a;      block.y += b;
+    block.xx += a*a;   block.yy += b*b;   block.xy += a*b;
+    block.absDiff += fabs( d );
+    block.sqDiff += d*d;
+    block.minX = std::min( block.minX, x[ h + r*dim ] );
+    block.maxX = std::max( block.maxX, x[ h + r*dim ] );
+  }
+#endif
+
+  sums.add( block );
+}
+
+
+void VolumeMetrics::accumulateVoxels( const float* x, const float* y, unsigned int n, Sums& sums ) {
+
+  if( n == 0 ) return;
+
+  Sums voxels;
+  voxels.n = n;
+  voxels.minX = voxels.maxX = x[0];
+
+  for( unsigned int i = 0; i < n; i++ ) {
+
+    double a = x[i];
+    double b = y[i];
+    voxels.x += a;     voxels.y += b;
+    voxels.xx += a*a;  voxels.yy += b*b;  voxels.xy += a*b;
+    voxels.absDiff += fabs( b - a );
+    voxels.sqDiff += (b - a) * (b - a);
+    voxels.minX = std::min( voxels.minX, x[i] );
+    voxels.maxX = std::max( voxels.maxX, x[i] );
+  }
+
+  sums.add( voxels );
+}
+
+
+void VolumeMetrics::accumulateSlices( unsigned int begin, unsigned int end, void* context ) {
+
+  MetricsContext* ctx = (MetricsContext*)context;
+  unsigned int dim = ctx->dim;
+  const std::vector<MetricsROI>& rois = *ctx->rois;
+
+  // reliable square [first,last) of a slice, covered by the SSIM blocks up to blockEnd
+  unsigned int first = ctx->border;
+  unsigned int last = dim - ctx->border;
+  unsigned int nbBlocks = (last - first) / BLOCK_SIZE;
+  unsigned int blockEnd = first + nbBlocks * BLOCK_SIZE;
+
+  for( unsigned int k = begin; k < end; k++ ) {
+
+    const float* x = ctx->reference + k*dim*dim;
+    const float* y = ctx->volume + k*dim*dim;
+    SliceSums& slice = (*ctx->slices)[k];
+
+    slice.blocks.assign( nbBlocks * nbBlocks, Sums() );
+    for( unsigned int bj = 0; bj < nbBlocks; bj++ )
+    for( unsigned int bi = 0; bi < nbBlocks; bi++ ) {
+
+      unsigned int offset = (first + bi*BLOCK_SIZE) + (first + bj*BLOCK_SIZE) * dim;
+      accumulateBlock( x + offset, y + offset, dim, slice.blocks[ bi + bj*nbBlocks ] );
+      slice.sums.add( slice.blocks[ bi + bj*nbBlocks ] );
+    }
+
+    // voxels on the right and on the top of the blocks
+    for( unsigned int j = first; j < blockEnd; j++ )
+      accumulateVoxels( x + blockEnd + j*dim, y + blockEnd + j*dim, last - blockEnd, slice.sums );
+    for( unsigned int j = blockEnd; j < last; j++ )
+      accumulateVoxels( x + first + j*dim, y + first + j*dim, last - first, slice.sums );
+
+    // ROIs crossing the slice
+    slice.rois.assign( rois.size(), ROISums() );
+    for( unsigned int r = 0; r < rois.size(); r++ ) {
+
+      const MetricsROI& roi = rois[r];
+      if( k < roi.kMin || k >= std::min( roi.kMax, dim ) ) continue;
+
+      ROISums& roiSums = slice.rois[r];
+      for( unsigned int j = roi.jMin; j < std::min( roi.jMax, dim ); j++ )
+      for( unsigned int i = roi.iMin; i < std::min( roi.iMax, dim ); i++ ) {
+
+        float value = y[ i + j*dim ];
+        if( roiSums.n == 0 ) roiSums.minY = roiSums.maxY = value;
+        roiSums.n++;
+        roiSums.y += value;
+        roiSums.yy += (double)value * value;
+        roiSums.x += x[ i + j*dim ];
+        roiSums.minY = std::min( roiSums.minY, value );
+        roiSums.maxY = std::max( roiSums.maxY, value );
+      }
+    }
+  }
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  METRICS
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+
+double VolumeMetrics::blockSSIM( const Sums& block, double c1, double c2 ) {
+
+  double meanX = block.x / block.n;
+  double meanY = block.y / block.n;
+  double varianceX = block.xx / block.n - meanX * meanX;
+  double varianceY = block.yy / block.n - meanY * meanY;
+  double covariance = block.xy / block.n - meanX * meanY;
+
+  return ( (2.0 * meanX * meanY + c1) * (2.0 * covariance + c2) )
+       / ( (meanX * meanX + meanY * meanY + c1) * (varianceX + varianceY + c2) );
+}
+
+
+void VolumeMetrics::compute( const Volume& reference, const Volume& volume, unsigned int nbThreads ) {
+
+  unsigned int dim = reference.getDim();
+  if( volume.getDim() != dim || !reference.getData() || !volume.getData() ) {
+    std::cerr << "error computing the metrics: volumes of different sizes or not in main memory" << std::endl;
+    throw std::exception();
+  }
+
+  std::vector<SliceSums> slices( dim );
+
+  MetricsContext ctx;
+  ctx.reference = reference.getData();
+  ctx.volume = volume.getData();
+  ctx.dim = dim;
+  ctx.border = (unsigned int)( dim * (sqrt(2.0)-1.0)/2 );
+  ctx.rois = &rois;
+  ctx.slices = &slices;
+
+  THREADutils::parallelFor( 0, dim, accumulateSlices, &ctx, nbThreads );
+
+  // reduction in slice order
+  Sums total;
+  for( unsigned int k = 0; k < dim; k++ )
+    total.add( slices[k].sums );
+
+  double range = total.maxX - total.minX;
+  mae = total.n ? total.absDiff / total.n : 0.0;
+  rmse = total.n ? sqrt( total.sqDiff / total.n ) : 0.0;
+  psnr = ( rmse > 0.0 ) ? 20.0 * log10( total.maxX / rmse ) : HUGE_VAL;
+  nrmse = ( range > 0.0 ) ? rmse / range : 0.0;
+
+  // constants of Wang et al. for the dynamic range of the reference
+  double dynamicRange = ( range > 0.0 ) ? range : 1.0;
+  double c1 = (0.01 * dynamicRange) * (0.01 * dynamicRange);
+  double c2 = (0.03 * dynamicRange) * (0.03 * dynamicRange);
+
+  sliceSSIM.assign( dim, 0.0 );
+  meanSSIM = 0.0;
+  for( unsigned int k = 0; k < dim; k++ ) {
+
+    const std::vector<Sums>& blocks = slices[k].blocks;
+    for( unsigned int b = 0; b < blocks.size(); b++ )
+      sliceSSIM[k] += blockSSIM( blocks[b], c1, c2 );
+    if( !blocks.empty() ) sliceSSIM[k] /= blocks.size();
+    meanSSIM += sliceSSIM[k] / dim;
+  }
+
+  roiStatistics.assign( rois.size(), ROIStatistics() );
+  for( unsigned int r = 0; r < rois.size(); r++ ) {
+
+    ROISums roiSums;
+    for( unsigned int k = 0; k < dim; k++ ) {
+
+      const ROISums& slice = slices[k].rois[r];
+      if( slice.n == 0 ) continue;
+      if( roiSums.n == 0 ) { roiSums.minY = slice.minY; roiSums.maxY = slice.maxY; }
+      roiSums.n += slice.n;
+      roiSums.y += slice.y;
+      roiSums.yy += slice.yy;
+      roiSums.x += slice.x;
+      roiSums.minY = std::min( roiSums.minY, slice.minY );
+      roiSums.maxY = std::max( roiSums.maxY, slice.maxY );
+    }
+
+    ROIStatistics& statistics = roiStatistics[r];
+    statistics.nbVoxels = roiSums.n;
+    statistics.mean = roiSums.n ? roiSums.y / roiSums.n : 0.0;
+    double variance = roiSums.n ? roiSums.yy / roiSums.n - statistics.mean * statistics.mean : 0.0;
+    statistics.standardDeviation = sqrt( std::max( variance, 0.0 ) );
+    statistics.minValue = roiSums.minY;
+    statistics.maxValue = roiSums.maxY;
+    statistics.referenceMean = roiSums.n ? roiSums.x / roiSums.n : 0.0;
+  }
+}
+
+
+void VolumeMetrics::print( std::ostream& stream ) const {
+
+  stream << "MAE: " << mae << "  RMSE: " << rmse << "  PSNR: " << psnr << " dB  NRMSE: " << nrmse
+         << "  SSIM: " << meanSSIM << std::endl;
+
+  for( unsigned int r = 0; r < roiStatistics.size(); r++ ) {
+
+    const ROIStatistics& statistics = roiStatistics[r];
+    stream << "ROI " << r << ": " << statistics.nbVoxels << " voxels, mean " << statistics.mean
+           << " (reference " << statistics.referenceMean << "), std " << statistics.standardDeviation
+           << ", min " << statistics.minValue << ", max " << statistics.maxValue << std::endl;
+  }
+}
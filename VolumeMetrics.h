@@ -0,0 +1,115 @@
+#ifndef _VOLUMEMETRICS_H
+#define _VOLUMEMETRICS_H
+
+#include <vector>
+#include <ostream>
+
+namespace GPURec {
+
+class Volume;
+
+
+// box of voxels [iMin,iMax) x [jMin,jMax) x [kMin,kMax), clamped to the volume
+struct MetricsROI {
+
+  MetricsROI( unsigned int _iMin = 0, unsigned int _iMax = 0, unsigned int _jMin = 0, unsigned int _jMax = 0,
+              unsigned int _kMin = 0, unsigned int _kMax = 0 ) :
+    iMin(_iMin), iMax(_iMax), jMin(_jMin), jMax(_jMax), kMin(_kMin), kMax(_kMax) {}
+
+  unsigned int iMin, iMax, jMin, jMax, kMin, kMax;
+};
+
+
+// values of the volume in a ROI, and mean of the reference in the same voxels
+struct ROIStatistics {
+
+  unsigned int nbVoxels;
+  double mean;
+  double standardDeviation;
+  float minValue;
+  float maxValue;
+  double referenceMean;
+};
+
+
+// Image quality of a reconstructed volume against a reference (phantom), computed in one pass
+// over the two volumes: the slices are shared by the threads and the 8x8 blocks of a slice are
+// summed in double with SSE2. The partial sums are reduced in slice order, so the results don't
+// depend on the number of threads.
+// The errors and the SSIM use the same voxels as diff(): the borders outside the reconstructed
+// cylinder are skipped. MAE is normalized by the number of voxels used (diff() by dim^3).
+// SSIM is the mean of the SSIM of the 8x8 blocks of a slice, its dynamic range is the one of the reference.
+class VolumeMetrics {
+
+public:
+
+  VolumeMetrics() : mae(0), rmse(0), psnr(0), nrmse(0), meanSSIM(0) {}
+
+  void addROI( const MetricsROI& roi ) { rois.push_back( roi ); }
+  void clearROIs( void ) { rois.clear(); }
+
+  // nbThreads = 0 uses one thread per hardware thread, both volumes in main memory
+  void compute( const Volume& reference, const Volume& volume, unsigned int nbThreads = 0 );
+
+  double getMAE( void ) const { return mae; }
+  double getRMSE( void ) const { return rmse; }
+  double getPSNR( void ) const { return psnr; }                 // dB, peak = maximum of the reference
+  double getNRMSE( void ) const { return nrmse; }               // RMSE / range of the reference
+  double getMeanSSIM( void ) const { return meanSSIM; }
+  const std::vector<double>& getSliceSSIM( void ) const { return sliceSSIM; }
+  const std::vector<ROIStatistics>& getROIStatistics( void ) const { return roiStatistics; }
+
+  void print( std::ostream& stream ) const;
+
+protected:
+
+  // sums of the reference (x), the volume (y) and their difference over a set of voxels
+  struct Sums {
+    Sums() : n(0), x(0), y(0), xx(0), yy(0), xy(0), absDiff(0), sqDiff(0), minX(0), maxX(0) {}
+    void add( const Sums& sums );
+    unsigned int n;
+    double x, y, xx, yy, xy;
+    double absDiff, sqDiff;
+    float minX, maxX;
+  };
+
+  struct ROISums {
+    ROISums() : n(0), y(0), yy(0), x(0), minY(0), maxY(0) {}
+    unsigned int n;
+    double y, yy, x;
+    float minY, maxY;
+  };
+
+  // partial results of a slice, filled by one thread
+  struct SliceSums {
+    Sums sums;
+    std::vector<Sums> blocks;     // 8x8 blocks of the SSIM
+    std::vector<ROISums> rois;
+  };
+
+  struct MetricsContext {
+    const float* reference;
+    const float* volume;
+    unsigned int dim;
+    unsigned int border;          // first reliable line and column
+    const std::vector<MetricsROI>* rois;
+    std::vector<SliceSums>* slices;
+  };
+
+  static void accumulateSlices( unsigned int begin, unsigned int end, void* context );
+  static void accumulateBlock( const float* x, const float* y, unsigned int dim, Sums& sums );
+  static void accumulateVoxels( const float* x, const float* y, unsigned int n, Sums& sums );
+
+  static double blockSSIM( const Sums& block, double c1, double c2 );
+
+  std::vector<MetricsROI> rois;
+
+  double mae, rmse, psnr, nrmse, meanSSIM;
+  std::vector<double> sliceSSIM;
+  std::vector<ROIStatistics> roiStatistics;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _VOLUMEMETRICS_H
@@ -6,12 +6,17 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <vector>
 
 #include "VolumeProjectionSet.h"
 #include "Volume.h"
 #include "GPURecOpenGL.h"
 #include "GPUGaussianConv.h"
+#include "GPURecGLSL.h"
+#include "ReconstructionBackend.h"
 #include "GLutils.h"
+#include "THREADutils.h"
+#include "MEMutils.h"
 #include "DBGutils.h"
 
 using namespace GPURec;
@@ -25,12 +30,13 @@ using namespace GPURec;
 void VolumeProjectionSet::initialize() {
   
   projections = 0;
+  projectionsTex = 0;
   nbProjection = 0;
   dim = 0;
   pixelSize = 0;
   startAngle = 0;
   rotationIncrement = 0;
-  currentSubset = 0;
+  counts = 0;
 }
 
 
@@ -40,15 +46,20 @@ void VolumeProjectionSet::terminate() {
   
     for( unsigned int p = 0; p < nbProjection; p++ ) {
       
-      glDeleteTextures( 1, &(projections[p].texture) ); GL_TEST_ERROR      
-      
       if( projections[p].data )
         delete [] projections[p].data;
+      if( projections[p].counts )
+        delete [] projections[p].counts;
     }
     
     delete [] projections; 
     projections = 0;
   }
+  
+  if( projectionsTex ) {
+    glDeleteTextures( 1, &projectionsTex ); GL_TEST_ERROR
+    projectionsTex = 0;
+  }
 }
 
 
@@ -59,7 +70,8 @@ void VolumeProjectionSet::terminate() {
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
 
-void VolumeProjectionSet::createEmpty( unsigned int _dim, unsigned int _nbProjection, float _startAngle, float _rotationIncrement ) {
+void VolumeProjectionSet::createEmpty( unsigned int _dim, unsigned int _nbProjection, float _startAngle, float _rotationIncrement, bool sendToGPU,
+                                       unsigned int nbThreads, THREADutils::WorkerPool* workers ) {
 
   reset();
   
@@ -75,35 +87,30 @@ void VolumeProjectionSet::createEmpty( unsigned int _dim, unsigned int _nbProjec
   if( rotationIncrement == 0.0 )
     rotationIncrement = (2.0f * M_PI) / nbProjection;
 
-  float* emptyTab = new float[ dim * dim ];
-  for( unsigned int i = 0; i < dim * dim; i++ )
-    emptyTab[i] = 1.0;
-
-  // load projections textures
   float angle = startAngle;
+  angles.resize( nbProjection );
   for( unsigned int p = 0; p < nbProjection; p++ ) {
    
-    // for each angle store the projection into a texture object
-    projections[p].angle = angle;  
-            
-    glGenTextures( 1, &(projections[p].texture) ); GL_TEST_ERROR     
-    glBindTexture( GL_TEXTURE_2D, projections[p].texture );  GL_TEST_ERROR 
-    
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, dim, dim/4, 0, GL_RGBA, GL_FLOAT, emptyTab ); GL_TEST_ERROR         
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);   GL_TEST_ERROR 
-        
+    projections[p].angle = angles[p] = angle;  
     angle += rotationIncrement;
   }
   
-  delete [] emptyTab;
+  if( !sendToGPU ) {
+  
+    for( unsigned int p = 0; p < nbProjection; p++ ) {
+      projections[p].data = new float[dim * dim];
+      THREADutils::fill( projections[p].data, dim, dim, 1.0f, nbThreads, workers );
+    }
+    return;
+  }
+  
+  // load projections texture
+  uploadProjections( CONSTANT_SOURCE );
 }
 
 
 void VolumeProjectionSet::createFromRAW(  unsigned int _dim, float _pixelSize, unsigned int _nbProjection, float _startAngle, float _rotationIncrement, 
-                                          const std::string& fileName, unsigned int offset ) {
+                                          const std::string& fileName, unsigned int offset, bool sendToGPU, bool keepCounts ) {
      
   reset();
 
@@ -123,9 +130,6 @@ void VolumeProjectionSet::createFromRAW(  unsigned int _dim, float _pixelSize, u
   startAngle = _startAngle;
   rotationIncrement = _rotationIncrement;
   
-  unsigned short *textureBuffer =  new unsigned short[dim*dim];
-  float *floatTextureBuffer =  new float[dim*dim];
-   
    // go to the scan position
   file.seekg( offset, std::ios::beg );
   
@@ -136,43 +140,52 @@ void VolumeProjectionSet::createFromRAW(  unsigned int _dim, float _pixelSize, u
   }
   
   float angle = 0.0;
-  float sum = 0.0;
+  angles.resize( nbProjection );
   for( unsigned int p = 0; p < nbProjection; p++ ) {
       
-    // for each angle store the projection into a texture object
-    projections[p].angle = angle;   
+    projections[p].angle = angles[p] = angle;   
+    angle += rotationIncrement;
+  }  
+  
+  double sum = 0.0;
+  if( sendToGPU ) {
+  
+    // load projections texture directly from the file
+    sum = uploadProjections( RAW_FILE_SOURCE, &file );
+  }
+  else if( keepCounts ) {
+  
+    // the RAW lines are read in place, from the top line of the projection
+    for( unsigned int p = 0; p < nbProjection; p++ ) {
     
-    file.read( (char*)textureBuffer, dim * dim * sizeof(unsigned short) );
-
-    int index = 0;
-    for( unsigned int j = 0; j < dim/4; j++ )
-    for( unsigned int i = 0; i < dim; i++ ) {
+      projections[p].counts = new unsigned short[dim * dim];
+      for( unsigned int j = 0; j < dim; j++ )
+        file.read( (char*)&projections[p].counts[ (dim-1-j)*dim ], dim * sizeof(unsigned short) );
+        
+      for( unsigned int i = 0; i < dim * dim; i++ )
+        sum += projections[p].counts[i];
+    }
+  }
+  else {
+  
+    // main memory only: RAW lines are stored from top to bottom, the data lines from bottom to top
+    MEMutils::Buffer<unsigned short> staging( dim * dim );
+    unsigned short* rawBuffer = staging.get();
+    for( unsigned int p = 0; p < nbProjection; p++ ) {
+    
+      file.read( (char*)rawBuffer, dim * dim * sizeof(unsigned short) );
+      projections[p].data = new float[dim * dim];
       
-      floatTextureBuffer[index++] = textureBuffer[i+(dim-j*4-4)*dim];
-      floatTextureBuffer[index++] = textureBuffer[i+(dim-j*4-3)*dim];
-      floatTextureBuffer[index++] = textureBuffer[i+(dim-j*4-2)*dim];
-      floatTextureBuffer[index++] = textureBuffer[i+(dim-j*4-1)*dim];
-
-      sum = sum + textureBuffer[i+(dim-j*4-4)*dim] + textureBuffer[i+(dim-j*4-3)*dim] + textureBuffer[i+(dim-j*4-2)*dim] + textureBuffer[i+(dim-j*4-1)*dim];
-    }  
+      for( unsigned int j = 0; j < dim; j++ )
+      for( unsigned int i = 0; i < dim; i++ ) {
       
-    glGenTextures( 1, &(projections[p].texture) ); GL_TEST_ERROR     
-
-    glBindTexture( GL_TEXTURE_2D, projections[p].texture);  GL_TEST_ERROR 
-    
-
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, dim, dim/4, 0, GL_RGBA, GL_FLOAT, floatTextureBuffer); GL_TEST_ERROR   
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,FILTERING_METHOD);   GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);   GL_TEST_ERROR 
-     
-    angle += rotationIncrement;
-  }  
+        projections[p].data[ i + j*dim ] = rawBuffer[ i + (dim-1-j)*dim ];
+        sum += rawBuffer[ i + (dim-1-j)*dim ];
+      }
+    }
+  }
  
-  delete [] textureBuffer;
-  delete [] floatTextureBuffer;
-
+  counts = sum;
   std::cout << "Scan sum: " << sum / nbProjection << std::endl;
 
   file.close();
@@ -185,7 +198,7 @@ void VolumeProjectionSet::createFromRAW(  unsigned int _dim, float _pixelSize, u
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
 
-void VolumeProjectionSet::backProjectSlice( unsigned int sliceNum ) const {
+void VolumeProjectionSet::backProjectSlice( unsigned int sliceNum, unsigned int firstProjection, unsigned int step, bool convolve ) const {
   
   glClear(GL_COLOR_BUFFER_BIT);
  
@@ -195,30 +208,34 @@ void VolumeProjectionSet::backProjectSlice( unsigned int sliceNum ) const {
   glBlendFunc(GL_ONE,GL_ONE);  GL_TEST_ERROR    
   glMatrixMode( GL_MODELVIEW ); 
 
-  for( unsigned int p = currentSubset; p < nbProjection; p += NB_SUBSETS ) {
+  for( unsigned int p = firstProjection; p < nbProjection; p += step ) {
     
-    if( USE_OSEM3D )
-      GPUGaussianConv::convolveAndBackProject( projections[p].texture, projections[p].angle, sliceNum );      
+    if( convolve )
+      GPUGaussianConv::convolveAndBackProject( projectionsTex, getLayerCoord(p), projections[p].angle, sliceNum );      
     else {
       float imageHeight = dim/4;
+      float layer = getLayerCoord(p);
 
-      glBindTexture( GL_TEXTURE_2D, projections[p].texture ); GL_TEST_ERROR  
+      glEnable( GL_TEXTURE_3D );
+      glBindTexture( GL_TEXTURE_3D, projectionsTex ); GL_TEST_ERROR  
 
       glLoadIdentity();
       glRotated( projections[p].angle*180.0/M_PI,  0,0,1 );
 
       glBegin(GL_QUADS);
-        glTexCoord2f( 0, (0.5+sliceNum)/imageHeight ); glVertex3f(-1,-1,0); 
-        glTexCoord2f( 1, (0.5+sliceNum)/imageHeight ); glVertex3f(1,-1,0); 
-        glTexCoord2f( 1, (0.5+sliceNum)/imageHeight ); glVertex3f(1,1,0); 
-        glTexCoord2f( 0, (0.5+sliceNum)/imageHeight ); glVertex3f(-1,1,0);
+        glTexCoord3f( 0, (0.5+sliceNum)/imageHeight, layer ); glVertex3f(-1,-1,0); 
+        glTexCoord3f( 1, (0.5+sliceNum)/imageHeight, layer ); glVertex3f(1,-1,0); 
+        glTexCoord3f( 1, (0.5+sliceNum)/imageHeight, layer ); glVertex3f(1,1,0); 
+        glTexCoord3f( 0, (0.5+sliceNum)/imageHeight, layer ); glVertex3f(-1,1,0);
       glEnd();
+      
+      glDisable( GL_TEXTURE_3D );
     }
   }
 }
 
 
-void VolumeProjectionSet::backProjection( Volume& volume ) const {
+void VolumeProjectionSet::backProjection( Volume& volume, unsigned int firstProjection, unsigned int step, bool convolve, float normalizationFactor ) const {
 
   static int nbBackproj = 0;
 
@@ -232,10 +249,21 @@ void VolumeProjectionSet::backProjection( Volume& volume ) const {
 
     glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::tex2Dim, 0 ); GL_TEST_ERROR
 
-    backProjectSlice( k );  
+    if( USE_GLSL ) {
+      glClear( GL_COLOR_BUFFER_BIT );
+      GPURecGLSL::backProjectSlice( projectionsTex, nbProjection, &angles[0], firstProjection, step, k, convolve );
+    }
+    else
+      backProjectSlice( k, firstProjection, step, convolve );  
       
-    glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::tex1Dim, 0 ); GL_TEST_ERROR 
+    // the updated slices are written in the other texture of the volume pair
+    volume.attachUpdateLayerToFBO( k );
     
+    if( USE_GLSL ) {
+      GPURecGLSL::updateSlice( volume.getVolumeTex(), GPURecOpenGL::tex2Dim, k, normalizationFactor );
+      continue;
+    }
+
     glActiveTextureARB(GL_TEXTURE0_ARB);  GL_TEST_ERROR 
     glEnable( GL_TEXTURE_3D );
     glBindTexture( GL_TEXTURE_3D, volume.getVolumeTex() );
@@ -251,7 +279,6 @@ void VolumeProjectionSet::backProjection( Volume& volume ) const {
     
     glEnable(GL_FRAGMENT_PROGRAM_ARB);    
     glBindProgramARB(GL_FRAGMENT_PROGRAM_ARB, GPURecOpenGL::updateSliceProgram);
-    float normalizationFactor = NB_SUBSETS/(float)nbProjection;
     glProgramLocalParameter4fARB( GL_FRAGMENT_PROGRAM_ARB, 0, normalizationFactor, normalizationFactor, normalizationFactor, normalizationFactor );
     
     glClear(GL_COLOR_BUFFER_BIT);
@@ -273,14 +300,10 @@ void VolumeProjectionSet::backProjection( Volume& volume ) const {
      
     glActiveTextureARB(GL_TEXTURE0_ARB);  GL_TEST_ERROR
     glDisable( GL_TEXTURE_3D );  GL_TEST_ERROR
-
-    DBGutils::timerBegin("glCopyTexSubImage3D");
-    
-    glCopyTexSubImage3D( GL_TEXTURE_3D, 0, 0, 0, k, 0, 0, dim, dim ); GL_TEST_ERROR
-    
-    DBGutils::timerEnd("glCopyTexSubImage3D");
   }
   
+  volume.swapTextures();
+
   glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 );  
   
   glDisable( GL_BLEND );
@@ -289,6 +312,51 @@ void VolumeProjectionSet::backProjection( Volume& volume ) const {
 }
 
 
+// the viewport has to be (dim x dim/4)
+void VolumeProjectionSet::divideProjection( const VolumeProjectionSet& scan, unsigned int projNum, GLuint estimatedTex ) {
+
+  // store the result in the layer of the projection
+  attachProjectionToFBO( projNum );
+  
+  if( USE_GLSL ) {
+    GPURecGLSL::divide( scan.getTexId(), projNum, estimatedTex );
+    return;
+  }
+  
+  // load volume projection texture 
+  glActiveTextureARB(GL_TEXTURE1_ARB);  GL_TEST_ERROR
+  glEnable( GL_TEXTURE_2D );  GL_TEST_ERROR
+  glBindTexture( GL_TEXTURE_2D, estimatedTex );  GL_TEST_ERROR      
+         
+  // load scanner projection texture 
+  glActiveTextureARB(GL_TEXTURE0_ARB);  GL_TEST_ERROR 
+  scan.loadProjectionAsTexture( projNum );  GL_TEST_ERROR    
+
+  glEnable(GL_FRAGMENT_PROGRAM_ARB);      
+  glBindProgramARB(GL_FRAGMENT_PROGRAM_ARB, GPURecOpenGL::textureDivPackProgram);
+  
+  glClear(GL_COLOR_BUFFER_BIT);
+  glDisable( GL_BLEND );
+  
+  GPURecOpenGL::sideView();
+  
+  float layer = scan.getLayerCoord(projNum);
+  glBegin(GL_QUADS);    
+    glTexCoord3f(0,0,layer); glVertex3f( -1, 0, -1); 
+    glTexCoord3f(1,0,layer); glVertex3f( 1, 0, -1); 
+    glTexCoord3f(1,1,layer); glVertex3f( 1, 0, 1); 
+    glTexCoord3f(0,1,layer); glVertex3f( -1, 0, 1);
+  glEnd();  GL_TEST_ERROR   
+  
+  glDisable(GL_FRAGMENT_PROGRAM_ARB);
+
+  glActiveTextureARB(GL_TEXTURE1_ARB);  GL_TEST_ERROR    
+  glDisable( GL_TEXTURE_2D );  GL_TEST_ERROR
+      
+  glActiveTextureARB(GL_TEXTURE0_ARB);  GL_TEST_ERROR              
+}
+
+
 
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
@@ -298,40 +366,106 @@ void VolumeProjectionSet::backProjection( Volume& volume ) const {
 
 void VolumeProjectionSet::sendToGraphicMemory() {
   
-  float *textureBuffer =  new float[ dim * dim/4 * 4 ];
+  if( hasCountData() ) {
+    uploadProjections( COUNTS_SOURCE );
+    return;
+  }
   
-  for( unsigned int p = 0; p < nbProjection; p++ ) {
-       
-    glDeleteTextures( 1, &(projections[p].texture) ); GL_TEST_ERROR  
+  for( unsigned int p = 0; p < nbProjection; p++ )
     if( projections[p].data == 0 ) projections[p].data = new float[dim *dim];      
     
-    glGenTextures( 1, &(projections[p].texture) ); GL_TEST_ERROR     
-    glBindTexture( GL_TEXTURE_2D, projections[p].texture );  GL_TEST_ERROR 
-       
+  uploadProjections( DATA_SOURCE );
+}
+
+
+double VolumeProjectionSet::uploadProjections( UploadSource source, std::ifstream* file ) {
+
+  if( projectionsTex ) {
+    glDeleteTextures( 1, &projectionsTex ); GL_TEST_ERROR
+  }
+  
+  glGenTextures( 1, &projectionsTex ); GL_TEST_ERROR     
+  glBindTexture( GL_TEXTURE_3D, projectionsTex );  GL_TEST_ERROR 
+  glTexImage3D( GL_TEXTURE_3D, 0, GL_RGBA16F_ARB, dim, dim/4, nbProjection, 0, GL_RGBA, GL_FLOAT, NULL ); GL_TEST_ERROR
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, FILTERING_METHOD);    GL_TEST_ERROR 
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, FILTERING_METHOD);    GL_TEST_ERROR 
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);        GL_TEST_ERROR 
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);        GL_TEST_ERROR
+  glTexParameterf(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);        GL_TEST_ERROR
+  
+  assert( source != RAW_FILE_SOURCE || file != 0 );
+  MEMutils::Buffer<unsigned short> staging( source == RAW_FILE_SOURCE ? dim*dim : 0 );
+  unsigned short *rawBuffer = staging.get();
+  
+  double sum = 0.0;
+  for( unsigned int p = 0; p < nbProjection; p++ ) {
+  
+    // the buffer is written in graphic memory: the DMA of the previous projection is still running
+    float *textureBuffer = GPURecOpenGL::acquireUploadSlot( dim * dim/4 * 4 );
     int index = 0;
-    // for each group of 4 lines
-    for( unsigned int j = 0; j < dim; j += 4 ) {
     
-      // loop through the line
-      for( unsigned int i = 0; i < dim; i++ ) {
+    switch( source ) {
+    
+      case CONSTANT_SOURCE:
+        for( unsigned int i = 0; i < dim * dim; i++ )
+          textureBuffer[index++] = 1.0;
+        break;
+        
+      case RAW_FILE_SOURCE:
       
-        // axis from bottom to top -> ABGR ordering               
-        textureBuffer[index++] = projections[p].data[ i + (j+3)*dim ];  // R channel
-        textureBuffer[index++] = projections[p].data[ i + (j+2)*dim ];  // G channel 
-        textureBuffer[index++] = projections[p].data[ i + (j+1)*dim ];  // B channel 
-        textureBuffer[index++] = projections[p].data[ i + (j+0)*dim ];  // A channel 
-      }
+        // RAW lines are stored from top to bottom
+        file->read( (char*)rawBuffer, dim * dim * sizeof(unsigned short) );
+        
+        for( unsigned int j = 0; j < dim/4; j++ )
+        for( unsigned int i = 0; i < dim; i++ ) {
+          
+          textureBuffer[index++] = rawBuffer[i+(dim-j*4-4)*dim];
+          textureBuffer[index++] = rawBuffer[i+(dim-j*4-3)*dim];
+          textureBuffer[index++] = rawBuffer[i+(dim-j*4-2)*dim];
+          textureBuffer[index++] = rawBuffer[i+(dim-j*4-1)*dim];
+    
+          sum = sum + rawBuffer[i+(dim-j*4-4)*dim] + rawBuffer[i+(dim-j*4-3)*dim] + rawBuffer[i+(dim-j*4-2)*dim] + rawBuffer[i+(dim-j*4-1)*dim];
+        }  
+        break;
+        
+      case DATA_SOURCE:
+      
+        // for each group of 4 lines
+        for( unsigned int j = 0; j < dim; j += 4 ) {
+        
+          // loop through the line
+          for( unsigned int i = 0; i < dim; i++ ) {
+          
+            // axis from bottom to top -> ABGR ordering               
+            textureBuffer[index++] = projections[p].data[ i + (j+3)*dim ];  // R channel
+            textureBuffer[index++] = projections[p].data[ i + (j+2)*dim ];  // G channel 
+            textureBuffer[index++] = projections[p].data[ i + (j+1)*dim ];  // B channel 
+            textureBuffer[index++] = projections[p].data[ i + (j+0)*dim ];  // A channel 
+          }
+        }
+        break;
+        
+      case COUNTS_SOURCE:
+      
+        for( unsigned int j = 0; j < dim; j += 4 )
+        for( unsigned int i = 0; i < dim; i++ ) {
+        
+          textureBuffer[index++] = projections[p].counts[ i + (j+3)*dim ];
+          textureBuffer[index++] = projections[p].counts[ i + (j+2)*dim ];
+          textureBuffer[index++] = projections[p].counts[ i + (j+1)*dim ];
+          textureBuffer[index++] = projections[p].counts[ i + (j+0)*dim ];
+        }
+        break;
     }
-    assert( index == dim * dim/4 );
+    assert( index == dim * dim/4 * 4 );
 
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, dim, dim/4, 0, GL_RGBA, GL_FLOAT, textureBuffer); GL_TEST_ERROR     
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, FILTERING_METHOD);    GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, FILTERING_METHOD);    GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);        GL_TEST_ERROR 
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);        GL_TEST_ERROR
+    glTexSubImage3D( GL_TEXTURE_3D, 0, 0, 0, p, dim, dim/4, 1, GL_RGBA, GL_FLOAT, GPURecOpenGL::commitUploadSlot() ); GL_TEST_ERROR
+    GPURecOpenGL::releaseUploadSlot();
   }  
   
-  delete [] textureBuffer;
+  glBindTexture( GL_TEXTURE_3D, 0 );  GL_TEST_ERROR
+  
+  return sum;
 }
 
         
@@ -340,15 +474,20 @@ void VolumeProjectionSet::retrieveFromGraphicMemory() {
   glPushAttrib( GL_ENABLE_BIT );
   glDisable( GL_BLEND ); 
   
-  float *textureBuffer = new float[dim * dim/4 * 4];
+  MEMutils::Buffer<float> staging( dim * dim/4 * 4 );
+  float *textureBuffer = staging.get();
   
   glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 ); GL_TEST_ERROR
   glViewport(0,0,dim,dim/4);  
   
-  float sum = 0.0;
+  glEnable( GL_TEXTURE_3D );
+  glBindTexture( GL_TEXTURE_3D, projectionsTex ); GL_TEST_ERROR  
+  
+  double sum = 0.0;
   for( unsigned int p = 0; p < nbProjection; p++ ) {
   
-    glBindTexture( GL_TEXTURE_2D, projections[p].texture ); GL_TEST_ERROR  
+    float layer = getLayerCoord(p);
+    if( projections[p].data == 0 ) projections[p].data = new float[dim *dim];
       
     // draw the projection because glGetTexImage seems not working
     glClear(GL_COLOR_BUFFER_BIT); 
@@ -356,10 +495,10 @@ void VolumeProjectionSet::retrieveFromGraphicMemory() {
     GPURecOpenGL::sideView();
         
     glBegin(GL_QUADS);    
-      glTexCoord2f(0,0); glVertex3f( -1, 0, -1); 
-      glTexCoord2f(1,0); glVertex3f( 1, 0, -1); 
-      glTexCoord2f(1,1); glVertex3f( 1, 0, 1); 
-      glTexCoord2f(0,1); glVertex3f( -1, 0, 1);
+      glTexCoord3f(0,0,layer); glVertex3f( -1, 0, -1); 
+      glTexCoord3f(1,0,layer); glVertex3f( 1, 0, -1); 
+      glTexCoord3f(1,1,layer); glVertex3f( 1, 0, 1); 
+      glTexCoord3f(0,1,layer); glVertex3f( -1, 0, 1);
     glEnd();  GL_TEST_ERROR   
     
     glReadPixels( 0, 0, dim, dim/4, GL_RGBA, GL_FLOAT, textureBuffer ); GL_TEST_ERROR   
@@ -376,18 +515,16 @@ void VolumeProjectionSet::retrieveFromGraphicMemory() {
       sum += textureBuffer[index] + textureBuffer[index+1] + textureBuffer[index+2] + textureBuffer[index+3];
       
       // axis from bottom to top -> ABGR order
-      projections[p].data[ i + (j+0)*dim ] = textureBuffer[index++];
-      projections[p].data[ i + (j+1)*dim ] = textureBuffer[index++];
-      projections[p].data[ i + (j+2)*dim ] = textureBuffer[index++];
       projections[p].data[ i + (j+3)*dim ] = textureBuffer[index++];
+      projections[p].data[ i + (j+2)*dim ] = textureBuffer[index++];
+      projections[p].data[ i + (j+1)*dim ] = textureBuffer[index++];
+      projections[p].data[ i + (j+0)*dim ] = textureBuffer[index++];
     }  
   }  
   
   glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 ); GL_TEST_ERROR
   glViewport(0,0,dim,dim);  
   
-  delete [] textureBuffer;
-  
   glPopAttrib();      
   
   std::cout << "Scan sum: " << sum << std::endl;    
@@ -395,35 +532,44 @@ void VolumeProjectionSet::retrieveFromGraphicMemory() {
 
 
 
+void VolumeProjectionSet::attachProjectionToFBO( unsigned int projNum ) {
+
+  assert( projNum < nbProjection );
+  glFramebufferTexture3DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_3D, projectionsTex, 0, projNum ); GL_TEST_ERROR
+}
+
+
+
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
 //  RECONSTRUCTION methods
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
 
+// done is the caller's list: it keeps its memory from one iteration to the next
 class SubsetsIterator {
 
   public:
-    SubsetsIterator() : current(0), last(false) {}
+    SubsetsIterator( unsigned int _nbSubsets, std::vector<int>& _done ) : nbSubsets(_nbSubsets), current(0), last(false), done(_done) { done.clear(); }
     int first() { current = 0; done.push_back( current ); return current; }
     
     int next() { 
     
       // if all subsets have been done, set the LAST flag and return
-      if( done.size() == NB_SUBSETS ) {
+      if( done.size() == nbSubsets ) {
       
         last = true;
         return 0;
       }
       
-      // the next subset should be at a distance of NB_SUBSETS/2 to maximize the cyclic distance 
-      current = ( current + NB_SUBSETS/2 ) % NB_SUBSETS;
+      // the next subset should be at a distance of nbSubsets/2 to maximize the cyclic distance 
+      current = ( current + nbSubsets/2 ) % nbSubsets;
       
       // but if it has been already processed, take the next
       std::vector<int>::iterator it = std::find( done.begin(), done.end(), current );
       while( it != done.end() ) {
       
-        current = (current+1)  % NB_SUBSETS;       
+        current = (current+1)  % nbSubsets;       
         it = std::find( done.begin(), done.end(), current );                
       }
       
@@ -434,79 +580,36 @@ class SubsetsIterator {
     bool isLast() { return last; }
     
   protected:
+    unsigned int nbSubsets;
     int current;
     bool last;
-    std::vector<int> done;
+    std::vector<int>& done;
 };
 
 
-void VolumeProjectionSet::osemIteration( Volume& volume, const VolumeProjectionSet& scan ) {
+void VolumeProjectionSet::osemIteration( ReconstructionBackend& backend, Volume& volume, const VolumeProjectionSet& scan ) {
+
+  const ReconstructionContext& context = backend.getContext();
+  unsigned int nbSubsets = context.nbSubsets;
 
-  if( (scan.getNbProjection()/(float)NB_SUBSETS) != (scan.getNbProjection()/NB_SUBSETS) ) {
+  if( (scan.getNbProjection()/(float)nbSubsets) != (scan.getNbProjection()/nbSubsets) ) {
 	  std::cerr << "Parameters error: The number of subsets has to be a divisor of the number of projections.\n";
-	  std::cerr << "Number of subsets:" << NB_SUBSETS << " Number of projections:" << scan.getNbProjection() << std::endl;
+	  std::cerr << "Number of subsets:" << nbSubsets << " Number of projections:" << scan.getNbProjection() << std::endl;
 	  throw std::exception();
   }
  
   // for each subset
-  SubsetsIterator itSubsets;
+  SubsetsIterator itSubsets( nbSubsets, subsetsDone );
   std::cout << "Nouvelle Iteration" << std::endl;
-  for( currentSubset = itSubsets.first(); ! itSubsets.isLast(); currentSubset = itSubsets.next() ) {
+  for( unsigned int subset = itSubsets.first(); ! itSubsets.isLast(); subset = itSubsets.next() ) {
   
-    std::cout << "subset: " << ((currentSubset<10) ? "0" : "") << currentSubset << "\r";
-    
-    glViewport( 0, 0, dim, dim/4 );
+    std::cout << "subset: " << ((subset<10) ? "0" : "") << subset << "\r";
        
     // apply MLEM iteration to the subset
-    // each subset contains (nbProjections/NB_SUBSETS) projections evenly distributed among the set
-    for( unsigned int p = currentSubset; p < scan.getNbProjection(); p += NB_SUBSETS ) {
-    
-      // store volume projection in a texture    
-      glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 ); GL_TEST_ERROR
-      DBGutils::timerBegin("1 Projection");    
-      volume.projection( projections[p].angle, USE_OSEM3D ); 
-      DBGutils::timerEnd("1 Projection");     
-      
-      // perform division and store the result in the projectionsSet texture 
-      glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, projections[p].texture, 0 ); GL_TEST_ERROR
-      
-      // load volume projection texture 
-      glActiveTextureARB(GL_TEXTURE1_ARB);  GL_TEST_ERROR
-      glEnable( GL_TEXTURE_2D );  GL_TEST_ERROR
-      glBindTexture( GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim );  GL_TEST_ERROR      
-             
-      // load scanner projection texture 
-      glActiveTextureARB(GL_TEXTURE0_ARB);  GL_TEST_ERROR 
-      scan.loadProjectionAsTexture( p );  GL_TEST_ERROR    
-  
-             
-      glEnable(GL_FRAGMENT_PROGRAM_ARB);      
-      glBindProgramARB(GL_FRAGMENT_PROGRAM_ARB, GPURecOpenGL::textureDivPackProgram);
-      
-      glClear(GL_COLOR_BUFFER_BIT);
-      glDisable( GL_BLEND );
-      
-      GPURecOpenGL::sideView();
-      
-      glBegin(GL_QUADS);    
-        glTexCoord2f(0,0); glVertex3f( -1, 0, -1); 
-        glTexCoord2f(1,0); glVertex3f( 1, 0, -1); 
-        glTexCoord2f(1,1); glVertex3f( 1, 0, 1); 
-        glTexCoord2f(0,1); glVertex3f( -1, 0, 1);
-      glEnd();  GL_TEST_ERROR   
-      
-      glDisable(GL_FRAGMENT_PROGRAM_ARB);
-    
-      glActiveTextureARB(GL_TEXTURE1_ARB);  GL_TEST_ERROR    
-      glDisable( GL_TEXTURE_2D );  GL_TEST_ERROR
-          
-      glActiveTextureARB(GL_TEXTURE0_ARB);  GL_TEST_ERROR              
-    }
-        
-    glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, GPURecOpenGL::texQuarterDim, 0 ); GL_TEST_ERROR
-    glViewport( 0, 0, dim, dim );
-    
-    backProjection( volume ); 
+    // each subset contains (nbProjections/nbSubsets) projections evenly distributed among the set
+    backend.projectSubset( volume, scan, *this, subset, nbSubsets, context.useOSEM3D );
+    backend.backProject( *this, subset, nbSubsets, context.useOSEM3D );
+    backend.update( volume, nbSubsets/(float)nbProjection ); 
   }      
 }
 
@@ -518,8 +621,10 @@ void VolumeProjectionSet::osemIteration( Volume& volume, const VolumeProjectionS
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
 
+// the projection is selected with the r texture coordinate given by getLayerCoord()
 void VolumeProjectionSet::loadProjectionAsTexture( unsigned int projectNum ) const {
   
-  glBindTexture( GL_TEXTURE_2D, projections[projectNum].texture ); GL_TEST_ERROR       
+  assert( projectNum < nbProjection );
+  glBindTexture( GL_TEXTURE_3D, projectionsTex ); GL_TEST_ERROR       
 }
 
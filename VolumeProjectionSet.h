@@ -3,20 +3,27 @@
 #define _VOLUMEPROJECTIONSET_H
 
 #include <string>
+#include <vector>
+#include <fstream>
 #include <GL/glew.h>
 #include <GL/glut.h>
 
+#include "THREADutils.h"
+
 namespace GPURec {
 
 class Volume;
+class ReconstructionBackend;
 
+// the texture of a projection is the layer of the same index in the projection set 3D texture
+// the measured projections can keep their uint16 counts instead of float data (data is then 0)
 struct VolumeProjection {
 
-  VolumeProjection() : angle(0.f), texture(0), data(0) {}
+  VolumeProjection() : angle(0.f), data(0), counts(0) {}
   
   float angle;
-  GLuint texture;
   float *data;  
+  unsigned short *counts;
 };
 
 
@@ -37,24 +44,32 @@ public:
 
         // IO methods
         // ------------------------------------------     
-        void createEmpty( unsigned int _dim, unsigned int _nbProjection, float _startAngle = 0.0, float _rotationIncrement = 0.0 );
-        void createFromRAW(  unsigned int _dim, float _pixelSize, unsigned int _nbProjection, float _startAngle, float _rotationIncrement, const std::string& fileName, unsigned int offset = 0 );
+        // with sendToGPU false the projections are only allocated in main memory
+        // with keepCounts (main memory only) the uint16 counts of the file are kept as they are, half the size of
+        // float projections: the kernels convert them where they read them (CPU ratio, texture upload)
+        // with sendToGPU false the line z of the projections is first written by the thread of the slice z in parallelFor( 0, dim, ..., nbThreads, workers )
+        void createEmpty( unsigned int _dim, unsigned int _nbProjection, float _startAngle = 0.0, float _rotationIncrement = 0.0, bool sendToGPU = true,
+                          unsigned int nbThreads = 1, THREADutils::WorkerPool* workers = 0 );
+        void createFromRAW(  unsigned int _dim, float _pixelSize, unsigned int _nbProjection, float _startAngle, float _rotationIncrement, const std::string& fileName, unsigned int offset = 0, bool sendToGPU = true, bool keepCounts = false );
 
         
         //  GRAPHIC MEMORY TRANSFERS
         // ------------------------------------------
-        void sendToGraphicMemory();         // create 2D textures of the projections and load them in graphic memory
-        void retrieveFromGraphicMemory();   // copy back the textures to the data arrays in main memory
+        void sendToGraphicMemory();         // create the 3D texture of the projections and load it in graphic memory
+        void retrieveFromGraphicMemory();   // copy back the texture layers to the data arrays in main memory
+        void attachProjectionToFBO( unsigned int projNum );  // render into the layer of a projection
 
         //  MATHEMATICAL TRANSFORMS
         // ------------------------------------------
-        void backProjection( Volume& volume ) const;
-        void backProjectSlice( unsigned int sliceNum ) const;
+        // GL kernels: the projections firstProjection + i*step are backprojected
+        void backProjection( Volume& volume, unsigned int firstProjection, unsigned int step, bool convolve, float normalizationFactor ) const;
+        void backProjectSlice( unsigned int sliceNum, unsigned int firstProjection, unsigned int step, bool convolve ) const;
+        void divideProjection( const VolumeProjectionSet& scan, unsigned int projNum, GLuint estimatedTex );  // this[projNum] = scan[projNum] / estimatedTex
         
 
         //  RECONSTRUCTION methods
         //
-        void osemIteration( Volume& volume, const VolumeProjectionSet& scan );
+        void osemIteration( ReconstructionBackend& backend, Volume& volume, const VolumeProjectionSet& scan );   // subsets of the context of the backend
           
 
         // GETTERS
@@ -64,7 +79,15 @@ public:
         float           getStartAngle( void ) const { return startAngle; };
         float           getRotationIncrement( void ) const { return rotationIncrement; };
         float           getPixelSize( void ) const { return pixelSize; };
-        GLuint          getTexId( unsigned int projNum ) { return projections[projNum].texture; }
+        double          getCounts( void ) const { return counts; };    // sum of the projections loaded from a file
+        float           getAngle( unsigned int projNum ) const { return projections[projNum].angle; }
+        float*          getData( unsigned int projNum ) { return projections[projNum].data; }
+        const float*    getData( unsigned int projNum ) const { return projections[projNum].data; }
+        bool            hasData( void ) const { return nbProjection > 0 && projections[0].data != 0; }  // projections available in main memory
+        const unsigned short* getCountData( unsigned int projNum ) const { return projections[projNum].counts; }
+        bool            hasCountData( void ) const { return nbProjection > 0 && projections[0].counts != 0; }  // uint16 counts in main memory
+        GLuint          getTexId( void ) const { return projectionsTex; }
+        float           getLayerCoord( unsigned int projNum ) const { return (projNum + 0.5f) / nbProjection; }  // r texture coordinate of a projection
 
 
         //  DEBUG methods
@@ -72,15 +95,25 @@ public:
         void loadProjectionAsTexture( unsigned int projectNum ) const;
         
 private:
+
+  // source of the texels streamed by uploadProjections
+  enum UploadSource { CONSTANT_SOURCE, RAW_FILE_SOURCE, DATA_SOURCE, COUNTS_SOURCE };
+  
+  // create the 3D texture and stream every projection through the pixel-unpack ring
+  // the repacking of projection p+1 on the CPU overlaps the DMA of projection p
+  double uploadProjections( UploadSource source, std::ifstream* file = 0 );
     
+  GLuint projectionsTex;          // 3D texture: one (dim x dim/4) RGBA layer per projection
+
   VolumeProjection *projections;  // array of volume projection for each angle
+  std::vector<float> angles;      // the angles of the projections in one array, read by the GLSL kernels
+  std::vector<int> subsetsDone;   // subsets done by the current OSEM iteration
   unsigned int nbProjection;      // number of projections in the set
   unsigned int dim;               // volume dimensions 
   float startAngle;               // angle of the first projection 
   float rotationIncrement;        // angle between 2 projections
   float pixelSize;                // dimension, in meters, of a pixel
-
-  unsigned int currentSubset;     // store active subset during reconstruction
+  double counts;                  // sum of all the projections read by createFromRAW
 };
 
 
@@ -5,6 +5,8 @@
 #include <GL/glew.h>
 #include <GL/glut.h>
 
+#include <string>
+
 namespace GPURec {
 
 
@@ -22,8 +24,25 @@ const GLenum FILTERING_METHOD = GL_NEAREST;
 
 const float CONVOLUTION_RADIUS_TRUNCATION_FACTOR = 3.5f;
 
+// CPU backend: the planes with a wider PSF (in pixels) are filtered with the recursive gaussian
+const float RECURSIVE_GAUSSIAN_MIN_SIGMA = 2.0f;
+
 const unsigned int START_ANGLE_SHIFT = 90;  // in DEGREES
 
+// number of slots in the pixel-unpack ring used to stream textures to graphic memory
+// while the DMA of one slot is in flight the CPU fills the next one
+const unsigned int NB_UPLOAD_SLOTS = 3;
+
+// hardware running the reconstruction kernels
+enum BackendType { GL_BACKEND, CPU_BACKEND };
+
+// model of the collimator PSF: gaussian convolution of each plane, or frequency-distance relation
+// applied to the projections of a subset (CPU backend only)
+enum PSFModel { GAUSSIAN_PSF, FDR_PSF };
+
+// worker processes of a distributed reconstruction (CPU backend): on one host or over TCP
+enum DistributedMode { NO_DISTRIBUTION, SHARED_MEMORY_DISTRIBUTION, TCP_DISTRIBUTION };
+
 
 // =================== EXTERN PARAMETERS =========================== //
 
@@ -35,8 +54,29 @@ extern float COLLIMATOR_DEPTH;
 
 // RECONSTRUCTION PARAMETERS
 extern bool USE_OSEM3D;
+extern bool USE_GLSL;
 extern unsigned int NB_SUBSETS;
 extern unsigned int NB_ITERATIONS;
+extern bool WARM_START;                       // frames of a multi-scan file start from the previous frame
+extern unsigned int WARM_START_ITERATIONS;    // iterations of these frames
+extern bool WARM_START_SCALING;               // previous frame scaled by the ratio of the counts
+extern BackendType BACKEND;
+extern unsigned int NB_THREADS;     // CPU backend, 0 for one thread per hardware thread
+extern bool PIN_THREADS;            // CPU backend, threads of the kernels pinned to fixed cores
+extern PSFModel PSF_MODEL;
+extern DistributedMode DISTRIBUTED_MODE;
+extern unsigned int NB_WORKERS;
+extern unsigned int WORKER_RANK;            // the GPUREC_WORKER_RANK environment variable overrides it
+extern std::string DISTRIBUTED_ADDRESS;     // shared memory name, or host:port of the worker 0
+extern unsigned int SAMPLING_TABLES_MEMORY;   // CPU backend, in MB, 0 computes the sampling maps on the fly
+extern std::string ATTENUATION_MAP;           // CPU backend, RAW file of the mu map (cm-1), empty (NONE) without attenuation
+extern unsigned int SLAB_SLICES;              // CPU backend, out-of-core volumes processed by slabs, 0 keeps the volume in main memory
+extern unsigned int ATTENUATION_TABLES_MEMORY;   // CPU backend, in MB, 0 computes the attenuation factors on the fly
+extern unsigned int BATCH_MEMORY;     // batch mode, in MB, sum of the footprints of the running jobs
+extern unsigned int BATCH_MAX_JOBS;   // batch mode, 0 for one job per hardware thread
+extern bool KEEP_RAW_COUNTS;          // scans of the CPU backend read without display keep their uint16 counts in main memory
+extern bool STAGING_HUGE_PAGES;       // large staging buffers of the transfers in transparent huge pages
+extern int NOISE_SEED;                // simulated scans: seed of the Poisson noise, -1 without noise
 
 
 } // end namespace GPURec
@@ -5,13 +5,16 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <vector>
 #include <cctype>
 #define _USE_MATH_DEFINES
 #include <cmath>
 
 #include "HdrFile.h"
+#include "HdrProjectionWriter.h"
 #include "Volume.h"
 #include "VolumeProjectionSet.h"
+#include "ReconstructionContext.h"
 
 using namespace GPURec;
 
@@ -75,7 +78,7 @@ HdrFile::HdrFile( const std::string& fileName ) {
 }
 
 
-void HdrFile::loadVolumeProjectionSet( VolumeProjectionSet& projectionSet, unsigned int num ) const {
+void HdrFile::loadVolumeProjectionSet( VolumeProjectionSet& projectionSet, unsigned int num, bool sendToGPU, bool keepCounts ) const {
 
   unsigned int nbProjections = (unsigned int)getNumericValue("numberofprojections");
   unsigned int dim = (unsigned int)getNumericValue("matrixsize[1]");
@@ -95,11 +98,13 @@ void HdrFile::loadVolumeProjectionSet( VolumeProjectionSet& projectionSet, unsig
                                 (getNumericValue("startangle") + START_ANGLE_SHIFT) * M_PI / 180.0f,
                                 rotationIncrement,
                                 path + getStringValue("nameofdatafile"), 
-                                num * nbProjections * dim * dim * sizeof(unsigned short) );  
+                                num * nbProjections * dim * dim * sizeof(unsigned short),
+                                sendToGPU,
+                                keepCounts );  
 }
 
 
-void HdrFile::saveVolume( std::string fileName, const Volume& volume, unsigned int num ) const {  
+void HdrFile::saveVolume( std::string fileName, const Volume& volume, const ReconstructionContext& context, unsigned int num ) const {  
 
   // construct RAW filename
   std::string rawFileName = "";
@@ -129,15 +134,15 @@ void HdrFile::saveVolume( std::string fileName, const Volume& volume, unsigned i
   // create a study ID string containing the reconstruction algorithm used
   std::stringstream studyId;
   studyId << "OSEM";
-  if( USE_OSEM3D )
+  if( context.useOSEM3D )
     studyId << "3D";
-  studyId << "-GPU(" << NB_ITERATIONS << "it," << NB_SUBSETS << "sub)";
+  studyId << "-GPU(" << context.nbIterations << "it," << context.nbSubsets << "sub)";
   
   // create a string with reconstruction parameters
   std::stringstream recParameters;
-  recParameters <<  "CAMERA_ROTATION_RADIUS(" << CAMERA_ROTATION_RADIUS <<  "), CAMERA_RESOLUTION(" << CAMERA_RESOLUTION <<
-                    "), COLLIMATOR_HOLES_DIAMETER(" << COLLIMATOR_HOLES_DIAMETER <<
-                    "), COLLIMATOR_DEPTH(" << COLLIMATOR_DEPTH << ")";
+  recParameters <<  "CAMERA_ROTATION_RADIUS(" << context.cameraRotationRadius <<  "), CAMERA_RESOLUTION(" << context.cameraResolution <<
+                    "), COLLIMATOR_HOLES_DIAMETER(" << context.collimatorHolesDiameter <<
+                    "), COLLIMATOR_DEPTH(" << context.collimatorDepth << ")";
 
   // get system time
   time_t currentTime;
@@ -203,20 +208,35 @@ void HdrFile::saveVolume( std::string fileName, const Volume& volume, unsigned i
 }
 
 
+// the projections are streamed from main memory, the patient keys are the ones of this file
 void HdrFile::saveVolumeProjectionSet( std::string fileName, const VolumeProjectionSet& projSet, unsigned int num ) const {
 
-  // construct RAW filename
-  std::string rawFileName = "";
-    // remove the file extension if any
-  if( fileName.find(".") != std::string::npos )
-    rawFileName = fileName.substr(0, fileName.rfind("."));
-  else
-    rawFileName = fileName;
-  rawFileName += ".raw";  
-    
-//   volume.saveToRAW( rawFileName, (num > 0) );  
-
+  if( !projSet.hasData() && !projSet.hasCountData() ) {
+    std::cerr << "error saving " << fileName << ": the projections are not in main memory" << std::endl;
+    throw std::exception();
+  }
 
+  HdrProjectionWriter writer( fileName, projSet.getDim(), projSet.getPixelSize(), projSet.getNbProjection(),
+                              projSet.getStartAngle(), projSet.getRotationIncrement(), num );
+  writer.addKey( "!imaging modality", getStringValue("imagingmodality") );
+  writer.addKey( "!originating system", getStringValue("originatingsystem") );
+  writer.addKey( "patient name", getStringValue("patientname") );
+  writer.addKey( "!patient ID", getStringValue("patientid") );
+  writer.addKey( "patient dob", getStringValue("patientdob") );
+  writer.addKey( "patient sex", getStringValue("patientsex") );
+  
+  // uint16 counts: converted one projection at a time
+  std::vector<float> buffer( projSet.hasData() ? 0 : projSet.getDim() * projSet.getDim() );
+  for( unsigned int p = 0; p < projSet.getNbProjection(); p++ ) {
+  
+    if( projSet.hasData() ) {
+      writer.writeProjection( projSet.getData(p) );
+      continue;
+    }
+    std::copy( projSet.getCountData(p), projSet.getCountData(p) + buffer.size(), buffer.begin() );
+    writer.writeProjection( &buffer[0] );
+  }
+  writer.close();
 }
 
 
@@ -18,12 +18,15 @@ public:
   // load the HDR file and fill the map with the key-value pairs
   HdrFile( const std::string& _fileName );
   
-  void              loadVolumeProjectionSet( VolumeProjectionSet& projectionSet, unsigned int num = 0 ) const;
-  void              saveVolume( std::string fileName, const Volume& volume, unsigned int num = 0 ) const;
+  void              loadVolumeProjectionSet( VolumeProjectionSet& projectionSet, unsigned int num = 0, bool sendToGPU = true, bool keepCounts = false ) const;
+  void              saveVolume( std::string fileName, const Volume& volume, const ReconstructionContext& context, unsigned int num = 0 ) const;
   void              saveVolumeProjectionSet( std::string fileName, const VolumeProjectionSet& projSet, unsigned int num = 0 ) const;
   void              checkGPURecCompatibility() const;
    
   unsigned int      getNbScans() const { return (unsigned int)(getNumericValue("totalnumberofimages")/getNumericValue("numberofprojections")); }
+  unsigned int      getDim() const { return (unsigned int)getNumericValue("matrixsize[1]"); }
+  unsigned int      getNbProjections() const { return (unsigned int)getNumericValue("numberofprojections"); }
+  float             getPixelSize() const { return getNumericValue("scalingfactor(mm/pixel)[1]") / 1000.f; }   // METER unit
  
    
 private:  
@@ -0,0 +1,187 @@
+
+#include "common.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <ctime>
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "HdrProjectionWriter.h"
+
+using namespace GPURec;
+
+// projections converted before a write to the RAW file
+static const size_t CHUNK_BYTES = 4 * 1024 * 1024;
+
+
+HdrProjectionWriter::HdrProjectionWriter( const std::string& _fileName, unsigned int _dim, float _pixelSize, unsigned int _nbProjections,
+                                          float _startAngle, float _rotationIncrement, unsigned int _scanNum ) :
+  fileName( _fileName ), dim( _dim ), pixelSize( _pixelSize ), nbProjections( _nbProjections ),
+  startAngle( _startAngle ), rotationIncrement( _rotationIncrement ), scanNum( _scanNum ),
+  nbBuffered(0), nbWritten(0), nbClampedValues(0), closed(false) {
+
+  // construct RAW filename: remove the file extension if any
+  if( fileName.find(".") != std::string::npos )
+    rawFileName = fileName.substr(0, fileName.rfind("."));
+  else
+    rawFileName = fileName;
+  rawFileName += ".raw";
+
+  if( scanNum > 0 )
+    rawFile.open( rawFileName.c_str(), std::ios::app | std::ios::binary );
+  else
+    rawFile.open( rawFileName.c_str(), std::ios::out | std::ios::binary );
+
+  if( !rawFile ) {
+    std::cerr << "error creating file " << rawFileName << std::endl;
+    throw std::exception();
+  }
+
+  chunkProjections = std::max( (size_t)1, CHUNK_BYTES / (dim * dim * sizeof(unsigned short)) );
+  chunkProjections = std::min( chunkProjections, nbProjections );
+  chunk.resize( chunkProjections * dim * dim );
+}
+
+
+HdrProjectionWriter::~HdrProjectionWriter() {
+
+  // an unfinished set keeps its RAW data but gets no header
+  if( !closed && rawFile.is_open() ) {
+    std::cerr << "Warning: " << fileName << " closed after " << nbWritten + nbBuffered << " of " << nbProjections << " projections" << std::endl;
+    rawFile.close();
+  }
+}
+
+
+void HdrProjectionWriter::addKey( const std::string& key, const std::string& value ) {
+
+  keys.push_back( std::make_pair( key, value ) );
+}
+
+
+void HdrProjectionWriter::writeProjection( const float* data ) {
+
+  if( nbWritten + nbBuffered == nbProjections ) {
+    std::cerr << "error writing " << fileName << ": more than " << nbProjections << " projections" << std::endl;
+    throw std::exception();
+  }
+
+  // RAW lines are stored from top to bottom
+  unsigned short* raw = &chunk[ nbBuffered * dim * dim ];
+  for( unsigned int j = 0; j < dim; j++ )
+  for( unsigned int i = 0; i < dim; i++ ) {
+
+    float value = floorf( data[ i + (dim-1-j)*dim ] + 0.5f );
+    if( !( value >= 0.0f ) || value > 65535.0f ) {
+      nbClampedValues++;
+      value = ( value > 65535.0f ) ? 65535.0f : 0.0f;
+    }
+    raw[ i + j*dim ] = (unsigned short)value;
+  }
+
+  if( ++nbBuffered == chunkProjections )
+    writeChunk();
+}
+
+
+void HdrProjectionWriter::writeChunk( void ) {
+
+  rawFile.write( (const char*)&chunk[0], nbBuffered * dim * dim * sizeof(unsigned short) );
+  if( !rawFile ) {
+    std::cerr << "error writing file " << rawFileName << std::endl;
+    throw std::exception();
+  }
+
+  nbWritten += nbBuffered;
+  nbBuffered = 0;
+}
+
+
+void HdrProjectionWriter::close( void ) {
+
+  if( closed ) return;
+
+  if( nbBuffered > 0 ) writeChunk();
+  if( nbWritten != nbProjections ) {
+    std::cerr << "error writing " << fileName << ": " << nbWritten << " of " << nbProjections << " projections" << std::endl;
+    throw std::exception();
+  }
+
+  rawFile.close();
+  writeHeader();
+  closed = true;
+
+  if( nbClampedValues > 0 )
+    std::cerr << "Warning: " << nbClampedValues << " values outside [0, 65535] clamped in " << rawFileName << std::endl;
+}
+
+
+void HdrProjectionWriter::writeHeader( void ) const {
+
+  // remove path from RAW filename before writing it in HDR
+  std::string rawName = rawFileName;
+  if( rawName.find("/") != std::string::npos )
+    rawName = rawName.substr( rawName.rfind("/") +1 );
+  else if( rawName.find("\\") != std::string::npos )
+    rawName = rawName.substr( rawName.rfind("\\") +1 );
+
+  std::ofstream hdrFile( fileName.c_str(), std::ios::out );
+
+  if( !hdrFile ) {
+    std::cerr << "error creating file " << fileName << std::endl;
+    throw std::exception();
+  }
+
+  // HdrFile::loadVolumeProjectionSet adds START_ANGLE_SHIFT to the start angle
+  float startAngleDegrees = startAngle * 180.0f / M_PI - START_ANGLE_SHIFT;
+  float extentDegrees = fabs( rotationIncrement ) * nbProjections * 180.0f / M_PI;
+  float pixelSizeMm = pixelSize * 1000.0f;
+
+  std::stringstream generalKeys;
+  for( unsigned int k = 0; k < keys.size(); k++ )
+    generalKeys << keys[k].first << " := " << keys[k].second << "\n";
+
+  // get system time
+  time_t currentTime;
+  time( &currentTime );
+
+  // create HDR file
+  hdrFile <<
+  "!INTERFILE :=\n"
+  "!version of keys := 3.3\n"
+  "conversion program := GPURec\n"
+  "program date := " << GPUREC_PROGRAM_DATE << "\n"
+  "program version := " << GPUREC_PROGRAM_VERSION << "\n"
+  ";\n"
+  "!GENERAL DATA :=\n"
+  "!data starting block := 0\n"
+  "!name of data file := " << rawName << "\n" <<
+  generalKeys.str() <<
+  "data compression := none\n"
+  "data encode := none\n"
+  ";\n"
+  "!GENERAL IMAGE DATA :=\n"
+  "!type of data := tomographic\n"
+  "!total number of images := " << nbProjections * (scanNum+1) << "\n"
+  "imagedata byte order := LITTLEENDIAN\n"
+  "number of energy windows := 1\n"
+  ";\n"
+  "!SPECT STUDY (general) :=\n"
+  "number of images/energy window := " << nbProjections * (scanNum+1) << "\n"
+  "!process status := acquired\n"
+  "!number of projections := " << nbProjections << "\n"
+  "!matrix size [1] := " << dim << "\n"
+  "!matrix size [2] := " << dim << "\n"
+  "!number format := unsigned integer\n"
+  "!number of bytes per pixel := 2\n"
+  "scaling factor (mm/pixel) [1] := " << pixelSizeMm << "\n"
+  "scaling factor (mm/pixel) [2] := " << pixelSizeMm << "\n"
+  "!extent of rotation := " << extentDegrees << "\n"
+  "direction of rotation := " << ( rotationIncrement >= 0.0f ? "CCW" : "CW" ) << "\n"
+  "start angle := " << startAngleDegrees << "\n"
+  "acquisition date := " << ctime( &currentTime ) <<
+  "!END OF INTERFILE :=\n";
+  hdrFile.close();
+}
@@ -0,0 +1,67 @@
+#ifndef _HDRPROJECTIONWRITER_H
+#define _HDRPROJECTIONWRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+
+namespace GPURec {
+
+
+// Interfile writer of a projection set: the projections are converted to 2 bytes unsigned integers
+// and appended to the RAW file by chunks while they are produced, so a set never has to fit in memory.
+// The header is written by close(): a set interrupted before the end has no header.
+// The files are read back by HdrFile::loadVolumeProjectionSet.
+class HdrProjectionWriter {
+
+public:
+
+  // angles in RADIAN, pixelSize in METER
+  // scanNum > 0 appends a scan to the RAW file of the scans 0..scanNum-1, the header then describes all of them
+  HdrProjectionWriter( const std::string& _fileName, unsigned int _dim, float _pixelSize, unsigned int _nbProjections,
+                       float _startAngle, float _rotationIncrement, unsigned int _scanNum = 0 );
+  ~HdrProjectionWriter();
+
+  // additional header line (patient, modality, ...) written in the general data section
+  void addKey( const std::string& key, const std::string& value );
+
+  // next projection of the set: dim x dim values, lines from bottom to top (VolumeProjectionSet layout)
+  // the values are rounded and clamped to [0, 65535]
+  void writeProjection( const float* data );
+
+  // write the last chunk and the header, all the projections have to be written
+  void close( void );
+
+  unsigned int getNbClampedValues( void ) const { return nbClampedValues; }
+
+protected:
+
+  void writeChunk( void );
+  void writeHeader( void ) const;
+
+  std::string fileName;
+  std::string rawFileName;
+  std::ofstream rawFile;
+
+  unsigned int dim;
+  float pixelSize;
+  unsigned int nbProjections;
+  float startAngle;
+  float rotationIncrement;
+  unsigned int scanNum;
+
+  std::vector<unsigned short> chunk;       // converted projections waiting to be written
+  unsigned int chunkProjections;           // projections per chunk
+  unsigned int nbBuffered;
+  unsigned int nbWritten;
+  unsigned int nbClampedValues;
+
+  std::vector< std::pair<std::string, std::string> > keys;
+  bool closed;
+};
+
+
+} // end namespace GPURec
+
+#endif  // _HDRPROJECTIONWRITER_H
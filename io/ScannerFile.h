@@ -6,13 +6,15 @@ namespace GPURec {
 
 class Volume;
 class VolumeProjectionSet;
+struct ReconstructionContext;
 
 class ScannerFile {
 
 public: 
 
-  virtual void    loadVolumeProjectionSet ( VolumeProjectionSet& projectionSet, unsigned int num = 0 ) const = 0;
-  virtual void    saveVolume              ( std::string fileName, const Volume& volume, unsigned int num = 0 ) const = 0;
+  virtual void    loadVolumeProjectionSet ( VolumeProjectionSet& projectionSet, unsigned int num = 0, bool sendToGPU = true, bool keepCounts = false ) const = 0;
+  // the parameters of the reconstruction are written in the header
+  virtual void    saveVolume              ( std::string fileName, const Volume& volume, const ReconstructionContext& context, unsigned int num = 0 ) const = 0;
   virtual void    saveVolumeProjectionSet ( std::string fileName, const VolumeProjectionSet& projSet, unsigned int num = 0 ) const = 0; 
   virtual void    checkGPURecCompatibility() const = 0;
 };
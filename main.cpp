@@ -7,6 +7,7 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <cstdlib>
 #define _USE_MATH_DEFINES
 #include <cmath>
 
@@ -15,10 +16,20 @@
 
 #include "Volume.h"
 #include "Phantom.h"
+#include "AnalyticPhantom.h"
+#include "PoissonNoise.h"
 #include "VolumeProjectionSet.h"
 #include "HdrFile.h"
 #include "GPURecOpenGL.h"
 #include "GPUGaussianConv.h"
+#include "Configuration.h"
+#include "GPURecGLSL.h"
+#include "ReconstructionBackend.h"
+#include "ReconstructionDaemon.h"
+#include "ReconstructionScheduler.h"
+#include "CPUBackend.h"
+#include "THREADutils.h"
+#include "MEMutils.h"
 
 using namespace GPURec;
 
@@ -31,6 +42,9 @@ Volume downSampledVolume;
 
 VolumeProjectionSet scan;
 
+ReconstructionBackend* theBackend = 0;
+std::string theConfigFile;
+
 
 float maxVal = 0.9f;
 
@@ -107,6 +121,9 @@ void gestionClavierNormal (unsigned char key, int x, int y)
         
         GPURecOpenGL::terminate();
         GPUGaussianConv::terminate();
+        if( USE_GLSL ) GPURecGLSL::terminate();
+        delete theBackend;
+        theBackend = 0;
         
         // create a log file
         std::ofstream logFile( "perf.log" );     
@@ -154,6 +171,8 @@ void Draw()
     /*if( !onePlane && pleinplan ) normFact = projNumber/(float)(10*PHANTOM_SIZE);
     if( onePlane ) normFact = 1.0;   */
     
+    phantom.setDebugPlanes( onePlane, thePlaneNum, pleinplan );
+    volume.setDebugPlanes( onePlane, thePlaneNum, pleinplan );
     if( volOrigin )
      phantom.projection( viewAngle, false );
     else
@@ -202,98 +221,280 @@ void idle (void)
 
 namespace GPURec {
 
-bool USE_OSEM3D = true;
-float CAMERA_ROTATION_RADIUS;
-float CAMERA_RESOLUTION;
-float COLLIMATOR_HOLES_DIAMETER;
-float COLLIMATOR_DEPTH;
-unsigned int NB_SUBSETS = 10;
-unsigned int NB_ITERATIONS = 3;
 std::string programPath = "";
 
 } // end of namespace GPURec
 
 
-void loadConfigFile( const char* fileName ) {
+// without display (batch and daemon jobs) the reconstruction stays in main memory
+// with warmStart the reconstruction starts from the volume given (in main memory) instead of a uniform one
+void reconstruction( VolumeProjectionSet& scan, Volume& reconstructedVolume, bool display = true, bool warmStart = false ) {
+ 
+#ifdef GPUREC_COUNT_ALLOCATIONS
+   // the staging buffers are pooled: after the first scan of a size, a reconstruction allocates none
+   unsigned long reconstructionAllocations = MEMutils::getNbAllocations();
+#endif
+
+   theBackend->reset( scan.getDim(), scan.getPixelSize() );
+   const ReconstructionContext& context = theBackend->getContext();
+ 
+   if( reconstructedVolume.getDim() != scan.getDim() ) warmStart = false;
+   if( !warmStart )
+     reconstructedVolume.createEmpty( scan.getDim(), false, context.nbThreads, theBackend->getWorkers() ); 
+   theBackend->uploadVolume( reconstructedVolume );
+   
+   VolumeProjectionSet theProjectionSet;
+   theProjectionSet.createEmpty( scan.getDim(), scan.getNbProjection(), scan.getStartAngle(), scan.getRotationIncrement(), false, context.nbThreads,
+                                 theBackend->getWorkers() );  
+   theBackend->uploadProjections( theProjectionSet );
+   theBackend->uploadProjections( scan );
+  
+   unsigned int nbIterations = warmStart ? context.warmStartIterations : context.nbIterations;
+   for( unsigned int i = 0; i < nbIterations; i++ ) {                                                               
+#ifdef GPUREC_COUNT_ALLOCATIONS
+     // the kernels keep their buffers: after the first iteration an iteration allocates nothing
+     unsigned long iterationAllocations = MEMutils::getNbAllocations();
+     theProjectionSet.osemIteration( *theBackend, reconstructedVolume, scan );
+     iterationAllocations = MEMutils::getNbAllocations() - iterationAllocations;
+     std::cout << "Iteration " << i+1 << ": " << iterationAllocations << " heap allocations" << std::endl;
+     if( i > 0 && iterationAllocations > 0 ) {
+       std::cerr << "Iteration " << i+1 << " allocated " << iterationAllocations << " heap blocks, the kernels should reuse their buffers" << std::endl;
+       throw std::exception();
+     }
+#else
+     theProjectionSet.osemIteration( *theBackend, reconstructedVolume, scan );
+#endif
+   }  
+         
+   theBackend->downloadVolume( reconstructedVolume );
+   std::cout << "Volume maximum value: " << reconstructedVolume.getMaxValue() << std::endl;
+   
+   // the display always draws the volume texture
+   if( display && !reconstructedVolume.getVolumeTex() )
+     reconstructedVolume.sendToGraphicMemory();
+
+#ifdef GPUREC_COUNT_ALLOCATIONS
+   std::cout << "Heap allocations of the reconstruction: " << MEMutils::getNbAllocations() - reconstructionAllocations << std::endl;
+#endif
+} 
+
+// all the scans (frames) of the file, saved in the same output file
+// with warm start the frames after the first one start from the previous frame, scaled by the ratio of their counts
+void reconstructFrames( const HdrFile& hdrFile, const std::string& outputFile, bool display = true ) {
+
+  const ReconstructionContext& context = theBackend->getContext();
+  double previousCounts = 0.0;
+  
+  // the display and the GL kernels read the scan texture, the CPU kernels the projections in main memory
+  bool sendToGPU = display || context.backend != CPU_BACKEND;
+
+  // out-of-core (CPU backend with slabs): the volume is a file next to the output while it is reconstructed
+  volume.setMappedFile( ( context.backend == CPU_BACKEND && context.slabSlices ) ? outputFile + ".volume" : "" );
+
+  for( unsigned int s = 0; s < hdrFile.getNbScans(); s++ ) {
+  
+    std::cout << "Scan: " << s+1 << std::endl;
+    hdrFile.loadVolumeProjectionSet( scan, s, sendToGPU, !sendToGPU && context.keepRawCounts );
+    
+    bool warmStart = context.warmStart && s > 0 && previousCounts > 0.0;
+    if( warmStart && context.warmStartScaling )
+      volume.scale( (float)( scan.getCounts() / previousCounts ) );
+      
+    reconstruction( scan, volume, display, warmStart );
+    hdrFile.saveVolume( outputFile, volume, context, s );
+    previousCounts = scan.getCounts();
+  }
+}
+
 
-  std::ifstream file( fileName, std::ios::in );
+// if no path is specified take the program path
+// DEFAULT OUTPUT FILE: add "_rec" to input file
+std::string getOutputFile( const std::string& inputHdrFile, const std::string& outputArgument ) {
+
+  std::string outputFile;
+  if( !outputArgument.empty() ) {
+  
+    if( outputArgument.find("/") != std::string::npos || outputArgument.find("\\") != std::string::npos )
+      outputFile = outputArgument;
+    else
+      outputFile = programPath + outputArgument;
+  }
+  else  {
+  
+    std::string extension = "";
+    if( inputHdrFile.find(".") != std::string::npos ) {
+      extension = inputHdrFile.substr( inputHdrFile.rfind(".") );
+      outputFile = inputHdrFile.substr( 0, inputHdrFile.rfind(".") );
+    }
+    else
+      outputFile = inputHdrFile;
       
-  if( !file ) {
-    std::cerr << "Initialization: error opening file " << fileName << std::endl;
+    // remove path from input filename if any
+    if( outputFile.find("/") != std::string::npos )
+      outputFile = outputFile.substr( outputFile.rfind("/") +1 );
+    else if( outputFile.find("\\") != std::string::npos )
+      outputFile = outputFile.substr( outputFile.rfind("\\") +1 );
+      
+    outputFile = programPath + outputFile + "_rec" + extension;
+  }
+  
+  return outputFile;
+}
+
+
+// job of the daemon mode: the config file is read again, then the parameters of the job override it
+// the backend is only created again when the job asks for another one, otherwise it keeps its state
+// and takes the parameters of the job
+void runJob( const std::vector<std::string>& arguments ) {
+
+  loadConfigFile( theConfigFile.c_str() );
+  
+  std::string outputArgument = "";
+  for( unsigned int i = 1; i < arguments.size(); i++ ) {
+    if( arguments[i].find("=") != std::string::npos )
+      parseConfigLine( arguments[i] );
+    else
+      outputArgument = arguments[i];
+  }
+  std::string outputFile = getOutputFile( arguments[0], outputArgument );
+  
+  ReconstructionContext context;
+  if( theBackend->getContext().backend != context.backend ) {
+  
+    // the staging buffers of the previous backend are freed with it
+    delete theBackend;
+    theBackend = 0;
+    MEMutils::clear();
+    theBackend = ReconstructionBackend::create( context );
+  }
+  else
+    theBackend->setContext( context );
+  
+  HdrFile hdrFile( arguments[0] );
+  reconstructFrames( hdrFile, outputFile, false );
+}
+
+
+// job of the batch mode, run in a child process without GL context: the projections are only
+// loaded in main memory and reconstructed by the CPU backend
+void runBatchJob( const std::vector<std::string>& arguments ) {
+
+  std::string outputArgument = "";
+  for( unsigned int i = 1; i < arguments.size(); i++ ) {
+    if( arguments[i].find("=") != std::string::npos )
+      parseConfigLine( arguments[i] );
+    else
+      outputArgument = arguments[i];
+  }
+  std::string outputFile = getOutputFile( arguments[0], outputArgument );
+  
+  theBackend = ReconstructionBackend::create( ReconstructionContext() );
+  
+  HdrFile hdrFile( arguments[0] );
+  reconstructFrames( hdrFile, outputFile, false );
+  
+  delete theBackend;
+  theBackend = 0;
+}
+
+
+// configuration shared by the jobs of the batch: the config file, the cores divided between the jobs
+void loadBatchConfiguration( unsigned int maxJobs ) {
+
+  loadConfigFile( theConfigFile.c_str() );
+  if( NB_THREADS == 0 )
+    NB_THREADS = std::max( 1u, THREADutils::getNbHardwareThreads() / maxJobs );
+  PIN_THREADS = false;    // the jobs would share the same cores
+}
+
+
+// footprint of a job: the volume, the scan, the ratios and the allocations of the CPU backend,
+// with the parameters of the job (the configuration of the batch and the overrides of the job line)
+size_t getJobFootprint( const HdrFile& hdrFile, const ReconstructionContext& context ) {
+
+  if( context.backend != CPU_BACKEND || context.distributedMode != NO_DISTRIBUTION ) {
+    std::cerr << "Scheduler: the jobs require the CPU backend without distribution" << std::endl;
     throw std::exception();
   }
- 
+
+  size_t planeSize = (size_t)hdrFile.getDim() * hdrFile.getDim();
+  size_t scanSize = planeSize * hdrFile.getNbProjections() * ( context.keepRawCounts ? sizeof(unsigned short) : sizeof(float) );
+  size_t volumeSlices = context.slabSlices ? std::min( context.slabSlices, hdrFile.getDim() ) : hdrFile.getDim();
+  return ( planeSize * volumeSlices + planeSize * hdrFile.getNbProjections() ) * sizeof(float) + scanSize
+         + CPUBackend::estimateMemory( hdrFile.getDim(), hdrFile.getPixelSize(), hdrFile.getNbProjections(), context );
+}
+
+
+// BATCH MODE: one job per line of the file, 'inputHdrFile [outputFile] [PARAMETER=value ...]'
+// the overrides of a job are applied to the configuration to estimate its footprint, then the
+// configuration of the batch is loaded again: the job processes apply their own overrides
+int runBatch( const std::string& jobFileName ) {
+
+  if( BACKEND != CPU_BACKEND || DISTRIBUTED_MODE != NO_DISTRIBUTION ) {
+    std::cerr << "The batch mode requires the CPU backend without distribution" << std::endl;
+    return 4;
+  }
+  
+  unsigned int maxJobs = BATCH_MAX_JOBS ? BATCH_MAX_JOBS : THREADutils::getNbHardwareThreads();
+  loadBatchConfiguration( maxJobs );
+  
+  std::ifstream jobFile( jobFileName.c_str() );
+  if( !jobFile ) {
+    std::cerr << "error opening job file " << jobFileName << std::endl;
+    return 4;
+  }
+  
+  ReconstructionScheduler scheduler( (size_t)BATCH_MEMORY * 1024 * 1024, maxJobs );
+  unsigned int nbFailed = 0;
   std::string ln;
-  while( file.good() )
-  {
-    // read the next line
-    std::getline( file, ln );
-    
-    // separate parameter name and value    
-    std::string paramName = ln.substr( 0, ln.find("=") );    
-      // remove blanks
-    paramName.erase( std::remove(paramName.begin(), paramName.end(), ' '), paramName.end() );
-   
-    // retrieve the value if any
-    std::stringstream paramValue("undefined");
-    if( ln.size() > (ln.find("=") +1) )  {
-      paramValue.str( ln.substr( ln.find("=")+1 ) );
-    }
+  while( std::getline( jobFile, ln ) ) {
+  
+    std::vector<std::string> arguments;
+    std::stringstream words( ln );
+    std::string word;
+    while( words >> word ) arguments.push_back( word );
+    if( arguments.empty() || arguments[0][0] == '#' ) continue;
     
-    if( paramName == ("USE_OSEM3D") )
-    {       
-      paramValue >> USE_OSEM3D;
-    }
-    else if( paramName == ("NB_SUBSETS") )
-    {       
-      paramValue >> NB_SUBSETS;
-    }
-    else if( paramName == ("NB_ITERATIONS") )
-    {       
-      paramValue >> NB_ITERATIONS;
-    }
-    else if( paramName == ("CAMERA_ROTATION_RADIUS") )
-    {
-      paramValue >> CAMERA_ROTATION_RADIUS;
-    }
-    else if( paramName == ("CAMERA_RESOLUTION") )
-    {
-      paramValue >> CAMERA_RESOLUTION;
-    }
-    else if( paramName == ("COLLIMATOR_HOLES_DIAMETER") )
-    {            
-      paramValue >> COLLIMATOR_HOLES_DIAMETER;
+    try {
+      HdrFile hdrFile( arguments[0] );
+      for( unsigned int i = 1; i < arguments.size(); i++ )
+        if( arguments[i].find("=") != std::string::npos )
+          parseConfigLine( arguments[i] );
+      ReconstructionContext context;
+      loadBatchConfiguration( maxJobs );
+      
+      scheduler.addJob( arguments, getJobFootprint( hdrFile, context ) );
     }
-    else if( paramName == ("COLLIMATOR_DEPTH") )
-    {
-      paramValue >> COLLIMATOR_DEPTH;
+    catch( std::exception& ) {
+      loadBatchConfiguration( maxJobs );
+      std::cerr << "Scheduler: job skipped: " << ln << std::endl;
+      nbFailed++;
     }
   }
   
-  file.close();
+  nbFailed += scheduler.run( runBatchJob );
+  std::cout << "Scheduler: " << nbFailed << " failed job(s)" << std::endl;
+  
+  return nbFailed ? 4 : 0;
 }
 
 
-void reconstruction( const VolumeProjectionSet& scan, Volume& reconstructedVolume ) {
- 
-   GPURecOpenGL::reset( scan.getDim() );
-   GPUGaussianConv::reset( scan.getDim(), scan.getPixelSize() );       
- 
-   reconstructedVolume.createEmpty( scan.getDim() ); 
-   
-   VolumeProjectionSet theProjectionSet;
-   theProjectionSet.createEmpty( scan.getDim(), scan.getNbProjection(), scan.getStartAngle(), scan.getRotationIncrement() );  
+// PHANTOM MODE: projections of the 3D Shepp-Logan phantom computed analytically, without GL
+// the field of view is the one of the default phantom, 100 counts per unit of density and voxel length
+int createPhantomFile( const std::string& hdrFileName, unsigned int dim, unsigned int nbProjections ) {
+
+  AnalyticPhantom sheppLogan;
+  sheppLogan.createSheppLogan();
   
-   for( unsigned int i = 0; i < NB_ITERATIONS; i++ ) {                                                               
-     theProjectionSet.osemIteration( reconstructedVolume, scan );
-   }  
-   
-//    scan.backProjection( reconstructedVolume );
-         
-   reconstructedVolume.retrieveFromGraphicMemory();      
-   std::cout << "Volume maximum value: " << reconstructedVolume.getMaxValue() << std::endl;
+  DBGutils::Timer timer;
+  timer.start();
+  sheppLogan.saveProjections( hdrFileName, dim, nbProjections, DEFAULT_PIXEL_SIZE * PHANTOM_SIZE / dim, 100.0f, NB_THREADS, NOISE_SEED );
+  timer.stop();
+  
+  std::cout << "Phantom: " << nbProjections << " projections of " << dim << "x" << dim << " in " << timer.sum << " s" << std::endl;
+  return 0;
 }
- 
+
 
 int main( int argc, char *argv[ ], char *envp[ ] )
 {
@@ -306,45 +507,50 @@ int main( int argc, char *argv[ ], char *envp[ ] )
               
         std::cout << std::endl << "Usage: GPURec inputHdrFile [outputFile]" << std::endl;
         std::cout << "'inputHdrFile' is the interfile containing the scan to reconstruct." << std::endl;
-        std::cout << "'outputFile' is the destination file to store the reconstructed volume." << std::endl << std::endl;
+        std::cout << "'outputFile' is the destination file to store the reconstructed volume." << std::endl;
+        std::cout << "       GPURec --daemon socketFile" << std::endl;
+        std::cout << "runs the jobs 'inputHdrFile [outputFile] [PARAMETER=value ...]' sent to the Unix socket." << std::endl;
+        std::cout << "       GPURec --batch jobFile" << std::endl;
+        std::cout << "runs concurrently the jobs listed in the file, one per line, with the CPU backend." << std::endl;
+        std::cout << "       GPURec --phantom outputHdrFile [dim] [nbProjections]" << std::endl;
+        std::cout << "saves the projections of the 3D Shepp-Logan phantom." << std::endl << std::endl;
         return 4;
       }
           
       // extract program path to search for the config file in the same directory
       programPath = argv[0];
       programPath = programPath.substr( 0, programPath.rfind("\\") +1 );
-      std::string configFile = programPath + DEFAULT_CONFIG_FILENAME;
-      loadConfigFile( configFile.c_str() );
+      theConfigFile = programPath + DEFAULT_CONFIG_FILENAME;
+      loadConfigFile( theConfigFile.c_str() );
 
-      std::string inputHdrFile( argv[1] );
-      std::string outputFile;
-      if( argc > 2 ) {
+      bool daemonMode = ( std::string( argv[1] ) == "--daemon" );
+      if( daemonMode && argc < 3 ) {
+        std::cout << "Usage: GPURec --daemon socketFile" << std::endl;
+        return 4;
+      }
       
-        // if no path is specified take the program path
-        if( outputFile.find("/") != std::string::npos || outputFile.find("\\") != std::string::npos )
-          outputFile = argv[2];
-        else
-          outputFile = programPath + argv[2];
+      // BATCH MODE: no GL context, the jobs run in child processes
+      if( std::string( argv[1] ) == "--batch" ) {
+        if( argc < 3 ) {
+          std::cout << "Usage: GPURec --batch jobFile" << std::endl;
+          return 4;
+        }
+        return runBatch( argv[2] );
       }
-      else  {
       
-        // DEFAULT OUTPUT FILE: add "_rec" to input file
-        std::string extension = "";
-        if( inputHdrFile.find(".") != std::string::npos ) {
-          extension = inputHdrFile.substr( inputHdrFile.rfind(".") );
-          outputFile = inputHdrFile.substr( 0, inputHdrFile.rfind(".") );
+      // PHANTOM MODE: no GL context either
+      if( std::string( argv[1] ) == "--phantom" ) {
+        if( argc < 3 ) {
+          std::cout << "Usage: GPURec --phantom outputHdrFile [dim] [nbProjections]" << std::endl;
+          return 4;
         }
-        else
-          outputFile = inputHdrFile;
-          
-        // remove path from input filename if any
-        if( outputFile.find("/") != std::string::npos )
-          outputFile = outputFile.substr( outputFile.rfind("/") +1 );
-        else if( outputFile.find("\\") != std::string::npos )
-          outputFile = outputFile.substr( outputFile.rfind("\\") +1 );
-          
-        outputFile = programPath + outputFile + "_rec" + extension;
+        return createPhantomFile( argv[2], ( argc > 3 ) ? atoi( argv[3] ) : PHANTOM_SIZE, ( argc > 4 ) ? atoi( argv[4] ) : 120 );
       }
+
+      std::string inputHdrFile( argv[1] );
+      std::string outputFile;
+      if( !daemonMode )
+        outputFile = getOutputFile( inputHdrFile, ( argc > 2 ) ? argv[2] : "" );
       
       
   // OPENGL SETUP
@@ -355,25 +561,44 @@ int main( int argc, char *argv[ ], char *envp[ ] )
       glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
       theMainWindow = glutCreateWindow("Volume Projection");  
       
+      theBackend = ReconstructionBackend::create( ReconstructionContext() );
+      std::cout << "Reconstruction backend: " << theBackend->getName() << std::endl;
+      
+      
+  // DAEMON MODE
+  
+      if( daemonMode ) {
+      
+        // GLEW, the FBO and the programs are initialized once for all the jobs
+        GPURecOpenGL::reset( PHANTOM_SIZE );
+        ReconstructionDaemon daemon( argv[2] );
+        daemon.run( runJob );
+        
+        GPURecOpenGL::terminate();
+        GPUGaussianConv::terminate();
+        if( USE_GLSL ) GPURecGLSL::terminate();
+        delete theBackend;
+        return 0;
+      }
+      
       
   // RECONSTRUCTION
 
       DBGutils::timerBegin("TOTAL");
  
 /*    HdrFile hdrFile( inputHdrFile );
-       
-      for( unsigned int s = 0; s < hdrFile.getNbScans(); s++ ) {
-           
-        std::cout << "Scan: " << s+1 << std::endl;
-        hdrFile.loadVolumeProjectionSet( scan, s );  
-        reconstruction( scan, volume );  
-        hdrFile.saveVolume( outputFile, volume, s );
-      }  */           
+      reconstructFrames( hdrFile, outputFile );  */           
       
       GPURecOpenGL::reset( PHANTOM_SIZE );
-      GPUGaussianConv::reset( PHANTOM_SIZE, DEFAULT_PIXEL_SIZE );
+      GPUGaussianConv::reset( PSFKey( PHANTOM_SIZE, DEFAULT_PIXEL_SIZE ) );
+      if( USE_GLSL ) GPURecGLSL::reset( PHANTOM_SIZE );
       phantom.create( HEMISPHERE, PHANTOM_SIZE );
       phantom.saveProjections( scan, 60 );
+      if( NOISE_SEED >= 0 ) {
+        scan.retrieveFromGraphicMemory();
+        PoissonNoise::apply( scan, NOISE_SEED, NB_THREADS );
+        scan.sendToGraphicMemory();
+      }
       
       
       reconstruction( scan, volume );  
@@ -381,7 +606,7 @@ int main( int argc, char *argv[ ], char *envp[ ] )
 //       volume.downSample( downSampledVolume );
       
 /*      GPURecOpenGL::reset( PHANTOM_SIZE / 2 );
-      GPUGaussianConv::reset( PHANTOM_SIZE / 2, DEFAULT_PIXEL_SIZE * 2 );
+      GPUGaussianConv::reset( PSFKey( PHANTOM_SIZE / 2, DEFAULT_PIXEL_SIZE * 2 ) );
       phantom8.create( HEMISPHERE, PHANTOM_SIZE / 2 );
       phantom8.saveProjections( scan, 60 );
 //       scan.createFromVolume( phantom8, 60 );
@@ -405,6 +630,8 @@ int main( int argc, char *argv[ ], char *envp[ ] )
     std::cerr << e.what() << std::endl;
     GPURecOpenGL::terminate();
     GPUGaussianConv::terminate();
+    if( USE_GLSL ) GPURecGLSL::terminate();
+    delete theBackend;
     return 4;
   }
         
@@ -414,6 +641,8 @@ int main( int argc, char *argv[ ], char *envp[ ] )
   //std::cin >> u;
   GPURecOpenGL::terminate();
   GPUGaussianConv::terminate();
+  if( USE_GLSL ) GPURecGLSL::terminate();
+  delete theBackend;
 
   return 0;
 }
@@ -0,0 +1,219 @@
+#include "common.h"
+#include <GL/glew.h>
+#include <GL/glut.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "DBGutils.h"
+
+#include "Volume.h"
+#include "VolumeMetrics.h"
+#include "Phantom.h"
+#include "PoissonNoise.h"
+#include "VolumeProjectionSet.h"
+#include "GPURecOpenGL.h"
+#include "GPUGaussianConv.h"
+#include "GPURecGLSL.h"
+#include "Configuration.h"
+#include "ReconstructionBackend.h"
+
+using namespace GPURec;
+
+// Parameter sweep: the hemisphere phantom is reconstructed with every number of subsets dividing the
+// number of projections, up to maxIterations iterations, with and without OSEM3D. The wall time, the
+// diff() error and the metrics of the volume are recorded after each iteration, then the points that
+// no other point beats on both time and diff() error (the Pareto front) are printed.
+// Both skip the borders outside the reconstructed cylinder: diff() is normalized by dim^3, the MAE by
+// the number of voxels it sums.
+// The other parameters (backend, camera, NOISE_SEED) come from the config file.
+//
+// Usage: GPURecSweep [dim] [nbProjections] [maxIterations]
+
+
+namespace GPURec {
+
+std::string programPath = "";
+
+} // end of namespace GPURec
+
+
+struct SweepPoint {
+
+  bool osem3d;
+  unsigned int nbSubsets;
+  unsigned int nbIterations;
+  double time;          // seconds, all the iterations up to this one
+  double error;         // diff(), normalized by dim^3
+  double mae;           // normalized by the number of voxels summed
+  double rmse;
+  double ssim;
+};
+
+
+// reconstruction of the scan with the current parameters, one point per iteration
+void sweepReconstruction( ReconstructionBackend& backend, VolumeProjectionSet& scan, const Volume& reference,
+                          unsigned int maxIterations, std::vector<SweepPoint>& points ) {
+
+  backend.reset( scan.getDim(), scan.getPixelSize() );
+
+  Volume volume;
+  volume.createEmpty( scan.getDim(), false, backend.getContext().nbThreads, backend.getWorkers() );
+  backend.uploadVolume( volume );
+
+  VolumeProjectionSet ratios;
+  ratios.createEmpty( scan.getDim(), scan.getNbProjection(), scan.getStartAngle(), scan.getRotationIncrement(), false, backend.getContext().nbThreads,
+                      backend.getWorkers() );
+  backend.uploadProjections( ratios );
+  backend.uploadProjections( scan );
+
+  double time = 0.0;
+  for( unsigned int i = 1; i <= maxIterations; i++ ) {
+
+    // the GL commands are finished before the timer stops, the download isn't timed
+    DBGutils::Timer timer;
+    timer.start();
+    ratios.osemIteration( backend, volume, scan );
+    glFinish();
+    timer.stop();
+    time += timer.sum;
+
+    backend.downloadVolume( volume );
+    VolumeMetrics metrics;
+    metrics.compute( reference, volume, NB_THREADS );
+
+    SweepPoint point;
+    point.osem3d = backend.getContext().useOSEM3D;
+    point.nbSubsets = backend.getContext().nbSubsets;
+    point.nbIterations = i;
+    point.time = time;
+    point.error = diff( reference, volume );
+    point.mae = metrics.getMAE();
+    point.rmse = metrics.getRMSE();
+    point.ssim = metrics.getMeanSSIM();
+    points.push_back( point );
+  }
+}
+
+
+bool fasterPoint( const SweepPoint& p1, const SweepPoint& p2 ) {
+
+  return p1.time < p2.time || ( p1.time == p2.time && p1.error < p2.error );
+}
+
+
+void printPoint( const SweepPoint& point ) {
+
+  std::cout << std::setw(8) << ( point.osem3d ? "OSEM3D" : "OSEM" )
+            << std::setw(9) << point.nbSubsets
+            << std::setw(12) << point.nbIterations
+            << std::setw(12) << std::fixed << std::setprecision(3) << point.time
+            << std::setw(14) << std::scientific << std::setprecision(4) << point.error
+            << std::setw(14) << point.mae
+            << std::setw(14) << point.rmse
+            << std::setw(10) << std::fixed << point.ssim << std::endl;
+}
+
+
+void printHeader( void ) {
+
+  std::cout << std::setw(8) << "method" << std::setw(9) << "subsets" << std::setw(12) << "iterations"
+            << std::setw(12) << "time (s)" << std::setw(14) << "diff (/dim^3)"
+            << std::setw(14) << "MAE (/voxels)"
+            << std::setw(14) << "RMSE" << std::setw(10) << "SSIM" << std::endl;
+}
+
+
+int main( int argc, char *argv[ ] )
+{
+  ReconstructionBackend* backend = 0;
+
+  try {
+
+      unsigned int dim = ( argc > 1 ) ? atoi( argv[1] ) : 64;
+      unsigned int nbProjections = ( argc > 2 ) ? atoi( argv[2] ) : 60;
+      unsigned int maxIterations = ( argc > 3 ) ? atoi( argv[3] ) : 5;
+
+      programPath = argv[0];
+      programPath = programPath.substr( 0, programPath.rfind("\\") +1 );
+      std::string configFile = programPath + DEFAULT_CONFIG_FILENAME;
+      loadConfigFile( configFile.c_str() );
+
+
+  // OPENGL SETUP: the phantom is projected by the GL pipeline
+
+      glutInit( &argc, argv );
+      glutInitWindowSize( dim, dim );
+      glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
+      glutCreateWindow( "GPURec sweep" );
+
+      backend = ReconstructionBackend::create( ReconstructionContext() );
+      std::cout << "Reconstruction backend: " << backend->getName() << std::endl;
+
+      GPURecOpenGL::reset( dim );
+      GPUGaussianConv::reset( PSFKey( dim, DEFAULT_PIXEL_SIZE ) );
+      if( USE_GLSL ) GPURecGLSL::reset( dim );
+
+      Phantom phantom;
+      VolumeProjectionSet scan;
+      phantom.create( HEMISPHERE, dim );
+      phantom.saveProjections( scan, nbProjections );
+      if( NOISE_SEED >= 0 ) {
+        scan.retrieveFromGraphicMemory();
+        PoissonNoise::apply( scan, NOISE_SEED, NB_THREADS );
+        scan.sendToGraphicMemory();
+      }
+
+
+  // SWEEP
+
+      std::vector<SweepPoint> points;
+      for( unsigned int osem3d = 0; osem3d < 2; osem3d++ )
+      for( unsigned int nbSubsets = 1; nbSubsets <= nbProjections; nbSubsets++ ) {
+
+        if( nbProjections % nbSubsets != 0 ) continue;
+
+        ReconstructionContext context;
+        context.useOSEM3D = ( osem3d == 1 );
+        context.nbSubsets = nbSubsets;
+        backend->setContext( context );
+        std::cout << ( context.useOSEM3D ? "OSEM3D" : "OSEM" ) << ", " << context.nbSubsets << " subsets" << std::endl;
+        sweepReconstruction( *backend, scan, phantom, maxIterations, points );
+      }
+
+      std::cout << std::endl << "All points:" << std::endl;
+      printHeader();
+      for( unsigned int p = 0; p < points.size(); p++ )
+        printPoint( points[p] );
+
+      // PARETO FRONT: by increasing time, the points more accurate than all the faster ones
+      std::sort( points.begin(), points.end(), fasterPoint );
+      std::cout << std::endl << "Pareto front (fastest configuration for each accuracy):" << std::endl;
+      printHeader();
+      double bestError = 0.0;
+      for( unsigned int p = 0; p < points.size(); p++ ) {
+
+        if( p > 0 && points[p].error >= bestError ) continue;
+        bestError = points[p].error;
+        printPoint( points[p] );
+      }
+  }
+  catch( std::exception& ) {
+
+    GPURecOpenGL::terminate();
+    GPUGaussianConv::terminate();
+    if( USE_GLSL ) GPURecGLSL::terminate();
+    delete backend;
+    return 4;
+  }
+
+  GPURecOpenGL::terminate();
+  GPUGaussianConv::terminate();
+  if( USE_GLSL ) GPURecGLSL::terminate();
+  delete backend;
+
+  return 0;
+}
@@ -1,5 +1,6 @@
 
 #include "DBGutils.h"
+#include "THREADutils.h"
 
 // ============================================================================================ //
 // -------------------------------------------------------------------------------------------- //
@@ -7,7 +8,11 @@
 // -------------------------------------------------------------------------------------------- //
 // ============================================================================================ //
 
-std::map<const std::string, DBGutils::Timer> DBGutils::timers;
+std::map<const char*, DBGutils::Timer, DBGutils::NameLess> DBGutils::timers;
+
+// the reconstructions running on several threads share the table
+// (the measures of a name started by two threads at the same time overlap)
+static THREADutils::Mutex timersMutex;
 
 #ifdef _WIN32
 LARGE_INTEGER DBGutils::Timer::freq;
@@ -20,21 +25,38 @@ void DBGutils::timerBegin( char* const name ) {
 #ifdef _DBG_OPENGL
   glFinish();
 #endif
-  timers[std::string(name)].start();   // first request for this log 
+  THREADutils::Lock lock( timersMutex );
+  timers[name].start();   // first request for this log 
 } 
   
 void DBGutils::timerEnd( char* const name ) {
 #ifdef _DBG_OPENGL
   glFinish();
 #endif
-  timers[std::string(name)].stop();
+  THREADutils::Lock lock( timersMutex );
+  timers[name].stop();
+}
+
+double DBGutils::getTime( void ) {
+
+#ifdef _WIN32
+  LARGE_INTEGER counter, frequency;
+  QueryPerformanceCounter( &counter );
+  QueryPerformanceFrequency( &frequency );
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
 }
 
 void DBGutils::timersInfo( std::ostream& os ) {
 
+  THREADutils::Lock lock( timersMutex );
   os << std::endl << "===== Timers =====" << std::endl;
   
-  for( std::map<const std::string, DBGutils::Timer>::iterator itTimer = timers.begin(); itTimer != timers.end(); itTimer++ ) {
+  for( std::map<const char*, DBGutils::Timer, NameLess>::iterator itTimer = timers.begin(); itTimer != timers.end(); itTimer++ ) {
   
     os << std::endl << " - " << itTimer->first << " - " << std::endl;
     os << "|  min| " << (itTimer->second).min << std::endl;
@@ -12,10 +12,11 @@
 #include <windows.h>
 #else
 #include <sys/time.h>
+#include <time.h>
 #endif
 
 #include <map>
-#include <string>
+#include <cstring>
 #include <iostream>
 
 // The DBGutils class provides static functions to help debugging code such as asserts, timing functions, ...
@@ -30,14 +31,21 @@ public:
   // these functions shouldn't be used on statements of little execution time
   //  !! use glFinish() before stoping timer of opengl function !!
   // when using IO functions such as cout, timer func may be delayed ?
+  // the names are string literals: the table keeps the pointers, no string is built per call
   struct Timer;
   static void timerBegin( char* const name );  
   static void timerEnd( char* const name );
   static void timersInfo( std::ostream& ); 
   
+  // seconds of a monotonic clock (ns resolution), for the measures the program depends on
+  static double getTime( void );
+  
 private:
  
-  static std::map<const std::string, Timer> timers;  
+  struct NameLess {
+    bool operator()( const char* a, const char* b ) const { return strcmp( a, b ) < 0; }
+  };
+  static std::map<const char*, Timer, NameLess> timers;  
 };
 
 
@@ -63,7 +71,7 @@ struct DBGutils::Timer {
 
       QueryPerformanceCounter(&t2);
       
-      static double diff;
+      double diff;
       diff = ((double)t2.QuadPart - (double)t1.QuadPart)/((double)freq.QuadPart);
 	  
 	    if( diff < min ) min = diff;
@@ -102,7 +110,7 @@ struct DBGutils::Timer {
     void stop() {
       gettimeofday(&t2,&tz);
       
-      static double diff;
+      double diff;
       diff = (double)t2.tv_sec + (double)t2.tv_usec/(1000*1000) 
             -( (double)t1.tv_sec + (double)t1.tv_usec/(1000*1000) );
 
@@ -0,0 +1,130 @@
+#include "FFTutils.h"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  FFT PLANS
+// -------------------------------------------------------------------------------------------- //
+// ============================================================================================ //
+
+unsigned int FFTutils::nextPowerOf2( unsigned int n ) {
+
+  unsigned int power = 1;
+  while( power < n ) power *= 2;
+  return power;
+}
+
+
+void FFTutils::Plan::computeTables( unsigned int size, std::vector<unsigned int>& bitReverse, std::vector<Complex>& twiddles ) {
+
+  unsigned int nbBits = 0;
+  while( (1u << nbBits) < size ) nbBits++;
+
+  bitReverse.resize( size );
+  for( unsigned int i = 0; i < size; i++ ) {
+  
+    unsigned int reversed = 0;
+    for( unsigned int b = 0; b < nbBits; b++ )
+      if( i & (1u << b) ) reversed |= 1u << (nbBits - 1 - b);
+    bitReverse[i] = reversed;
+  }
+  
+  twiddles.resize( size/2 );
+  for( unsigned int k = 0; k < size/2; k++ )
+    twiddles[k] = std::polar( 1.0, -2.0 * M_PI * k / size );
+}
+
+
+void FFTutils::Plan::initialize( unsigned int _n ) {
+
+  n = _n;
+  m = 0;
+  bitReverse.clear();
+  twiddles.clear();
+  chirp.clear();
+  chirpFilter.clear();
+  
+  if( n <= 1 ) return;
+  
+  if( isPowerOf2( n ) ) {
+  
+    computeTables( n, bitReverse, twiddles );
+    return;
+  }
+  
+  // Bluestein: the DFT is a convolution with a chirp, computed with power of 2 transforms
+  m = nextPowerOf2( 2*n - 1 );
+  computeTables( m, bitReverse, twiddles );
+  
+  chirp.resize( n );
+  for( unsigned int k = 0; k < n; k++ ) {
+  
+    // k^2 modulo 2n keeps the phase accurate for large k
+    unsigned long long k2 = ( (unsigned long long)k * k ) % ( 2 * n );
+    chirp[k] = std::polar( 1.0, -M_PI * k2 / n );
+  }
+  
+  chirpFilter.assign( m, Complex(0.0) );
+  chirpFilter[0] = std::conj( chirp[0] );
+  for( unsigned int k = 1; k < n; k++ )
+    chirpFilter[k] = chirpFilter[m-k] = std::conj( chirp[k] );
+  radix2( &chirpFilter[0], m, bitReverse, twiddles, false );
+}
+
+
+void FFTutils::Plan::radix2( Complex* data, unsigned int size, const std::vector<unsigned int>& bitReverse, const std::vector<Complex>& twiddles, bool inverse ) const {
+
+  for( unsigned int i = 0; i < size; i++ )
+    if( i < bitReverse[i] ) std::swap( data[i], data[ bitReverse[i] ] );
+    
+  for( unsigned int length = 2; length <= size; length *= 2 ) {
+  
+    unsigned int half = length / 2;
+    unsigned int twiddleStep = size / length;
+    
+    for( unsigned int start = 0; start < size; start += length )
+    for( unsigned int k = 0; k < half; k++ ) {
+    
+      Complex twiddle = inverse ? std::conj( twiddles[ k * twiddleStep ] ) : twiddles[ k * twiddleStep ];
+      Complex odd = data[ start + k + half ] * twiddle;
+      data[ start + k + half ] = data[ start + k ] - odd;
+      data[ start + k ] += odd;
+    }
+  }
+}
+
+
+void FFTutils::Plan::transform( Complex* data, unsigned int stride, bool inverse, Complex* work ) const {
+
+  if( n <= 1 ) return;
+  
+  if( m == 0 ) {
+  
+    for( unsigned int k = 0; k < n; k++ ) work[k] = data[ k * stride ];
+    radix2( work, n, bitReverse, twiddles, inverse );
+  }
+  else {
+  
+    // the inverse transform is the conjugate of the transform of the conjugate
+    Complex* a = work + n;
+    for( unsigned int k = 0; k < n; k++ )
+      a[k] = ( inverse ? std::conj( data[ k * stride ] ) : data[ k * stride ] ) * chirp[k];
+    for( unsigned int k = n; k < m; k++ )
+      a[k] = 0.0;
+      
+    radix2( a, m, bitReverse, twiddles, false );
+    for( unsigned int k = 0; k < m; k++ ) a[k] *= chirpFilter[k];
+    radix2( a, m, bitReverse, twiddles, true );
+    
+    for( unsigned int k = 0; k < n; k++ ) {
+      work[k] = a[k] * chirp[k] / (double)m;
+      if( inverse ) work[k] = std::conj( work[k] );
+    }
+  }
+  
+  double normalization = inverse ? 1.0 / n : 1.0;
+  for( unsigned int k = 0; k < n; k++ )
+    data[ k * stride ] = work[k] * normalization;
+}
@@ -0,0 +1,54 @@
+#ifndef _FFTUTILS_H
+#define _FFTUTILS_H
+
+#include <complex>
+#include <vector>
+
+// The FFTutils class provides 1D discrete Fourier transforms of any size
+// radix-2 for powers of 2, Bluestein (chirp-z through a power of 2 transform) for the other sizes
+class FFTutils
+{
+public:
+
+  typedef std::complex<double> Complex;
+  
+  // a plan precomputes the tables of one transform size and is reused for all the transforms of that size
+  // the plan is read only once built: several threads can use it with their own work buffers
+  class Plan;
+  
+  static bool isPowerOf2( unsigned int n ) { return n > 0 && (n & (n-1)) == 0; }
+  static unsigned int nextPowerOf2( unsigned int n );
+};
+
+
+class FFTutils::Plan
+{
+public:
+
+  Plan( unsigned int _n = 0 ) { initialize( _n ); }
+  void initialize( unsigned int _n );
+  
+  unsigned int getSize( void ) const { return n; }
+  unsigned int getWorkSize( void ) const { return n + m; }    // size of the work buffer given to transform()
+  
+  // in place transform of the n values data[0], data[stride], ... 
+  // the inverse transform is normalized by 1/n
+  void transform( Complex* data, unsigned int stride, bool inverse, Complex* work ) const;
+  
+private:
+
+  // in place power of 2 transform of size *size* (n or m)
+  void radix2( Complex* data, unsigned int size, const std::vector<unsigned int>& bitReverse, const std::vector<Complex>& twiddles, bool inverse ) const;
+  static void computeTables( unsigned int size, std::vector<unsigned int>& bitReverse, std::vector<Complex>& twiddles );
+  
+  unsigned int n;
+  unsigned int m;                          // Bluestein convolution size, 0 for powers of 2
+  
+  std::vector<unsigned int> bitReverse;    // radix-2 tables of the size n, or m with Bluestein
+  std::vector<Complex> twiddles;
+  
+  std::vector<Complex> chirp;              // exp( -i pi k^2 / n )
+  std::vector<Complex> chirpFilter;        // transform of the conjugated chirp, zero padded to m
+};
+
+#endif  // _FFTUTILS_H
@@ -0,0 +1,262 @@
+#include "MEMutils.h"
+
+#include <new>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <exception>
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "THREADutils.h"
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  STAGING BUFFERS
+// -------------------------------------------------------------------------------------------- //
+// ============================================================================================ //
+
+static const unsigned int MIN_CLASS = 12;                   // 4 KB
+static const unsigned int NB_CLASSES = 8 * sizeof(size_t);
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// stored in the ALIGNMENT bytes before each buffer
+struct BufferHeader {
+
+  void* base;               // start of the allocation
+  size_t size;              // allocated bytes, header included
+  unsigned int sizeClass;   // log2 of the buffer size
+  bool mapped;              // huge pages mapping instead of the heap
+};
+
+static std::vector<void*> freeBuffers[NB_CLASSES];
+static size_t freeBytes = 0;               // allocated bytes of the free buffers
+static bool hugePages = false;
+static THREADutils::Mutex poolMutex;
+
+#ifdef GPUREC_COUNT_ALLOCATIONS
+static volatile long nbAllocations = 0;
+
+// atomic: the threads of the kernels allocate concurrently
+static void countAllocation( void ) {
+
+#ifdef _WIN32
+  InterlockedIncrement( &nbAllocations );
+#else
+  __sync_fetch_and_add( &nbAllocations, 1 );
+#endif
+}
+#endif
+
+
+static void* allocate( unsigned int sizeClass ) {
+
+  size_t size = ( (size_t)1 << sizeClass ) + MEMutils::ALIGNMENT;
+  void* base = 0;
+  bool mapped = false;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if( hugePages && size > HUGE_PAGE_SIZE ) {
+    base = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( base == MAP_FAILED ) base = 0;
+    else {
+      madvise( base, size, MADV_HUGEPAGE );
+      mapped = true;
+    }
+  }
+#endif
+
+  if( !base ) {
+#ifdef _WIN32
+    base = _aligned_malloc( size, MEMutils::ALIGNMENT );
+#else
+    if( posix_memalign( &base, MEMutils::ALIGNMENT, size ) != 0 ) base = 0;
+#endif
+  }
+
+  if( !base ) {
+    std::cerr << "Staging buffer: allocation of " << size << " bytes failed" << std::endl;
+    throw std::exception();
+  }
+
+  BufferHeader* header = (BufferHeader*)base;
+  header->base = base;
+  header->size = size;
+  header->sizeClass = sizeClass;
+  header->mapped = mapped;
+#ifdef GPUREC_COUNT_ALLOCATIONS
+  countAllocation();
+#endif
+  return (char*)base + MEMutils::ALIGNMENT;
+}
+
+
+static void deallocate( void* buffer ) {
+
+  BufferHeader* header = (BufferHeader*)( (char*)buffer - MEMutils::ALIGNMENT );
+
+#ifndef _WIN32
+  if( header->mapped ) {
+    munmap( header->base, header->size );
+    return;
+  }
+#endif
+
+#ifdef _WIN32
+  _aligned_free( header->base );
+#else
+  free( header->base );
+#endif
+}
+
+
+void* MEMutils::acquire( size_t nbBytes ) {
+
+  unsigned int sizeClass = MIN_CLASS;
+  while( ( (size_t)1 << sizeClass ) < nbBytes ) sizeClass++;
+
+  THREADutils::Lock lock( poolMutex );
+
+  std::vector<void*>& buffers = freeBuffers[sizeClass];
+  if( buffers.empty() )
+    return allocate( sizeClass );
+
+  void* buffer = buffers.back();
+  buffers.pop_back();
+  freeBytes -= ( (BufferHeader*)( (char*)buffer - ALIGNMENT ) )->size;
+  return buffer;
+}
+
+
+void MEMutils::release( void* buffer ) {
+
+  if( !buffer ) return;
+
+  BufferHeader* header = (BufferHeader*)( (char*)buffer - ALIGNMENT );
+
+  THREADutils::Lock lock( poolMutex );
+  if( freeBytes + header->size > POOL_CAPACITY ) {
+    deallocate( buffer );
+    return;
+  }
+  freeBuffers[ header->sizeClass ].push_back( buffer );
+  freeBytes += header->size;
+}
+
+
+void MEMutils::clear( void ) {
+
+  THREADutils::Lock lock( poolMutex );
+
+  for( unsigned int c = 0; c < NB_CLASSES; c++ ) {
+    for( unsigned int b = 0; b < freeBuffers[c].size(); b++ )
+      deallocate( freeBuffers[c][b] );
+    std::vector<void*>().swap( freeBuffers[c] );
+  }
+  freeBytes = 0;
+}
+
+
+void MEMutils::setHugePages( bool use ) {
+
+  THREADutils::Lock lock( poolMutex );
+  hugePages = use;
+}
+
+
+#ifdef GPUREC_COUNT_ALLOCATIONS
+unsigned long MEMutils::getNbAllocations( void ) {
+
+  return (unsigned long)nbAllocations;
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  ALLOCATIONS COUNT (GPUREC_COUNT_ALLOCATIONS)
+// -------------------------------------------------------------------------------------------- //
+// ============================================================================================ //
+
+// the exception specifications of the replaced operators: C++98 ones, removed by C++17
+#if __cplusplus >= 201103L
+#define THROW_BAD_ALLOC
+#define THROW_NOTHING noexcept
+#else
+#define THROW_BAD_ALLOC throw( std::bad_alloc )
+#define THROW_NOTHING throw()
+#endif
+
+// the global operators of the program count every allocation of the containers and of new
+void* operator new( size_t nbBytes ) THROW_BAD_ALLOC {
+
+  countAllocation();
+  void* data = malloc( nbBytes ? nbBytes : 1 );
+  if( !data ) throw std::bad_alloc();
+  return data;
+}
+
+
+void* operator new[]( size_t nbBytes ) THROW_BAD_ALLOC {
+
+  return operator new( nbBytes );
+}
+
+
+void* operator new( size_t nbBytes, const std::nothrow_t& ) THROW_NOTHING {
+
+  countAllocation();
+  return malloc( nbBytes ? nbBytes : 1 );
+}
+
+
+void* operator new[]( size_t nbBytes, const std::nothrow_t& ) THROW_NOTHING {
+
+  countAllocation();
+  return malloc( nbBytes ? nbBytes : 1 );
+}
+
+
+void operator delete( void* data ) THROW_NOTHING {
+
+  free( data );
+}
+
+
+void operator delete[]( void* data ) THROW_NOTHING {
+
+  free( data );
+}
+
+
+void operator delete( void* data, const std::nothrow_t& ) THROW_NOTHING {
+
+  free( data );
+}
+
+
+void operator delete[]( void* data, const std::nothrow_t& ) THROW_NOTHING {
+
+  free( data );
+}
+
+
+// sized deallocation (C++14)
+#if __cplusplus >= 201402L
+void operator delete( void* data, size_t ) THROW_NOTHING {
+
+  free( data );
+}
+
+
+void operator delete[]( void* data, size_t ) THROW_NOTHING {
+
+  free( data );
+}
+#endif
+#endif
@@ -0,0 +1,47 @@
+#ifndef _MEMUTILS_H
+#define _MEMUTILS_H
+
+#include <cstddef>
+
+// The MEMutils class provides a pool of staging buffers for the transfers between the data arrays
+// and the textures or the files: the buffers are released to the pool instead of being freed,
+// the next transfer of the same size class reuses them
+// size classes are powers of 2 (4 KB at least), the buffers are aligned on 64 bytes
+// the pool keeps at most POOL_CAPACITY bytes of free buffers: the buffers released above it are freed
+class MEMutils
+{
+public:
+
+  static const size_t ALIGNMENT = 64;
+  static const size_t POOL_CAPACITY = (size_t)256 * 1024 * 1024;
+
+  // buffer of at least nbBytes bytes, given back with release()
+  static void* acquire( size_t nbBytes );
+  static void release( void* buffer );
+
+  // frees the buffers kept by the pool (called by the backends when they free their working buffers)
+  static void clear( void );
+
+  // buffers of 2 MB or more in transparent huge pages (Linux, ignored elsewhere), for the next allocations
+  static void setHugePages( bool use );
+
+#ifdef GPUREC_COUNT_ALLOCATIONS
+  // heap allocations since the start: operator new (replaced in the builds that define GPUREC_COUNT_ALLOCATIONS)
+  // and the buffers of the pool, it stays constant while the code only reuses its buffers
+  static unsigned long getNbAllocations( void );
+#endif
+
+  // staging buffer of nbValues values until the end of the scope, null for 0 values
+  template<typename T> class Buffer {
+  public:
+    Buffer( size_t nbValues ) : data( nbValues ? (T*)acquire( nbValues * sizeof(T) ) : 0 ) {}
+    ~Buffer() { release( data ); }
+    T* get( void ) const { return data; }
+  private:
+    Buffer( const Buffer& );
+    Buffer& operator=( const Buffer& );
+    T* data;
+  };
+};
+
+#endif  // _MEMUTILS_H
@@ -0,0 +1,64 @@
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "RANDOMutils.h"
+
+// multipliers and key increments of Philox4x32
+static const unsigned int PHILOX_M0 = 0xD2511F53;
+static const unsigned int PHILOX_M1 = 0xCD9E8D57;
+static const unsigned int PHILOX_W0 = 0x9E3779B9;
+static const unsigned int PHILOX_W1 = 0xBB67AE85;
+static const unsigned int PHILOX_ROUNDS = 10;
+
+
+void RANDOMutils::philox( const unsigned int counter[4], const unsigned int key[2], unsigned int result[4] ) {
+
+  unsigned int c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  unsigned int k0 = key[0], k1 = key[1];
+
+  for( unsigned int r = 0; r < PHILOX_ROUNDS; r++ ) {
+
+    unsigned long long product0 = (unsigned long long)PHILOX_M0 * c0;
+    unsigned long long product1 = (unsigned long long)PHILOX_M1 * c2;
+
+    unsigned int hi0 = (unsigned int)( product0 >> 32 ), lo0 = (unsigned int)product0;
+    unsigned int hi1 = (unsigned int)( product1 >> 32 ), lo1 = (unsigned int)product1;
+
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+
+  result[0] = c0;  result[1] = c1;  result[2] = c2;  result[3] = c3;
+}
+
+
+unsigned int RANDOMutils::poisson( double mean, unsigned int word0, unsigned int word1 ) {
+
+  if( !( mean > 0.0 ) ) return 0;
+
+  if( mean <= POISSON_INVERSION_MAX_MEAN ) {
+
+    // smallest k whose cumulative probability reaches u
+    double u = toUniform( word0 );
+    double probability = exp( -mean );
+    double cumulative = probability;
+    unsigned int k = 0;
+    while( u > cumulative && k < 4 * POISSON_INVERSION_MAX_MEAN ) {
+      k++;
+      probability *= mean / k;
+      cumulative += probability;
+    }
+    return k;
+  }
+
+  // Box-Muller
+  double normal = sqrt( -2.0 * log( toUniform( word0 ) ) ) * cos( 2.0 * M_PI * toUniform( word1 ) );
+  double sample = floor( mean + sqrt( mean ) * normal + 0.5 );
+  return ( sample > 0.0 ) ? (unsigned int)sample : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef _RANDOMUTILS_H
+#define _RANDOMUTILS_H
+
+// The RANDOMutils class provides a counter-based random generator (Philox4x32-10): the numbers are a
+// function of a key and a counter only, so any element of a stream is drawn without the ones before it
+// and the results don't depend on the order or the thread in which they are drawn
+class RANDOMutils
+{
+public:
+
+  // 4 random words for the counter, with the key
+  static void philox( const unsigned int counter[4], const unsigned int key[2], unsigned int result[4] );
+
+  // uniform double in (0,1) from a random word
+  static double toUniform( unsigned int word ) { return ( word + 0.5 ) * ( 1.0 / 4294967296.0 ); }
+
+  // Poisson sample of the mean from 2 random words:
+  // inversion of the cumulative distribution for small means, rounded normal approximation above
+  static unsigned int poisson( double mean, unsigned int word0, unsigned int word1 );
+
+  // above this mean the normal approximation is used
+  static const unsigned int POISSON_INVERSION_MAX_MEAN = 64;
+};
+
+#endif  // _RANDOMUTILS_H
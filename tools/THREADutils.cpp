@@ -0,0 +1,401 @@
+#include "THREADutils.h"
+
+#include <vector>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  PARALLEL LOOPS
+// -------------------------------------------------------------------------------------------- //
+// ============================================================================================ //
+
+struct ThreadRange {
+
+  THREADutils::RangeFunction function;
+  void* context;
+  unsigned int begin;
+  unsigned int end;
+  bool started;                   // false: the thread can not be created, the range is processed by the calling thread
+#ifdef _WIN32
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+};
+
+// ranges of a loop kept on the stack: the loops of the kernels don't allocate
+static const unsigned int LOCAL_RANGES = 64;
+
+struct FillContext {
+
+  float* data;
+  size_t blockSize;
+  float value;
+};
+
+
+static void fillBlocks( unsigned int begin, unsigned int end, void* context ) {
+
+  FillContext* ctx = (FillContext*)context;
+  std::fill( ctx->data + begin * ctx->blockSize, ctx->data + end * ctx->blockSize, ctx->value );
+}
+
+#ifdef _WIN32
+static DWORD WINAPI runRange( LPVOID arg ) {
+#else
+static void* runRange( void* arg ) {
+#endif
+
+  ThreadRange* range = (ThreadRange*)arg;
+  range->function( range->begin, range->end, range->context );
+  return 0;
+}
+
+
+unsigned int THREADutils::getNbHardwareThreads( void ) {
+
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo( &info );
+  return info.dwNumberOfProcessors;
+#else
+  long nbProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+  return (nbProcessors > 0) ? (unsigned int)nbProcessors : 1;
+#endif
+}
+
+
+unsigned int THREADutils::getRangeIndex( unsigned int first, unsigned int end, unsigned int begin, unsigned int nbThreads ) {
+
+  if( nbThreads == 0 ) nbThreads = getNbHardwareThreads();
+  if( nbThreads > end - first ) nbThreads = end - first;
+
+  // the same ranges as parallelFor: the remainder ranges of rangeSize+1 indices first
+  unsigned int rangeSize = (end - first) / nbThreads;
+  unsigned int remainder = (end - first) % nbThreads;
+  unsigned int offset = begin - first;
+  if( offset < remainder * (rangeSize + 1) )
+    return offset / (rangeSize + 1);
+  return remainder + ( offset - remainder * (rangeSize + 1) ) / rangeSize;
+}
+
+
+void THREADutils::getAllowedCores( std::vector<unsigned int>& cores ) {
+
+  cores.clear();
+
+#ifdef _WIN32
+  DWORD_PTR processMask, systemMask;
+  if( GetProcessAffinityMask( GetCurrentProcess(), &processMask, &systemMask ) )
+    for( unsigned int core = 0; core < 8 * sizeof(DWORD_PTR); core++ )
+      if( processMask & ( (DWORD_PTR)1 << core ) ) cores.push_back( core );
+#elif defined(__linux__)
+  cpu_set_t allowed;
+  if( sched_getaffinity( 0, sizeof(cpu_set_t), &allowed ) == 0 )
+    for( unsigned int core = 0; core < CPU_SETSIZE; core++ )
+      if( CPU_ISSET( core, &allowed ) ) cores.push_back( core );
+#endif
+}
+
+
+void THREADutils::parallelFor( unsigned int begin, unsigned int end, RangeFunction function, void* context, unsigned int nbThreads,
+                               WorkerPool* workers ) {
+
+  if( end <= begin ) return;
+  
+  if( workers ) {
+    workers->run( begin, end, function, context );
+    return;
+  }
+  
+  if( nbThreads == 0 ) nbThreads = getNbHardwareThreads();
+  if( nbThreads > end - begin ) nbThreads = end - begin;
+  
+  // contiguous ranges, the first ones get one more index when the division is not exact
+  ThreadRange localRanges[LOCAL_RANGES];
+  std::vector<ThreadRange> moreRanges( nbThreads > LOCAL_RANGES ? nbThreads : 0 );
+  ThreadRange* ranges = ( nbThreads > LOCAL_RANGES ) ? &moreRanges[0] : localRanges;
+  unsigned int rangeSize = (end - begin) / nbThreads;
+  unsigned int remainder = (end - begin) % nbThreads;
+  unsigned int current = begin;
+  for( unsigned int t = 0; t < nbThreads; t++ ) {
+  
+    ranges[t].function = function;
+    ranges[t].context = context;
+    ranges[t].begin = current;
+    current += rangeSize + (t < remainder ? 1 : 0);
+    ranges[t].end = current;
+    ranges[t].started = false;
+  }
+  
+  for( unsigned int t = 1; t < nbThreads; t++ ) {
+#ifdef _WIN32
+    ranges[t].thread = CreateThread( NULL, 0, runRange, &ranges[t], 0, NULL );
+    ranges[t].started = ( ranges[t].thread != NULL );
+#else
+    ranges[t].started = ( pthread_create( &ranges[t].thread, NULL, runRange, &ranges[t] ) == 0 );
+#endif
+  }
+
+  runRange( &ranges[0] );
+
+  for( unsigned int t = 1; t < nbThreads; t++ )
+    if( !ranges[t].started ) runRange( &ranges[t] );
+  
+  for( unsigned int t = 1; t < nbThreads; t++ ) {
+    if( !ranges[t].started ) continue;
+#ifdef _WIN32
+    WaitForSingleObject( ranges[t].thread, INFINITE );
+    CloseHandle( ranges[t].thread );
+#else
+    pthread_join( ranges[t].thread, NULL );
+#endif
+  }
+}
+
+
+
+void THREADutils::fill( float* data, unsigned int nbBlocks, size_t blockSize, float value, unsigned int nbThreads,
+                        WorkerPool* workers ) {
+
+  FillContext context;
+  context.data = data;
+  context.blockSize = blockSize;
+  context.value = value;
+  parallelFor( 0, nbBlocks, fillBlocks, &context, nbThreads, workers );
+}
+
+
+void THREADutils::Array::allocate( unsigned int nbBlocks, size_t blockSize, float value, unsigned int nbThreads,
+                                   WorkerPool* workers ) {
+
+  clear();
+  count = nbBlocks * blockSize;
+  data = new float[count];
+  fill( data, nbBlocks, blockSize, value, nbThreads, workers );
+}
+
+
+void THREADutils::Array::clear( void ) {
+
+  delete [] data;
+  data = 0;
+  count = 0;
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  WORKER POOL
+// -------------------------------------------------------------------------------------------- //
+// ============================================================================================ //
+
+#ifdef _WIN32
+DWORD WINAPI THREADutils::WorkerPool::work( LPVOID arg ) {
+#else
+void* THREADutils::WorkerPool::work( void* arg ) {
+#endif
+
+  Worker* worker = (Worker*)arg;
+  WorkerPool* pool = worker->pool;
+  unsigned int done = 0;
+
+#ifdef _WIN32
+  EnterCriticalSection( &pool->section );
+  for(;;) {
+    while( pool->loop == done && !pool->stopping )
+      SleepConditionVariableCS( &pool->loopStarted, &pool->section, INFINITE );
+    if( pool->stopping ) break;
+    done = pool->loop;
+    LeaveCriticalSection( &pool->section );
+    if( worker->begin < worker->end ) pool->function( worker->begin, worker->end, pool->context );
+    EnterCriticalSection( &pool->section );
+    if( --pool->pending == 0 ) WakeConditionVariable( &pool->loopDone );
+  }
+  LeaveCriticalSection( &pool->section );
+#else
+  pthread_mutex_lock( &pool->mutex );
+  for(;;) {
+    while( pool->loop == done && !pool->stopping )
+      pthread_cond_wait( &pool->loopStarted, &pool->mutex );
+    if( pool->stopping ) break;
+    done = pool->loop;
+    pthread_mutex_unlock( &pool->mutex );
+    if( worker->begin < worker->end ) pool->function( worker->begin, worker->end, pool->context );
+    pthread_mutex_lock( &pool->mutex );
+    if( --pool->pending == 0 ) pthread_cond_signal( &pool->loopDone );
+  }
+  pthread_mutex_unlock( &pool->mutex );
+#endif
+  return 0;
+}
+
+
+THREADutils::WorkerPool::WorkerPool( unsigned int _nbThreads, const std::vector<unsigned int>* cores ) {
+
+  nbThreads = _nbThreads ? _nbThreads : getNbHardwareThreads();
+  function = 0;
+  context = 0;
+  loop = 0;
+  pending = 0;
+  stopping = false;
+  bool pinning = cores && !cores->empty();
+
+#ifdef _WIN32
+  InitializeCriticalSection( &section );
+  InitializeConditionVariable( &loopStarted );
+  InitializeConditionVariable( &loopDone );
+#else
+  pthread_mutex_init( &mutex, NULL );
+  pthread_cond_init( &loopStarted, NULL );
+  pthread_cond_init( &loopDone, NULL );
+#endif
+
+  // the addresses of the workers are given to their threads: the vector isn't resized afterwards
+  workers.resize( nbThreads );
+  for( unsigned int t = 0; t < nbThreads; t++ ) {
+  
+    Worker& worker = workers[t];
+    worker.pool = this;
+    worker.begin = 0;
+    worker.end = 0;
+    unsigned int core = pinning ? (*cores)[ (size_t)t * cores->size() / nbThreads ] : 0;
+#ifdef _WIN32
+    worker.thread = CreateThread( NULL, 0, work, &worker, CREATE_SUSPENDED, NULL );
+    worker.started = ( worker.thread != NULL );
+    if( !worker.started ) continue;
+    if( pinning ) SetThreadAffinityMask( worker.thread, (DWORD_PTR)1 << core );
+    ResumeThread( worker.thread );
+#else
+    pthread_attr_t attributes;
+    pthread_attr_init( &attributes );
+#ifdef __linux__
+    cpu_set_t threadCore;
+    CPU_ZERO( &threadCore );
+    CPU_SET( core, &threadCore );
+    if( pinning ) pthread_attr_setaffinity_np( &attributes, sizeof(cpu_set_t), &threadCore );
+#endif
+    worker.started = ( pthread_create( &worker.thread, &attributes, work, &worker ) == 0 );
+    pthread_attr_destroy( &attributes );
+#endif
+  }
+}
+
+
+THREADutils::WorkerPool::~WorkerPool() {
+
+#ifdef _WIN32
+  EnterCriticalSection( &section );
+  stopping = true;
+  WakeAllConditionVariable( &loopStarted );
+  LeaveCriticalSection( &section );
+#else
+  pthread_mutex_lock( &mutex );
+  stopping = true;
+  pthread_cond_broadcast( &loopStarted );
+  pthread_mutex_unlock( &mutex );
+#endif
+
+  for( unsigned int t = 0; t < nbThreads; t++ ) {
+    if( !workers[t].started ) continue;
+#ifdef _WIN32
+    WaitForSingleObject( workers[t].thread, INFINITE );
+    CloseHandle( workers[t].thread );
+#else
+    pthread_join( workers[t].thread, NULL );
+#endif
+  }
+
+#ifdef _WIN32
+  DeleteCriticalSection( &section );
+#else
+  pthread_cond_destroy( &loopStarted );
+  pthread_cond_destroy( &loopDone );
+  pthread_mutex_destroy( &mutex );
+#endif
+}
+
+
+void THREADutils::WorkerPool::run( unsigned int begin, unsigned int end, RangeFunction _function, void* _context ) {
+
+  if( end <= begin ) return;
+
+  // the ranges of parallelFor( begin, end, ..., nbThreads ), the workers after the last range have nothing to do
+  unsigned int nbRanges = ( nbThreads > end - begin ) ? end - begin : nbThreads;
+  unsigned int rangeSize = (end - begin) / nbRanges;
+  unsigned int remainder = (end - begin) % nbRanges;
+  unsigned int current = begin;
+  unsigned int nbStarted = 0;
+  for( unsigned int t = 0; t < nbThreads; t++ ) {
+  
+    workers[t].begin = current;
+    if( t < nbRanges ) current += rangeSize + (t < remainder ? 1 : 0);
+    workers[t].end = current;
+    if( workers[t].started ) nbStarted++;
+  }
+
+  // the calling thread waits: all the ranges run on the threads of the pool
+#ifdef _WIN32
+  EnterCriticalSection( &section );
+  function = _function;
+  context = _context;
+  pending = nbStarted;
+  loop++;
+  WakeAllConditionVariable( &loopStarted );
+  LeaveCriticalSection( &section );
+#else
+  pthread_mutex_lock( &mutex );
+  function = _function;
+  context = _context;
+  pending = nbStarted;
+  loop++;
+  pthread_cond_broadcast( &loopStarted );
+  pthread_mutex_unlock( &mutex );
+#endif
+
+  for( unsigned int t = 0; t < nbThreads; t++ )
+    if( !workers[t].started && workers[t].begin < workers[t].end )
+      _function( workers[t].begin, workers[t].end, _context );
+
+#ifdef _WIN32
+  EnterCriticalSection( &section );
+  while( pending > 0 )
+    SleepConditionVariableCS( &loopDone, &section, INFINITE );
+  LeaveCriticalSection( &section );
+#else
+  pthread_mutex_lock( &mutex );
+  while( pending > 0 )
+    pthread_cond_wait( &loopDone, &mutex );
+  pthread_mutex_unlock( &mutex );
+#endif
+}
+
+
+
+// ============================================================================================ //
+// -------------------------------------------------------------------------------------------- //
+//  MUTEX
+// -------------------------------------------------------------------------------------------- //
+// ============================================================================================ //
+
+#ifdef _WIN32
+
+THREADutils::Mutex::Mutex()         { InitializeCriticalSection( &section ); }
+THREADutils::Mutex::~Mutex()        { DeleteCriticalSection( &section ); }
+void THREADutils::Mutex::lock()     { EnterCriticalSection( &section ); }
+void THREADutils::Mutex::unlock()   { LeaveCriticalSection( &section ); }
+
+#else
+
+THREADutils::Mutex::Mutex()         { pthread_mutex_init( &mutex, NULL ); }
+THREADutils::Mutex::~Mutex()        { pthread_mutex_destroy( &mutex ); }
+void THREADutils::Mutex::lock()     { pthread_mutex_lock( &mutex ); }
+void THREADutils::Mutex::unlock()   { pthread_mutex_unlock( &mutex ); }
+
+#endif
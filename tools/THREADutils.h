@@ -0,0 +1,139 @@
+#ifndef _THREADUTILS_H
+#define _THREADUTILS_H
+
+#include <cstddef>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// The THREADutils class provides static functions to run loops on several threads
+// (win32 threads or pthreads, the code stays C++98)
+class THREADutils
+{
+public:
+
+  // body of a parallel loop: processes the indices [begin,end) with the shared context
+  typedef void (*RangeFunction)( unsigned int begin, unsigned int end, void* context );
+
+  class WorkerPool;
+
+  // split [begin,end) in nbThreads contiguous ranges and run them concurrently
+  // the calling thread processes the first range, the call returns when all the ranges are done
+  // nbThreads = 0 uses one thread per hardware thread
+  // with a pool the ranges run on its workers (nbThreads must be the size of the pool): the same ranges always
+  // run on the same threads, without a pool the threads are created for the loop
+  static void parallelFor( unsigned int begin, unsigned int end, RangeFunction function, void* context, unsigned int nbThreads = 0,
+                           WorkerPool* workers = 0 );
+
+  // index of the range of parallelFor( first, end, ..., nbThreads ) that starts at begin,
+  // the scratch memory of the range t is only used by one thread during the loop
+  static unsigned int getRangeIndex( unsigned int first, unsigned int end, unsigned int begin, unsigned int nbThreads );
+
+  // number of hardware threads of the machine
+  static unsigned int getNbHardwareThreads( void );
+
+  // hardware threads allowed to the process (cpuset of a container or of taskset) in their order,
+  // the pinning list of a reconstruction that has the machine for itself
+  static void getAllowedCores( std::vector<unsigned int>& cores );
+
+  // float array allocated without being written: block b is first written by the thread processing the index b
+  // of parallelFor( 0, nbBlocks ), its pages are placed on the memory node of this thread
+  class Array {
+  public:
+    Array() : data(0), count(0) {}
+    ~Array() { clear(); }
+    void allocate( unsigned int nbBlocks, size_t blockSize, float value, unsigned int nbThreads, WorkerPool* workers = 0 );
+    void clear( void );
+    size_t size( void ) const { return count; }
+    float& operator[]( size_t i ) { return data[i]; }
+    const float& operator[]( size_t i ) const { return data[i]; }
+  private:
+    Array( const Array& );
+    Array& operator=( const Array& );
+    float* data;
+    size_t count;
+  };
+
+  // first write of nbBlocks blocks of blockSize values by the threads of parallelFor( 0, nbBlocks )
+  static void fill( float* data, unsigned int nbBlocks, size_t blockSize, float value, unsigned int nbThreads,
+                    WorkerPool* workers = 0 );
+
+  // threads created once and kept for all the loops of a backend, the worker t processes the range t of each loop
+  // with a list of cores the worker t runs on the core cores[ t * nbCores / nbThreads ] (Linux and Windows, ignored elsewhere):
+  // the pages a range writes first stay on the memory node of its core, 0 or an empty list: the workers aren't pinned
+  // one loop at a time: run can't be called by the workers or by two threads at once
+  class WorkerPool {
+  public:
+    WorkerPool( unsigned int _nbThreads, const std::vector<unsigned int>* cores = 0 );
+    ~WorkerPool();
+    unsigned int getNbThreads( void ) const { return nbThreads; }
+    void run( unsigned int begin, unsigned int end, RangeFunction function, void* context );
+  private:
+    WorkerPool( const WorkerPool& );
+    WorkerPool& operator=( const WorkerPool& );
+    struct Worker {
+      WorkerPool* pool;
+      unsigned int begin;
+      unsigned int end;
+      bool started;               // false: the thread can not be created, the range is processed by the calling thread
+#ifdef _WIN32
+      HANDLE thread;
+#else
+      pthread_t thread;
+#endif
+    };
+#ifdef _WIN32
+    static DWORD WINAPI work( LPVOID arg );
+#else
+    static void* work( void* arg );
+#endif
+    unsigned int nbThreads;
+    std::vector<Worker> workers;
+    RangeFunction function;
+    void* context;
+    unsigned int loop;            // number of the current loop, the workers wait for the next one
+    unsigned int pending;         // started workers still processing the current loop
+    bool stopping;
+#ifdef _WIN32
+    CRITICAL_SECTION section;
+    CONDITION_VARIABLE loopStarted;
+    CONDITION_VARIABLE loopDone;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t loopStarted;
+    pthread_cond_t loopDone;
+#endif
+  };
+
+  // mutual exclusion of the threads sharing a static table (caches, timers)
+  class Mutex {
+  public:
+    Mutex();
+    ~Mutex();
+    void lock( void );
+    void unlock( void );
+  private:
+    Mutex( const Mutex& );
+    Mutex& operator=( const Mutex& );
+#ifdef _WIN32
+    CRITICAL_SECTION section;
+#else
+    pthread_mutex_t mutex;
+#endif
+  };
+
+  // locks the mutex until the end of the scope
+  class Lock {
+  public:
+    Lock( Mutex& _mutex ) : mutex( _mutex ) { mutex.lock(); }
+    ~Lock() { mutex.unlock(); }
+  private:
+    Mutex& mutex;
+  };
+};
+
+#endif  // _THREADUTILS_H